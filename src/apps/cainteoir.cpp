@@ -26,9 +26,12 @@
 #include <cainteoir/engines.hpp>
 #include <cainteoir/synthesizer.hpp>
 #include <cainteoir/language.hpp>
+#include <cainteoir/dictionary.hpp>
 #include <cainteoir/document.hpp>
+#include <cainteoir/stopwatch.hpp>
 #include <stdexcept>
 #include <iostream>
+#include <fstream>
 #include <cstdio>
 #include <cmath>
 
@@ -37,6 +40,7 @@
 #include <fcntl.h>
 #include <stdio.h>
 #include <limits.h>
+#include <pthread.h>
 
 namespace rdf = cainteoir::rdf;
 namespace rql = cainteoir::rdf::query;
@@ -48,6 +52,7 @@ enum actions
 	show_metadata,
 	show_contents,
 	compile_voice,
+	compile_languages,
 };
 
 int termchar()
@@ -102,6 +107,257 @@ void status_line(double elapsed, double total, double progress, const char *stat
 	fflush(stdout);
 }
 
+// Batch Rendering /////////////////////////////////////////////////////////////
+
+// Count the audio data written to a file so the length of the audio can be
+// reported.
+struct batch_audio : public cainteoir::audio
+{
+	batch_audio(const std::shared_ptr<cainteoir::audio> &aAudio)
+		: mAudio(aAudio)
+		, mBytes(0)
+	{
+	}
+
+	void open() { mAudio->open(); }
+
+	void close() { mAudio->close(); }
+
+	uint32_t write(const char *data, uint32_t len)
+	{
+		mBytes += len;
+		return mAudio->write(data, len);
+	}
+
+	int channels() const { return mAudio->channels(); }
+
+	int frequency() const { return mAudio->frequency(); }
+
+	const rdf::uri &format() const { return mAudio->format(); }
+
+	double duration() const
+	{
+		return double(mBytes) / (sizeof(short) * channels() * frequency());
+	}
+private:
+	std::shared_ptr<cainteoir::audio> mAudio;
+	uint64_t mBytes;
+};
+
+struct batch_document
+{
+	std::string input;
+	std::string output;
+
+	bool rendered;
+	double wall_time;  /* The time taken to render the document. */
+	double audio_time; /* The length of the rendered audio. */
+	size_t characters; /* The number of characters in the document. */
+	std::string error;
+};
+
+struct batch_job
+{
+	tts::engines *tts;
+	const rdf::graph *metadata; /* The voice and audio format metadata. */
+	const char *outformat;
+	tts::media_overlays_mode mode;
+	bool show_progress;
+
+	std::vector<batch_document> documents;
+	size_t next;
+	pthread_mutex_t lock;
+};
+
+static std::vector<batch_document>
+read_batch_manifest(const char *aManifest, const char *aFormat)
+{
+	std::ifstream is(aManifest);
+	if (!is)
+		throw std::runtime_error(i18n("unable to open the batch manifest"));
+
+	std::vector<batch_document> documents;
+	std::string line;
+	while (std::getline(is, line))
+	{
+		if (line.empty() || line[0] == '#')
+			continue;
+
+		batch_document doc;
+		doc.rendered = false;
+		doc.wall_time = 0.0;
+		doc.audio_time = 0.0;
+		doc.characters = 0;
+
+		auto tab = line.find('\t');
+		if (tab == std::string::npos)
+		{
+			doc.input = line;
+			auto ext = line.rfind('.');
+			auto dir = line.rfind('/');
+			if (ext == std::string::npos || (dir != std::string::npos && ext < dir))
+				doc.output = line;
+			else
+				doc.output = line.substr(0, ext);
+			doc.output += ".";
+			doc.output += aFormat ? aFormat : "wav";
+		}
+		else
+		{
+			doc.input = line.substr(0, tab);
+			doc.output = line.substr(tab + 1);
+		}
+		documents.push_back(doc);
+	}
+	return documents;
+}
+
+static std::shared_ptr<cainteoir::audio>
+create_batch_output(const batch_job &aJob,
+                    const batch_document &aDocument,
+                    const rdf::graph &aDocMetadata,
+                    const rdf::uri &aSubject)
+{
+	const char *outformat = aJob.outformat;
+	if (!outformat)
+	{
+		auto ext = aDocument.output.rfind('.');
+		outformat = (ext == std::string::npos) ? "wav" : aDocument.output.c_str() + ext + 1;
+	}
+
+	if (!strcmp(outformat, "wave") || !strcmp(outformat, "wav"))
+		return cainteoir::create_wav_file(aDocument.output.c_str(), *aJob.metadata, aJob.tts->voice());
+
+	if (!strcmp(outformat, "ogg"))
+	{
+		std::list<cainteoir::vorbis_comment> comments;
+		cainteoir::add_document_metadata(comments, aDocMetadata, aSubject);
+		return cainteoir::create_ogg_file(aDocument.output.c_str(), comments, 0.3, *aJob.metadata, aJob.tts->voice());
+	}
+
+	throw std::runtime_error(i18n("unsupported audio file format"));
+}
+
+static void render_document(const batch_job &aJob, batch_document &aDocument)
+{
+	cainteoir::stopwatch timer;
+
+	rdf::graph metadata;
+	rdf::uri subject(aDocument.input, std::string());
+	auto reader = cainteoir::createDocumentReader(aDocument.input.c_str(), metadata, std::string());
+	if (!reader)
+		throw std::runtime_error(i18n("unsupported document format"));
+
+	cainteoir::document doc(reader, metadata);
+	std::vector<cainteoir::ref_entry> listing;
+
+	auto out = std::make_shared<batch_audio>(create_batch_output(aJob, aDocument, metadata, subject));
+	auto speech = aJob.tts->speak(out, listing, doc, doc.children(), aJob.mode);
+	speech->wait();
+
+	if (!speech->error_message().empty())
+		throw std::runtime_error(speech->error_message());
+
+	aDocument.wall_time = timer.elapsed();
+	aDocument.audio_time = out->duration();
+	aDocument.characters = doc.text_length();
+	aDocument.rendered = true;
+}
+
+static void *batch_worker(void *data)
+{
+	batch_job &job = *(batch_job *)data;
+
+	pthread_mutex_lock(&job.lock);
+	while (job.next < job.documents.size())
+	{
+		batch_document &doc = job.documents[job.next++];
+		pthread_mutex_unlock(&job.lock);
+
+		try
+		{
+			render_document(job, doc);
+		}
+		catch (const std::exception &e)
+		{
+			doc.error = e.what();
+		}
+
+		pthread_mutex_lock(&job.lock);
+		if (job.show_progress)
+		{
+			if (doc.rendered)
+			{
+				char wall_time[80];
+				char audio_time[80];
+				format_time(wall_time, 80, doc.wall_time);
+				format_time(audio_time, 80, doc.audio_time);
+				fprintf(stdout, i18n("%s : %s in %s [RTF %.3f]\n"),
+				        doc.input.c_str(), audio_time, wall_time,
+				        doc.audio_time > 0.0 ? doc.wall_time / doc.audio_time : 0.0);
+			}
+			else
+				fprintf(stdout, i18n("%s : error: %s\n"), doc.input.c_str(), doc.error.c_str());
+			fflush(stdout);
+		}
+	}
+	pthread_mutex_unlock(&job.lock);
+	return nullptr;
+}
+
+static int render_batch(batch_job &aJob, int aWorkers)
+{
+	cainteoir::stopwatch timer;
+
+	pthread_mutex_init(&aJob.lock, nullptr);
+	aJob.next = 0;
+
+	std::vector<pthread_t> workers;
+	for (int i = 0; i < aWorkers && i < (int)aJob.documents.size(); ++i)
+	{
+		pthread_t worker;
+		if (pthread_create(&worker, nullptr, batch_worker, (void *)&aJob) == 0)
+			workers.push_back(worker);
+	}
+	if (workers.empty())
+		batch_worker((void *)&aJob);
+
+	for (auto &worker : workers)
+		pthread_join(worker, nullptr);
+
+	pthread_mutex_destroy(&aJob.lock);
+
+	double wall_time = timer.elapsed();
+	double audio_time = 0.0;
+	size_t characters = 0;
+	int rendered = 0;
+	for (auto &doc : aJob.documents)
+	{
+		if (!doc.rendered) continue;
+		audio_time += doc.audio_time;
+		characters += doc.characters;
+		++rendered;
+	}
+
+	if (aJob.show_progress)
+	{
+		char total_wall_time[80];
+		char total_audio_time[80];
+		format_time(total_wall_time, 80, wall_time);
+		format_time(total_audio_time, 80, audio_time);
+
+		fprintf(stdout, i18n("\nRendered %d of %d documents with %d workers\n"),
+		        rendered, (int)aJob.documents.size(), (int)std::max(workers.size(), size_t(1)));
+		fprintf(stdout, i18n("  audio : %s in %s [RTF %.3f]\n"),
+		        total_audio_time, total_wall_time,
+		        audio_time > 0.0 ? wall_time / audio_time : 0.0);
+		fprintf(stdout, i18n("  throughput : %.2f documents/minute, %.0f characters/s, %.2f audio seconds/s\n"),
+		        rendered * 60.0 / wall_time, characters / wall_time, audio_time / wall_time);
+	}
+
+	return rendered == (int)aJob.documents.size() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
 int main(int argc, char ** argv)
 {
 	setlocale(LC_MESSAGES, "");
@@ -120,6 +376,8 @@ int main(int argc, char ** argv)
 		const char *outfile = nullptr;
 		const char *outformat = nullptr;
 		const char *device_name = nullptr;
+		const char *manifest = nullptr;
+		int workers = 1;
 
 		int speed = INT_MAX;
 		int pitch = INT_MAX;
@@ -137,6 +395,8 @@ int main(int argc, char ** argv)
 			  i18n("Use DEVICE for audio output (ALSA/pulseaudio device name)") },
 			{ 'C', "compile", bind_value(action, compile_voice),
 			  i18n("Convert a voice definition file into the Voice DB format") },
+			{ 0, "compile-languages", bind_value(action, compile_languages),
+			  i18n("Convert the RDF/XML language subtag registry into the Subtag DB format") },
 		}};
 
 		const option_group speech_options = { i18n("Speech:"), {
@@ -181,24 +441,34 @@ int main(int argc, char ** argv)
 			  i18n("Record the audio as a FORMAT file (default: wav)") },
 		}};
 
+		const option_group batch_options = { i18n("Batch Rendering:"), {
+			{ 'b', "batch", manifest, "MANIFEST",
+			  i18n("Record the documents listed in the MANIFEST file") },
+			{ 'j', "jobs", workers, "JOBS",
+			  i18n("Record JOBS documents at the same time (default: 1)") },
+		}};
+
 		const std::initializer_list<const option_group *> options = {
 			&general_options,
 			&speech_options,
 			&narration_options,
 			&toc_options,
 			&recording_options,
+			&batch_options,
 		};
 
 		const std::initializer_list<const char *> usage = {
 			i18n("cainteoir [OPTION..] DOCUMENT"),
 			i18n("cainteoir [OPTION..] --compile VOICE_FILE"),
+			i18n("cainteoir [OPTION..] --compile-languages REGISTRY_FILE"),
+			i18n("cainteoir [OPTION..] --batch MANIFEST"),
 			i18n("cainteoir [OPTION..]"),
 		};
 
 		if (!parse_command_line(options, usage, argc, argv))
 			return 0;
 
-		if (nav_range.second != -1) ++nav_range.second;
+		if (nav_range.second != size_t(-1)) ++nav_range.second;
 
 		auto mode = tts::media_overlays_mode::tts_only;
 		if (use_narrator)
@@ -206,19 +476,25 @@ int main(int argc, char ** argv)
 			     ? tts::media_overlays_mode::tts_and_media_overlays
 			     : tts::media_overlays_mode::media_overlays_only;
 
-		if (action == compile_voice)
+		if (action == compile_voice || action == compile_languages)
 		{
 			const char *filename = (argc == 1) ? argv[0] : nullptr;
 			decltype(tts::compile_voice) *compile = nullptr;
 
-			const char *ext = strrchr(filename, '.');
-			if (ext == nullptr)
+			if (filename == nullptr)
 				return 0;
 
-			if (strcmp(ext, ".voicedef") == 0)
+			const char *ext = strrchr(filename, '.');
+			if (action == compile_languages)
+				compile = cainteoir::language::compile_subtag_registry;
+			else if (ext == nullptr)
+				return 0;
+			else if (strcmp(ext, ".voicedef") == 0)
 				compile = tts::compile_voice;
 			else if (strcmp(ext, ".langdef") == 0)
 				compile = tts::compile_language;
+			else if (strcmp(ext, ".dict") == 0)
+				compile = tts::compile_dictionary;
 			else
 				return 0;
 
@@ -286,6 +562,18 @@ int main(int argc, char ** argv)
 		if (range  != INT_MAX) tts.parameter(tts::parameter::pitch_range)->set_value(range);
 		if (volume != INT_MAX) tts.parameter(tts::parameter::volume)->set_value(volume);
 
+		if (manifest)
+		{
+			batch_job job;
+			job.tts = &tts;
+			job.metadata = &metadata;
+			job.outformat = outformat;
+			job.mode = mode;
+			job.show_progress = show_progress;
+			job.documents = read_batch_manifest(manifest, outformat);
+			return render_batch(job, workers);
+		}
+
 		const char *filename = (argc == 1) ? argv[0] : nullptr;
 		rdf::uri subject(filename ? filename : std::string(), std::string());
 		auto reader = cainteoir::createDocumentReader(filename, metadata, std::string());
@@ -296,7 +584,14 @@ int main(int argc, char ** argv)
 		}
 
 		cainteoir::document doc(reader, metadata);
-		auto listing = cainteoir::navigation(metadata, subject, rdf::epv("toc"));
+		if (action == show_contents || nav_range.first != size_t(-1) || nav_range.second != size_t(-1))
+			doc.size(); // read the document to get the table of contents
+
+		std::vector<cainteoir::ref_entry> listing;
+		{
+			cainteoir::document::metadata_lock lock(doc);
+			listing = cainteoir::navigation(metadata, subject, rdf::epv("toc"));
+		}
 
 		if (action == show_contents)
 		{
@@ -287,7 +287,7 @@ static uint32_t from_document(tts::dictionary &base_dict,
 	uint32_t words = 0;
 	auto tokens = tts::create_text_reader();
 	tokens->reset(reader);
-	while (tokens->read()) switch (tokens->token.get("Token:type").integer())
+	while (tokens->next()) switch (tokens->type)
 	{
 	case tts::word_uppercase:
 	case tts::word_lowercase:
@@ -295,7 +295,7 @@ static uint32_t from_document(tts::dictionary &base_dict,
 	case tts::word_mixedcase:
 	case tts::word_script:
 		{
-			auto text = tokens->token.get("Token:text").buffer();
+			auto text = cainteoir::make_buffer(tokens->text.begin(), tokens->text.size());
 			auto &match = base_dict.lookup(text);
 			switch (match.get(0).get("Entry::pronunciation").type())
 			{
@@ -333,6 +333,8 @@ static uint32_t from_document(tts::dictionary &base_dict,
 			}
 		}
 		break;
+	default:
+		break;
 	}
 
 	return words;
@@ -358,6 +358,7 @@ int main(int argc, char ** argv)
 		}
 
 		cainteoir::document doc(reader, metadata);
+		doc.size(); // read the document to get the table of contents
 		auto listing = cainteoir::navigation(metadata, subject, rdf::epv("toc"));
 
 		if (show_toc)
@@ -123,13 +123,15 @@ int main(int argc, char ** argv)
 		std::map<std::string, int> words;
 		auto tokens = tts::create_text_reader();
 		tokens->reset(reader);
-		while (tokens->read()) switch (tokens->token.get("Token:type").integer())
+		while (tokens->next()) switch (tokens->type)
 		{
 		case tts::word_uppercase:
 		case tts::word_lowercase:
 		case tts::word_mixedcase:
 		case tts::word_capitalized:
-			++words[tokens->token.get("Token:text").buffer()->str()];
+			++words[tokens->text.str()];
+			break;
+		default:
 			break;
 		}
 
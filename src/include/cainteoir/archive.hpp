@@ -33,6 +33,10 @@ namespace cainteoir
 
 		virtual std::shared_ptr<buffer> read(const char *aFilename) const = 0;
 
+		virtual std::shared_ptr<buffer_reader> read_stream(const char *aFilename) const = 0;
+
+		virtual void prefetch(const std::list<std::string> &aFilenames, unsigned int aThreads) const = 0;
+
 		virtual const std::list<std::string> &files() const = 0;
 	};
 
@@ -27,6 +27,7 @@
 #include <cstring>
 #include <string>
 #include <memory>
+#include <vector>
 #include <list>
 
 namespace cainteoir
@@ -131,7 +132,7 @@ namespace cainteoir
 
 	class rope
 	{
-		std::list<std::shared_ptr<cainteoir::buffer>> data;
+		std::vector<std::shared_ptr<cainteoir::buffer>> data;
 		std::size_t len;
 	public:
 		rope(): len(0) {}
@@ -170,6 +171,21 @@ namespace cainteoir
 
 	std::shared_ptr<buffer> decode_base64(const buffer &data, uint32_t size);
 
+	struct buffer_reader : public buffer
+	{
+		buffer_reader() : buffer(nullptr, nullptr) {}
+
+		virtual bool read() = 0;
+	};
+
+	typedef std::shared_ptr<buffer_reader> (*stream_decoder_ptr)(const std::shared_ptr<buffer> &data, uint32_t size);
+
+	std::shared_ptr<buffer_reader> copy_stream(const std::shared_ptr<buffer> &data, uint32_t size);
+
+	std::shared_ptr<buffer_reader> inflate_zlib_stream(const std::shared_ptr<buffer> &data, uint32_t size);
+
+	std::shared_ptr<buffer_reader> inflate_gzip_stream(const std::shared_ptr<buffer> &data, uint32_t size);
+
 	struct native_endian_buffer
 	{
 		native_endian_buffer(const uint8_t *f, const uint8_t *l)
@@ -370,6 +370,13 @@ namespace cainteoir { namespace css
 
 	struct style_manager
 	{
+		style_manager() {}
+
+		explicit style_manager(const std::shared_ptr<const style_manager> &aBase)
+			: mBase(aBase)
+		{
+		}
+
 		const counter_style *get_counter_style(const std::string &aName) const;
 
 		counter_style *create_counter_style(const std::string &aName);
@@ -383,6 +390,7 @@ namespace cainteoir { namespace css
 
 		void parse(const std::shared_ptr<buffer> &style);
 	private:
+		std::shared_ptr<const style_manager>         mBase;
 		std::list<std::shared_ptr<counter_style>>    mCounterStyleRegistry;
 		std::map<std::string, const counter_style *> mCounterStyles;
 	};
@@ -124,6 +124,66 @@ namespace cainteoir { namespace tts
 		storage_type mEntries;
 	};
 
+	struct compiled_dictionary
+	{
+		enum class entry_type : uint8_t
+		{
+			no_match = 0,
+			phonemes = 1,
+			say_as   = 2,
+		};
+
+		struct entry
+		{
+			entry_type type;
+			range<const ipa::phoneme *> phonemes;
+			buffer say_as;
+
+			entry()
+				: type(entry_type::no_match)
+				, phonemes(nullptr, nullptr)
+				, say_as(nullptr, nullptr)
+			{
+			}
+		};
+
+		compiled_dictionary(const std::shared_ptr<buffer> &aData);
+
+		entry lookup(const char *aWord, std::size_t aLength) const;
+
+		entry lookup(const buffer &aWord) const
+		{
+			return lookup(aWord.begin(), aWord.size());
+		}
+
+		std::size_t size()  const { return mSize; }
+		bool        empty() const { return mSize == 0; }
+
+		entry operator[](std::size_t aIndex) const;
+
+		buffer word(std::size_t aIndex) const;
+
+		bool pronounce(const std::shared_ptr<buffer> &aWord,
+		               const std::shared_ptr<tts::phoneme_reader> &aPronunciationRules,
+		               ipa::phonemes &aPhonemes) const
+		{
+			return pronounce(*aWord, aPronunciationRules, aPhonemes, 0);
+		}
+	private:
+		bool pronounce(const buffer &aWord,
+		               const std::shared_ptr<tts::phoneme_reader> &aPronunciationRules,
+		               ipa::phonemes &aPhonemes,
+		               int depth) const;
+
+		std::shared_ptr<buffer> mData;
+		const uint32_t *mBuckets;
+		uint32_t mBucketMask;
+		const uint8_t *mEntries;
+		std::size_t mSize;
+	};
+
+	void compile_dictionary(const char *aFileName, FILE *aOutput);
+
 	struct dictionary_reader
 	{
 		std::shared_ptr<cainteoir::buffer> word;
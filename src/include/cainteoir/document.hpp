@@ -100,27 +100,91 @@ namespace cainteoir
 
 	class document
 	{
+		struct data;
 	public:
-		typedef std::list<document_item> list_type;
-		typedef list_type::const_iterator const_iterator;
+		class const_iterator
+		{
+		public:
+			typedef std::ptrdiff_t difference_type;
+			typedef std::forward_iterator_tag iterator_category;
+			typedef const document_item value_type;
+			typedef const document_item *pointer;
+			typedef const document_item &reference;
+
+			const_iterator()
+				: mDocument(nullptr)
+				, mIndex(size_t(-1))
+				, mItem(nullptr)
+				, mLast(nullptr)
+			{
+			}
+
+			size_t index() const { return mIndex; }
+
+			reference operator*()  const { return *mItem; }
+			pointer   operator->() const { return mItem; }
+
+			const_iterator &operator++()
+			{
+				if (++mItem == mLast)
+					mDocument->fetch(*this, mIndex + 1);
+				else
+					++mIndex;
+				return *this;
+			}
+
+			const_iterator operator++(int)
+			{
+				auto ret = *this;
+				++*this;
+				return ret;
+			}
+
+			bool operator==(const const_iterator &other) const { return mIndex == other.mIndex; }
+			bool operator!=(const const_iterator &other) const { return mIndex != other.mIndex; }
+		private:
+			friend class document;
+
+			const document *mDocument;
+			size_t mIndex;
+			const document_item *mItem;
+			const document_item *mLast;
+		};
+
 		typedef range<const_iterator> range_type;
 
+		class metadata_lock
+		{
+		public:
+			metadata_lock(const document &aDocument);
+			~metadata_lock();
+
+			metadata_lock(const metadata_lock &) = delete;
+			metadata_lock &operator=(const metadata_lock &) = delete;
+		private:
+			std::shared_ptr<data> mData;
+		};
+
 		document(const std::shared_ptr<document_reader> &aReader, rdf::graph &aMetadata);
 
-		size_t text_length() const { return mLength; }
+		size_t text_length() const;
+
+		size_t size() const;
+
+		const_iterator at(size_t aIndex) const;
 
 		range_type children(const std::pair<const rdf::uri, const rdf::uri> &aAnchors) const;
 
 		range_type children(const std::vector<ref_entry> &aListing,
 		                    const std::pair<size_t, size_t> &aRange) const;
 
-		range_type children() const { return range_type(mChildren.begin(), mChildren.end()); }
+		range_type children() const { return range_type(at(0), const_iterator()); }
 
 		size_t indexof(const rdf::uri &aAnchor) const;
 	private:
-		size_t mLength;
-		list_type mChildren;
-		std::map<std::string, size_t> mAnchors;
+		void fetch(const_iterator &aItem, size_t aIndex) const;
+
+		std::shared_ptr<data> mData;
 	};
 
 	enum capability_types
@@ -131,6 +195,8 @@ namespace cainteoir
 
 	void supportedDocumentFormats(rdf::graph &metadata, capability_types capabilities);
 
+	void setDocumentParserThreads(unsigned int aThreads);
+
 	std::shared_ptr<document_reader>
 	createDocumentReader(const char *aFilename,
 	                     rdf::graph &aPrimaryMetadata,
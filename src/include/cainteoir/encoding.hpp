@@ -31,6 +31,8 @@ namespace cainteoir
 		{
 			virtual void decode(const cainteoir::buffer &data, cainteoir::rope &decoded) const = 0;
 
+			virtual void decode(const cainteoir::buffer &data, std::string &decoded) const = 0;
+
 			virtual ~decoder() {}
 		};
 	}
@@ -50,9 +52,14 @@ namespace cainteoir
 		std::shared_ptr<cainteoir::buffer> decode(const std::shared_ptr<cainteoir::buffer> &data) const;
 
 		void decode(const std::shared_ptr<cainteoir::buffer> &data, cainteoir::rope &decoded) const;
+
+		void decode(const cainteoir::buffer &data, std::string &decoded) const;
+
+		bool is_native() const { return mNative; }
 	private:
 		std::shared_ptr<detail::decoder> mDecoder;
 		std::string mEncoding;
+		bool mNative;
 	};
 }
 
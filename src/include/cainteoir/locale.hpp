@@ -22,6 +22,7 @@
 #define CAINTEOIR_ENGINE_LOCALE_HPP
 
 #include <string>
+#include <cstdio>
 
 namespace cainteoir { namespace language
 {
@@ -59,6 +60,8 @@ namespace cainteoir { namespace language
 	bool issubtag(const tag &a, const tag &b);
 
 	tag make_lang(const std::string &lang);
+
+	void compile_subtag_registry(const char *aFileName, FILE *aOutput);
 }}
 
 namespace cainteoir
@@ -22,6 +22,7 @@
 #define CAINTEOIR_ENGINE_METADATA_HPP
 
 #include <cainteoir/xmlreader.hpp>
+#include <unordered_map>
 #include <sstream>
 #include <set>
 
@@ -279,22 +280,72 @@ namespace cainteoir { namespace rdf
 
 	struct triplestore : public query::results
 	{
-		void push_back(const_reference item)
+		void push_back(const_reference item);
+
+		const query::results &subject(const rdf::uri &s) const
 		{
-			query::results::push_back(item);
-			subjects[query::subject(item).str()].push_back(item);
+			return lookup(subjects, find(s));
 		}
 
-		const query::results &subject(const rdf::uri &s) const
+		const query::results &predicate(const rdf::uri &p) const
+		{
+			return lookup(predicates, find(p));
+		}
+
+		const query::results &object(const rdf::uri &o) const
+		{
+			return lookup(objects, find(o));
+		}
+
+		const query::results &subject_predicate(const rdf::uri &s, const rdf::uri &p) const
 		{
-			static const query::results empty;
-			auto ret = subjects.find(s.str());
-			if (ret == subjects.end())
-				return empty;
-			return (*ret).second;
+			return lookup(subject_predicates, find(s), find(p));
+		}
+
+		const query::results &predicate_object(const rdf::uri &p, const rdf::uri &o) const
+		{
+			return lookup(predicate_objects, find(p), find(o));
 		}
 	private:
-		std::map<std::string, query::results> subjects;
+		struct uri_hash
+		{
+			std::size_t operator()(const rdf::uri &u) const
+			{
+				std::hash<std::string> hash;
+				return hash(u.ns) * 31 + hash(u.ref);
+			}
+		};
+
+		typedef std::unordered_map<uint32_t, query::results> index_t;
+		typedef std::unordered_map<uint64_t, query::results> pair_index_t;
+
+		static constexpr uint32_t npos = (uint32_t)-1;
+
+		uint32_t intern(const rdf::uri &aUri);
+
+		uint32_t find(const rdf::uri &aUri) const
+		{
+			auto id = ids.find(aUri);
+			if (id == ids.end())
+				return npos;
+			return id->second;
+		}
+
+		static uint64_t key(uint32_t a, uint32_t b)
+		{
+			return ((uint64_t)a << 32) | b;
+		}
+
+		static const query::results &lookup(const index_t &aIndex, uint32_t aId);
+
+		static const query::results &lookup(const pair_index_t &aIndex, uint32_t aFirst, uint32_t aSecond);
+
+		std::unordered_map<rdf::uri, uint32_t, uri_hash> ids;
+		index_t subjects;
+		index_t predicates;
+		index_t objects;
+		pair_index_t subject_predicates;
+		pair_index_t predicate_objects;
 	};
 
 	const uri href(const std::string &aHref);
@@ -322,6 +373,26 @@ namespace cainteoir { namespace rdf
 			return triples.subject(s);
 		}
 
+		const query::results &predicate(const rdf::uri &p) const
+		{
+			return triples.predicate(p);
+		}
+
+		const query::results &object(const rdf::uri &o) const
+		{
+			return triples.object(o);
+		}
+
+		const query::results &subject_predicate(const rdf::uri &s, const rdf::uri &p) const
+		{
+			return triples.subject_predicate(s, p);
+		}
+
+		const query::results &predicate_object(const rdf::uri &p, const rdf::uri &o) const
+		{
+			return triples.predicate_object(p, o);
+		}
+
 		bool contains(const ns &uri) const;
 
 		rdf::graph &set_base(const std::string &aBase);
@@ -441,12 +512,62 @@ namespace cainteoir { namespace rdf
 			return ret;
 		}
 
-		inline results select(const graph &metadata,
-		                      const query::detail::matches_t<query::detail::subject_t, const rdf::uri &> &m)
+		// The select queries on a graph that can be answered using the graph's
+		// indices return the matching statements without copying them.
+
+		namespace detail
+		{
+			typedef matches_t<subject_t,   const rdf::uri &> subject_matches_t;
+			typedef matches_t<predicate_t, const rdf::uri &> predicate_matches_t;
+			typedef matches_t<object_t,    const rdf::uri &> object_matches_t;
+		}
+
+		inline const results &select(const graph &metadata, const detail::subject_matches_t &m)
 		{
 			return metadata.subject(m.value);
 		}
 
+		inline const results &select(const graph &metadata, const detail::predicate_matches_t &m)
+		{
+			return metadata.predicate(m.value);
+		}
+
+		inline const results &select(const graph &metadata, const detail::object_matches_t &m)
+		{
+			return metadata.object(m.value);
+		}
+
+		inline const results &select(const graph &metadata,
+		                             const detail::both_t<detail::subject_matches_t, detail::predicate_matches_t> &m)
+		{
+			return metadata.subject_predicate(m.a.value, m.b.value);
+		}
+
+		inline const results &select(const graph &metadata,
+		                             const detail::both_t<detail::predicate_matches_t, detail::subject_matches_t> &m)
+		{
+			return metadata.subject_predicate(m.b.value, m.a.value);
+		}
+
+		inline const results &select(const graph &metadata,
+		                             const detail::both_t<detail::predicate_matches_t, detail::object_matches_t> &m)
+		{
+			return metadata.predicate_object(m.a.value, m.b.value);
+		}
+
+		inline const results &select(const graph &metadata,
+		                             const detail::both_t<detail::object_matches_t, detail::predicate_matches_t> &m)
+		{
+			return metadata.predicate_object(m.b.value, m.a.value);
+		}
+
+		template<typename Selector>
+		inline results select(const graph &metadata,
+		                      const detail::both_t<detail::subject_matches_t, Selector> &m)
+		{
+			return select(metadata.subject(m.a.value), m.b);
+		}
+
 		template<typename TripleStore, typename Selector>
 		inline bool contains(const TripleStore &metadata, const Selector &selector)
 		{
@@ -45,6 +45,8 @@ namespace cainteoir
 
 	void ifft(complex_array &aData);
 
+	void rfft(complex_array &aData);
+
 	template <typename T>
 	struct audio_data
 	{
@@ -113,6 +113,11 @@ namespace cainteoir { namespace tts
 		envelope(ipa::phoneme aTones,
 		         tts::probability_distribution aProbabilityDistribution) const;
 
+		std::size_t
+		envelope(envelope_t *aEnvelope,
+		         ipa::phoneme aTones,
+		         tts::probability_distribution aProbabilityDistribution) const;
+
 		tts::pitch top;
 		tts::pitch high;
 		tts::pitch mid;
@@ -180,6 +185,87 @@ namespace cainteoir { namespace tts
 	                   const std::vector<unit_t> &aUnits,
 	                   const range<const phoneme_units *> &aPhonemes);
 
+	struct prosody_block
+	{
+		static constexpr std::size_t capacity = 128;
+		static constexpr std::size_t envelope_capacity = capacity * 4;
+
+		std::size_t count;
+		phone first[capacity];
+		phone second[capacity];
+		uint16_t envelope_start[capacity];
+		uint16_t envelope_size[capacity];
+
+		std::size_t envelope_count;
+		envelope_t envelope_points[envelope_capacity];
+
+		prosody_block()
+			: count(0)
+			, envelope_count(0)
+		{
+		}
+
+		void clear()
+		{
+			count = 0;
+			envelope_count = 0;
+		}
+
+		bool can_append(std::size_t aEnvelopeSize) const
+		{
+			return count != capacity && envelope_count + aEnvelopeSize <= envelope_capacity;
+		}
+
+		void append(const phone &aFirst, const phone &aSecond)
+		{
+			first[count] = aFirst;
+			second[count] = aSecond;
+			envelope_start[count] = envelope_count;
+			envelope_size[count] = 0;
+			++count;
+		}
+
+		void append(const envelope_t &aPoint)
+		{
+			envelope_points[envelope_count++] = aPoint;
+			++envelope_size[count - 1];
+		}
+
+		range<const envelope_t *> envelope(std::size_t aIndex) const
+		{
+			const envelope_t *points = envelope_points + envelope_start[aIndex];
+			return { points, points + envelope_size[aIndex] };
+		}
+	};
+
+	struct prosody_block_reader
+	{
+		virtual bool read(prosody_block &aBlock, std::size_t aMaxCount = prosody_block::capacity) = 0;
+
+		virtual ~prosody_block_reader() {}
+	};
+
+	std::shared_ptr<prosody_block_reader>
+	create_prosody_block_reader(const std::shared_ptr<phoneme_reader> &aPhonemes,
+	                            const std::shared_ptr<duration_model> &aDurationModel,
+	                            const std::shared_ptr<tts::pitch_model> &aPitchModel,
+	                            tts::probability_distribution aProbabilityDistribution);
+
+	std::shared_ptr<prosody_block_reader>
+	create_diphone_block_reader(const std::shared_ptr<prosody_block_reader> &aProsody);
+
+	std::shared_ptr<prosody_block_reader>
+	create_unit_block_reader(const std::shared_ptr<prosody_block_reader> &aProsody,
+	                         const std::vector<unit_t> &aUnits,
+	                         const range<const phoneme_units *> &aPhonemes);
+
+	std::shared_ptr<prosody_block_reader>
+	create_prosody_block_reader(const std::shared_ptr<prosody_reader> &aProsody);
+
+	std::shared_ptr<prosody_reader>
+	create_prosody_reader(const std::shared_ptr<prosody_block_reader> &aProsody,
+	                      std::size_t aBlockSize = prosody_block::capacity);
+
 	struct prosody_writer
 	{
 		virtual void reset(FILE *aOutput) = 0;
@@ -223,6 +309,14 @@ namespace cainteoir { namespace tts
 		virtual bool synthesize(audio *out) = 0;
 	};
 
+	struct synthesizer_pool_stats
+	{
+		uint32_t hits;
+		uint32_t misses;
+		uint32_t waits;
+		double wait_time;
+	};
+
 	struct voice
 	{
 		virtual ~voice() {}
@@ -244,6 +338,12 @@ namespace cainteoir { namespace tts
 
 		virtual range<const phoneme_units *>
 		phones() = 0;
+
+		virtual void
+		set_pool_size(int aPoolSize) = 0;
+
+		virtual synthesizer_pool_stats
+		pool_stats() = 0;
 	};
 
 	void read_voice_metadata(rdf::graph &aMetadata);
@@ -54,13 +54,29 @@ namespace cainteoir { namespace tts
 		virtual void onevent(const document_item &item) = 0;
 	};
 
-	struct text_reader
+	struct text_token
+	{
+		event_type type;
+		buffer text;
+		cainteoir::range<uint32_t> range;
+
+		text_token()
+			: type(error)
+			, text(nullptr, nullptr)
+			, range(0, 0)
+		{
+		}
+	};
+
+	struct text_reader : public text_token
 	{
 		object token;
 
 		virtual void reset(const std::shared_ptr<cainteoir::document_reader> &aReader) = 0;
 
-		virtual bool read() = 0;
+		virtual bool next() = 0;
+
+		bool read();
 
 		virtual ~text_reader() {}
 	};
@@ -1,6 +1,6 @@
 /* Trie Data Structure.
  *
- * Copyright (C) 2013-2014 Reece H. Dunn
+ * Copyright (C) 2013-2015 Reece H. Dunn
  *
  * This file is part of cainteoir-engine.
  *
@@ -22,6 +22,9 @@
 #define CAINTEOIR_ENGINE_TRIE_HPP
 
 #include "buffer.hpp"
+#include <type_traits>
+#include <algorithm>
+#include <vector>
 #include <list>
 
 namespace cainteoir
@@ -62,6 +65,116 @@ namespace cainteoir
 		}
 	};
 
+	template <typename T, typename Key = char>
+	struct compiled_trie_node
+	{
+		Key c;
+		T item;
+		uint32_t num_children;
+		int32_t children;
+
+		compiled_trie_node(const Key &ch, const T &aItem, uint32_t aNumChildren, int32_t aChildren)
+			: c(ch)
+			, item(aItem)
+			, num_children(aNumChildren)
+			, children(aChildren)
+		{
+		}
+
+		const compiled_trie_node<T, Key> *get(const Key &ch) const
+		{
+			const compiled_trie_node<T, Key> *first = this + children;
+			const compiled_trie_node<T, Key> *last  = first + num_children;
+			if (num_children <= 8)
+			{
+				for (; first != last; ++first)
+				{
+					if (first->c == ch) return first;
+				}
+				return nullptr;
+			}
+
+			first = std::lower_bound(first, last, ch,
+				[](const compiled_trie_node<T, Key> &node, const Key &ch) { return ch > node.c; });
+			if (first != last && first->c == ch) return first;
+			return nullptr;
+		}
+	};
+
+	template <typename T, typename Key = char>
+	struct compiled_trie
+	{
+		compiled_trie()
+			: mNodes(1, compiled_trie_node<T, Key>(0, T(), 0, 0))
+			, mJumpTable(has_jump_table::value ? 256 : 0, 0)
+		{
+		}
+
+		compiled_trie(const trie_node<T, Key> &aRoot)
+			: mJumpTable(has_jump_table::value ? 256 : 0, 0)
+		{
+			std::vector<const trie_node<T, Key> *> nodes{ &aRoot };
+			for (size_t i = 0; i != nodes.size(); ++i)
+			{
+				const trie_node<T, Key> *node = nodes[i];
+				int32_t children = (int32_t)(nodes.size() - i);
+				for (auto && child : node->children)
+					nodes.push_back(&child);
+
+				uint32_t num_children = nodes.size() - i - children;
+				mNodes.push_back({ node->c, node->item, num_children, num_children ? children : 0 });
+			}
+
+			const compiled_trie_node<T, Key> *root = &mNodes.front();
+			for (uint32_t i = 0; i != root->num_children; ++i)
+			{
+				const compiled_trie_node<T, Key> *child = root + root->children + i;
+				set_jump(child->c, root->children + i, has_jump_table());
+			}
+		}
+
+		const compiled_trie_node<T, Key> *root() const { return &mNodes.front(); }
+
+		size_t size() const { return mNodes.size(); }
+
+		template <typename Container>
+		const T &lookup(const Container &str, const T &no_match = T()) const
+		{
+			auto first = std::begin(str), last = std::end(str);
+			if (first == last) return root()->item;
+
+			const compiled_trie_node<T, Key> *node = get_first(*first, has_jump_table());
+			for (++first; node != nullptr && first != last; ++first)
+				node = node->get(*first);
+			return node == nullptr ? no_match : node->item;
+		}
+	private:
+		typedef std::integral_constant<bool, std::is_integral<Key>::value && sizeof(Key) == 1> has_jump_table;
+
+		std::vector<compiled_trie_node<T, Key>> mNodes;
+		std::vector<uint32_t> mJumpTable;
+
+		void set_jump(const Key &ch, uint32_t index, std::true_type)
+		{
+			mJumpTable[(uint8_t)ch] = index;
+		}
+
+		void set_jump(const Key &, uint32_t, std::false_type)
+		{
+		}
+
+		const compiled_trie_node<T, Key> *get_first(const Key &ch, std::true_type) const
+		{
+			uint32_t index = mJumpTable[(uint8_t)ch];
+			return index == 0 ? nullptr : &mNodes[index];
+		}
+
+		const compiled_trie_node<T, Key> *get_first(const Key &ch, std::false_type) const
+		{
+			return root()->get(ch);
+		}
+	};
+
 	template <typename T, typename Key = char>
 	struct trie
 	{
@@ -95,6 +208,11 @@ namespace cainteoir
 			}
 			return node->item;
 		}
+
+		compiled_trie<T, Key> compile() const
+		{
+			return compiled_trie<T, Key>(mRoot);
+		}
 	private:
 		trie_node<T, Key> mRoot;
 	};
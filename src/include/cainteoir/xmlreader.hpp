@@ -23,6 +23,7 @@
 
 #include <cainteoir/encoding.hpp>
 #include <cainteoir/content.hpp>
+#include <vector>
 #include <map>
 
 namespace cainteoir { namespace xml
@@ -66,6 +67,8 @@ namespace cainteoir { namespace xml
 		extern const ns xsd;
 	}
 
+	uint32_t namespace_id(const std::string &aHref);
+
 	struct namespaces
 	{
 		namespaces();
@@ -87,24 +90,27 @@ namespace cainteoir { namespace xml
 
 		std::string lookup(const std::string &aPrefix) const;
 
-		std::string lookup(const cainteoir::buffer &aPrefix) const
-		{
-			return lookup(aPrefix.str());
-		}
+		std::string lookup(const cainteoir::buffer &aPrefix) const;
+
+		uint32_t lookup_id(const cainteoir::buffer &aPrefix) const;
 	private:
 		struct namespace_item
 		{
-			long block;
-			ns   item;
+			long     block;
+			ns       item;
+			mutable uint32_t id;
 
 			namespace_item(long aBlock, const ns &aItem)
 				: block(aBlock)
 				, item(aItem)
+				, id(namespace_id(aItem.href))
 			{
 			}
 		};
 
-		std::list<namespace_item> mNamespaces;
+		const namespace_item *find(const cainteoir::buffer &aPrefix) const;
+
+		std::vector<namespace_item> mNamespaces;
 		long mBlockNumber;
 	};
 
@@ -134,6 +140,13 @@ namespace cainteoir { namespace xml
 		open_close,
 	};
 
+	namespace detail
+	{
+		struct entry_table;
+
+		struct text_buffer;
+	}
+
 	struct context
 	{
 		struct entry
@@ -175,22 +188,30 @@ namespace cainteoir { namespace xml
 			set(aNS, entries, match);
 		}
 
-		void set(const std::string &aNS, const std::initializer_list<const entry_ref> &entries, buffer::match_type match=buffer::match_case)
+		void set(const std::string &aNS, const std::initializer_list<const entry_ref> &entries, buffer::match_type match=buffer::match_case);
+
+		void set(const ns &aNS, const std::initializer_list<const entry_ref> &entries, buffer::match_type match=buffer::match_case)
 		{
-			mNodes[aNS] = std::make_pair(entries, match);
+			set(aNS.href, entries, match);
 		}
 
-		void set(const ns &aNS, const std::initializer_list<const entry_ref> &entries, buffer::match_type match=buffer::match_case)
+		const entry *lookup(const std::string &aNS, const cainteoir::buffer &aNode) const
 		{
-			mNodes[aNS.href] = std::make_pair(entries, match);
+			return lookup(namespace_id(aNS), aNode);
 		}
 
-		const entry *lookup(const std::string &aNS, const cainteoir::buffer &aNode) const;
+		const entry *lookup(uint32_t aNS, const cainteoir::buffer &aNode) const;
 	private:
-		typedef std::map<std::string, std::pair<std::initializer_list<const entry_ref>, buffer::match_type>>
-		        entries;
+		struct entry_set
+		{
+			uint32_t ns;
+			bool alias;
+			std::shared_ptr<const detail::entry_table> entries;
+		};
 
-		entries mNodes;
+		void set(uint32_t aNS, bool aAlias, const std::shared_ptr<const detail::entry_table> &aEntries);
+
+		std::vector<entry_set> mNodes;
 	};
 
 	extern const context::entry unknown_context;
@@ -285,10 +306,18 @@ namespace cainteoir { namespace xml
 
 		void read_node_value(char terminator1, char terminator2 = '\0');
 
+		void decode_node_value(const char *aStart, const char *aEnd);
+
+		std::shared_ptr<cainteoir::buffer> text_view(const char *aStart, const char *aEnd);
+
+		detail::text_buffer &text_arena();
+
 		void read_tag(node_type aType);
 
 		void reset_context();
 
+		uint32_t node_namespace_id() const;
+
 		enum ParserState
 		{
 			ParsingText,
@@ -325,6 +354,8 @@ namespace cainteoir { namespace xml
 		encoding mEncoding;
 
 		cainteoir::rope mNodeValue;
+		std::shared_ptr<cainteoir::buffer> mTextView;
+		std::shared_ptr<detail::text_buffer> mTextArena;
 		node_type mNodeType;
 
 		xml::context mNodes;
@@ -30,20 +30,26 @@
 #include <unistd.h>
 
 #include <stdexcept>
+#include <stdlib.h>
 #include <string.h>
 #include <errno.h>
 
 class mmap_buffer : public cainteoir::buffer
 {
 	int fd;
+	const char *mapped;
+	size_t mapped_size;
 public:
 	mmap_buffer(const char *path);
+	mmap_buffer(int aFD, off_t aOffset, off_t aSize);
 	~mmap_buffer();
 };
 
 mmap_buffer::mmap_buffer(const char *path)
 	: buffer(nullptr, nullptr)
 	, fd(-1)
+	, mapped(nullptr)
+	, mapped_size(0)
 {
 	fd = open(path, O_RDONLY);
 	if (fd == -1) throw std::runtime_error(strerror(errno));
@@ -55,15 +61,154 @@ mmap_buffer::mmap_buffer(const char *path)
 	if (first == MAP_FAILED) throw std::runtime_error(strerror(errno));
 
 	last = first + sb.st_size;
+	mapped = first;
+	mapped_size = sb.st_size;
+}
+
+// Map the file from the current read position. The file descriptor is owned
+// by the caller, and does not need to be kept open while the file is mapped.
+mmap_buffer::mmap_buffer(int aFD, off_t aOffset, off_t aSize)
+	: buffer(nullptr, nullptr)
+	, fd(-1)
+	, mapped(nullptr)
+	, mapped_size(aSize)
+{
+	mapped = (const char *)mmap(nullptr, aSize, PROT_READ, MAP_PRIVATE, aFD, 0);
+	if (mapped == MAP_FAILED) throw std::runtime_error(strerror(errno));
+
+	first = mapped + aOffset;
+	last  = mapped + aSize;
 }
 
 mmap_buffer::~mmap_buffer()
 {
 	if (fd != -1) close(fd);
-	if (first) munmap((void *)first, size());
+	if (mapped) munmap((void *)mapped, mapped_size);
+}
+
+// A buffer that grows geometrically as the data is read into it, so pipes can
+// be read without copying the data into intermediate buffers.
+class read_buffer : public cainteoir::buffer
+{
+	size_t capacity;
+public:
+	read_buffer();
+	~read_buffer();
+
+	// Get the unused space at the end of the buffer, growing the buffer if it
+	// is full.
+	char *reserve(size_t &aSize);
+
+	void commit(size_t aSize) { last += aSize; }
+
+	void shrink_to_fit();
+};
+
+read_buffer::read_buffer()
+	: buffer(nullptr, nullptr)
+	, capacity(0)
+{
+}
+
+read_buffer::~read_buffer()
+{
+	free((void *)first);
+}
+
+char *read_buffer::reserve(size_t &aSize)
+{
+	size_t used = size();
+	if (used == capacity)
+	{
+		size_t new_capacity = capacity == 0 ? 65536 : capacity * 2;
+		char *data = (char *)realloc((void *)first, new_capacity);
+		if (!data) throw std::bad_alloc();
+
+		first = data;
+		last  = data + used;
+		capacity = new_capacity;
+	}
+	aSize = capacity - used;
+	return (char *)last;
+}
+
+void read_buffer::shrink_to_fit()
+{
+	size_t used = size();
+	if (used == capacity || used == 0)
+		return;
+
+	char *data = (char *)realloc((void *)first, used);
+	if (!data)
+		return;
+
+	first = data;
+	last  = data + used;
+	capacity = used;
+}
+
+// Regular files are mapped into memory instead of being read. The file is
+// mapped from aOffset, as the file may have been partially read.
+static std::shared_ptr<cainteoir::buffer> map_file(int fd, off_t aOffset)
+{
+	struct stat sb;
+	if (aOffset == -1 || fstat(fd, &sb) == -1 || !S_ISREG(sb.st_mode) || sb.st_size <= aOffset)
+		return {};
+	return std::make_shared<mmap_buffer>(fd, aOffset, sb.st_size);
 }
 
 std::shared_ptr<cainteoir::buffer> cainteoir::make_file_buffer(const char *path)
 {
 	return std::make_shared<mmap_buffer>(path);
 }
+
+std::shared_ptr<cainteoir::buffer> cainteoir::make_file_buffer(FILE *f)
+{
+	int fd = fileno(f);
+	if (fd != -1)
+	{
+		auto mapped = map_file(fd, ftello(f));
+		if (mapped)
+		{
+			fseeko(f, 0, SEEK_END);
+			return mapped;
+		}
+	}
+
+	auto data = std::make_shared<read_buffer>();
+	size_t read = 0;
+	do
+	{
+		size_t size = 0;
+		char *next = data->reserve(size);
+		read = fread(next, 1, size, f);
+		data->commit(read);
+	} while (read != 0);
+
+	data->shrink_to_fit();
+	return data;
+}
+
+std::shared_ptr<cainteoir::buffer> cainteoir::make_file_buffer(int fd)
+{
+	auto mapped = map_file(fd, lseek(fd, 0, SEEK_CUR));
+	if (mapped)
+	{
+		lseek(fd, 0, SEEK_END);
+		return mapped;
+	}
+
+	auto data = std::make_shared<read_buffer>();
+	ssize_t read = 0;
+	do
+	{
+		size_t size = 0;
+		char *next = data->reserve(size);
+		read = ::read(fd, next, size);
+		if (read > 0)
+			data->commit(read);
+	} while (read > 0);
+
+	data->shrink_to_fit();
+	return data;
+}
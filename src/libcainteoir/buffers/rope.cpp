@@ -22,7 +22,6 @@
 #include "compatibility.hpp"
 
 #include <cainteoir/buffer.hpp>
-#include <unistd.h>
 
 void cainteoir::rope::clear()
 {
@@ -48,6 +47,9 @@ std::shared_ptr<cainteoir::buffer> cainteoir::rope::buffer() const
 	if (data.size() == 0)
 		return std::make_shared<cainteoir::buffer>(nullptr, nullptr);
 
+	if (data.size() == 1)
+		return data.front();
+
 	std::shared_ptr<cainteoir::buffer> temp = std::make_shared<cainteoir::data_buffer>(len);
 	char * startPos = (char *)temp->begin();
 	for (auto &node : data)
@@ -71,27 +73,3 @@ std::shared_ptr<cainteoir::buffer> cainteoir::rope::content() const
 
 	return (str == end) ? std::shared_ptr<cainteoir::buffer>() : text;
 }
-
-std::shared_ptr<cainteoir::buffer> cainteoir::make_file_buffer(FILE *f)
-{
-	cainteoir::rope data;
-	char buffer[1024];
-
-	size_t read = 0;
-	while ((read = fread(buffer, 1, sizeof(buffer), f)) != 0)
-		data += cainteoir::make_buffer(buffer, read);
-
-	return data.buffer();
-}
-
-std::shared_ptr<cainteoir::buffer> cainteoir::make_file_buffer(int fd)
-{
-	cainteoir::rope data;
-	char buffer[1024];
-
-	ssize_t read = 0;
-	while ((read = ::read(fd, buffer, sizeof(buffer))) > 0)
-		data += cainteoir::make_buffer(buffer, read);
-
-	return data.buffer();
-}
@@ -24,6 +24,79 @@
 #include <cainteoir/buffer.hpp>
 #include <zlib.h>
 #include <stdexcept>
+#include <algorithm>
+#include <limits>
+#include <cstdlib>
+
+static void throw_inflate_error(int ret)
+{
+	switch (ret)
+	{
+	case Z_STREAM_ERROR:
+		throw std::runtime_error(i18n("decompression failed (invalid compression level)"));
+	case Z_DATA_ERROR:
+		throw std::runtime_error(i18n("decompression failed (invalid or incomplete deflate data)"));
+	case Z_MEM_ERROR:
+		throw std::runtime_error(i18n("decompression failed (out of memory)"));
+	case Z_VERSION_ERROR:
+		throw std::runtime_error(i18n("decompression failed (zlib version mismatch)"));
+	default:
+		throw std::runtime_error(i18n("decompression failed (unspecified error)"));
+	}
+}
+
+// The zlib input size is 32-bit, so files larger than 4 GB are passed to zlib
+// in 4 GB windows.
+static void next_input_window(z_stream &strm, const char *end)
+{
+	if (strm.avail_in == 0)
+		strm.avail_in = std::min<size_t>(end - (const char *)strm.next_in, std::numeric_limits<uInt>::max());
+}
+
+// A gzip file can contain several compressed members, one after the other.
+static bool next_gzip_member(const z_stream &strm)
+{
+	return strm.avail_in >= 2 && strm.next_in[0] == 0x1F && strm.next_in[1] == 0x8B;
+}
+
+// A buffer that grows as the data is inflated into it.
+struct inflated_buffer : public cainteoir::buffer
+{
+	inflated_buffer(size_t aCapacity)
+		: cainteoir::buffer(nullptr, nullptr)
+		, mCapacity(aCapacity == 0 ? 1 : aCapacity)
+	{
+		first = last = (const char *)malloc(mCapacity);
+		if (!first)
+			throw std::bad_alloc();
+	}
+
+	~inflated_buffer()
+	{
+		free((void *)first);
+	}
+
+	void reserve(size_t aSize)
+	{
+		size_t used = size();
+		if (used + aSize > mCapacity)
+		{
+			size_t capacity = std::max(mCapacity * 2, used + aSize);
+			const char *data = (const char *)realloc((void *)first, capacity);
+			if (!data)
+				throw std::bad_alloc();
+			first = data;
+			last  = data + used;
+			mCapacity = capacity;
+		}
+	}
+
+	size_t capacity() const { return mCapacity - size(); }
+
+	void commit(size_t aSize) { last += aSize; }
+
+	size_t mCapacity;
+};
 
 static std::shared_ptr<cainteoir::buffer> inflateBuffer(const cainteoir::buffer &compressed, uint32_t uncompressed, int window)
 {
@@ -32,7 +105,7 @@ static std::shared_ptr<cainteoir::buffer> inflateBuffer(const cainteoir::buffer
 	z_stream strm = {0};
 	int ret = inflateInit2(&strm, window);
 	if (ret != Z_OK)
-		goto err;
+		throw_inflate_error(ret);
 
 	strm.avail_in = compressed.size();
 	strm.next_in = (Bytef *)compressed.begin();
@@ -44,25 +117,73 @@ static std::shared_ptr<cainteoir::buffer> inflateBuffer(const cainteoir::buffer
 	(void)inflateEnd(&strm);
 
 	if (ret != Z_STREAM_END)
-		goto err;
+		throw_inflate_error(ret);
 
 	return data;
+}
 
-err:
-	switch (ret)
+// Inflate the data in chunks, reusing the chunk memory, so the uncompressed
+// data does not need to be held in memory.
+struct inflate_reader : public cainteoir::buffer_reader
+{
+	inflate_reader(const std::shared_ptr<cainteoir::buffer> &aData, int aWindow)
+		: mData(aData)
+		, mStream()
+		, mStreamEnd(false)
+		, mMultipleMembers(aWindow > MAX_WBITS)
 	{
-	case Z_STREAM_ERROR:
-		throw std::runtime_error(i18n("decompression failed (invalid compression level)"));
-	case Z_DATA_ERROR:
-		throw std::runtime_error(i18n("decompression failed (invalid or incomplete deflate data)"));
-	case Z_MEM_ERROR:
-		throw std::runtime_error(i18n("decompression failed (out of memory)"));
-	case Z_VERSION_ERROR:
-		throw std::runtime_error(i18n("decompression failed (zlib version mismatch)"));
-	default:
-		throw std::runtime_error(i18n("decompression failed (unspecified error)"));
+		int ret = inflateInit2(&mStream, aWindow);
+		if (ret != Z_OK)
+			throw_inflate_error(ret);
+
+		mStream.next_in = (Bytef *)mData->begin();
+		next_input_window(mStream, mData->end());
+	}
+
+	~inflate_reader()
+	{
+		(void)inflateEnd(&mStream);
+	}
+
+	bool read()
+	{
+		while (!mStreamEnd)
+		{
+			mStream.avail_out = sizeof(mChunk);
+			mStream.next_out = (Bytef *)mChunk;
+
+			int ret = inflate(&mStream, Z_NO_FLUSH);
+			next_input_window(mStream, mData->end());
+			if (ret == Z_STREAM_END)
+			{
+				if (mMultipleMembers && next_gzip_member(mStream))
+				{
+					ret = inflateReset(&mStream);
+					if (ret != Z_OK)
+						throw_inflate_error(ret);
+				}
+				else
+					mStreamEnd = true;
+			}
+			else if (ret == Z_BUF_ERROR) // no more data
+				throw_inflate_error(Z_DATA_ERROR);
+			else if (ret != Z_OK)
+				throw_inflate_error(ret);
+
+			first = mChunk;
+			last  = mChunk + (sizeof(mChunk) - mStream.avail_out);
+			if (first != last)
+				return true;
+		}
+		return false;
 	}
-}
+
+	std::shared_ptr<cainteoir::buffer> mData;
+	z_stream mStream;
+	bool mStreamEnd;
+	bool mMultipleMembers;
+	char mChunk[65536];
+};
 
 std::shared_ptr<cainteoir::buffer> cainteoir::inflate_zlib(const cainteoir::buffer &data, uint32_t size)
 {
@@ -71,6 +192,54 @@ std::shared_ptr<cainteoir::buffer> cainteoir::inflate_zlib(const cainteoir::buff
 
 std::shared_ptr<cainteoir::buffer> cainteoir::inflate_gzip(const cainteoir::buffer &data, uint32_t size)
 {
-	size = *((uint32_t *)(data.end() - 4));
-	return inflateBuffer(data, size, 16 + MAX_WBITS);
+	// The ISIZE trailer is the uncompressed size modulo 2^32 of the last
+	// member, so it is only used as a hint for the initial buffer size. The
+	// hint is limited to the maximum deflate compression ratio in case the
+	// trailer is corrupt.
+	if (size == 0 && data.size() >= 18)
+		size = *((uint32_t *)(data.end() - 4));
+	uint64_t limit = (uint64_t)data.size() * 1032;
+	auto inflated = std::make_shared<inflated_buffer>(size < limit ? size : limit);
+
+	z_stream strm = z_stream();
+	int ret = inflateInit2(&strm, 16 + MAX_WBITS);
+	if (ret != Z_OK)
+		throw_inflate_error(ret);
+
+	strm.next_in = (Bytef *)data.begin();
+	next_input_window(strm, data.end());
+
+	do
+	{
+		if (inflated->capacity() == 0)
+			inflated->reserve(65536);
+
+		strm.avail_out = std::min<size_t>(inflated->capacity(), std::numeric_limits<uInt>::max());
+		strm.next_out = (Bytef *)inflated->end();
+
+		ret = inflate(&strm, Z_NO_FLUSH);
+		inflated->commit((const char *)strm.next_out - inflated->end());
+		next_input_window(strm, data.end());
+
+		if (ret == Z_STREAM_END && next_gzip_member(strm))
+			ret = inflateReset(&strm);
+		else if (ret == Z_BUF_ERROR && strm.avail_out != 0) // no more data
+			ret = Z_DATA_ERROR;
+	} while (ret == Z_OK || ret == Z_BUF_ERROR);
+	(void)inflateEnd(&strm);
+
+	if (ret != Z_STREAM_END)
+		throw_inflate_error(ret);
+
+	return inflated;
+}
+
+std::shared_ptr<cainteoir::buffer_reader> cainteoir::inflate_zlib_stream(const std::shared_ptr<cainteoir::buffer> &data, uint32_t)
+{
+	return std::make_shared<inflate_reader>(data, -MAX_WBITS);
+}
+
+std::shared_ptr<cainteoir::buffer_reader> cainteoir::inflate_gzip_stream(const std::shared_ptr<cainteoir::buffer> &data, uint32_t)
+{
+	return std::make_shared<inflate_reader>(data, 16 + MAX_WBITS);
 }
@@ -19,8 +19,40 @@
  */
 
 #include <cainteoir/buffer.hpp>
+#include <algorithm>
 
 std::shared_ptr<cainteoir::buffer> cainteoir::copy(const cainteoir::buffer &data, uint32_t size)
 {
 	return cainteoir::make_buffer(data.begin(), data.size());
 }
+
+// The chunks are views of the data, so are not copied.
+struct copy_reader : public cainteoir::buffer_reader
+{
+	copy_reader(const std::shared_ptr<cainteoir::buffer> &aData)
+		: mData(aData)
+		, mCurrent(aData->begin())
+	{
+	}
+
+	bool read()
+	{
+		static const size_t chunk_size = 65536;
+
+		if (mCurrent == mData->end())
+			return false;
+
+		first = mCurrent;
+		last  = mCurrent + std::min(chunk_size, (size_t)(mData->end() - mCurrent));
+		mCurrent = last;
+		return true;
+	}
+
+	std::shared_ptr<cainteoir::buffer> mData;
+	const char *mCurrent;
+};
+
+std::shared_ptr<cainteoir::buffer_reader> cainteoir::copy_stream(const std::shared_ptr<cainteoir::buffer> &data, uint32_t size)
+{
+	return std::make_shared<copy_reader>(data);
+}
@@ -135,6 +135,8 @@ const css::counter_style *css::style_manager::get_counter_style(const std::strin
 	auto item = mCounterStyles.find(aName);
 	if (item != mCounterStyles.end())
 		return item->second;
+	if (mBase)
+		return mBase->get_counter_style(aName);
 	return nullptr;
 }
 
@@ -0,0 +1,387 @@
+/* Compiled Pronunciation Dictionary Format.
+ *
+ * Copyright (C) 2015 Reece H. Dunn
+ *
+ * This file is part of cainteoir-engine.
+ *
+ * cainteoir-engine is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * cainteoir-engine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cainteoir-engine.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "compatibility.hpp"
+#include "dictionary_format.hpp"
+
+#include <map>
+#include <vector>
+#include <cstring>
+#include <stdexcept>
+
+namespace tts = cainteoir::tts;
+namespace ipa = cainteoir::ipa;
+
+static constexpr uint32_t DICTDB_HEADER_SIZE = 24;
+static constexpr uint32_t DICTDB_ENTRY_SIZE = 16;
+
+struct dictdb_entry
+{
+	uint32_t word;
+	uint16_t length;
+	uint8_t  type;
+	uint8_t  reserved;
+	uint32_t value;
+	uint32_t count;
+};
+
+static_assert(sizeof(dictdb_entry) == DICTDB_ENTRY_SIZE, "dictdb_entry is not packed");
+static_assert(sizeof(ipa::phoneme) == sizeof(uint64_t), "ipa::phoneme is not a packed feature word");
+
+static uint32_t hash_word(const char *aWord, std::size_t aLength)
+{
+	// DJB2 Hash Algorithm by Dan Bernstein:
+	uint32_t hash = 5381;
+	for (const char *c = aWord, *last = aWord + aLength; c != last; ++c)
+		hash = hash * 33 + (uint8_t)*c;
+	return hash;
+}
+
+// compiled dictionary lookup //////////////////////////////////////////////////
+
+tts::compiled_dictionary::compiled_dictionary(const std::shared_ptr<buffer> &aData)
+	: mData(aData)
+	, mBuckets(nullptr)
+	, mBucketMask(0)
+	, mEntries(nullptr)
+	, mSize(0)
+{
+	if (!mData || mData->size() < DICTDB_HEADER_SIZE)
+		throw std::runtime_error("unsupported compiled dictionary format");
+
+	const char *header = mData->begin();
+	if (strncmp(header, "DICTDB", 6) != 0 || *(const uint16_t *)(header + 6) != 0x3031)
+		throw std::runtime_error("unsupported compiled dictionary format");
+
+	uint32_t num_buckets = *(const uint32_t *)(header + 20);
+	if (num_buckets == 0 || (num_buckets & (num_buckets - 1)) != 0)
+		throw std::runtime_error("unsupported compiled dictionary format");
+
+	// The header values are validated here, so the lookups do not need to
+	// check that the entries are within the data.
+	uint64_t entries_offset = DICTDB_HEADER_SIZE + (uint64_t)num_buckets * sizeof(uint32_t);
+	mSize = *(const uint32_t *)(header + 8);
+	if (entries_offset + (uint64_t)mSize * DICTDB_ENTRY_SIZE > mData->size())
+		throw std::runtime_error("end of file");
+
+	mBuckets    = (const uint32_t *)(header + DICTDB_HEADER_SIZE);
+	mBucketMask = num_buckets - 1;
+	mEntries    = (const uint8_t *)(mBuckets + num_buckets);
+
+	for (const uint32_t *bucket = mBuckets, *last = mBuckets + num_buckets; bucket != last; ++bucket)
+	{
+		if (*bucket > mSize)
+			throw std::runtime_error("compiled dictionary entry is outside of the data");
+	}
+
+	for (std::size_t i = 0; i != mSize; ++i)
+	{
+		const dictdb_entry *item = (const dictdb_entry *)(mEntries + (i * DICTDB_ENTRY_SIZE));
+		uint64_t value_size = 0;
+		switch ((entry_type)item->type)
+		{
+		case entry_type::phonemes:
+			value_size = (uint64_t)item->count * sizeof(ipa::phoneme);
+			break;
+		case entry_type::say_as:
+			value_size = item->count;
+			break;
+		default:
+			break;
+		}
+
+		if ((uint64_t)item->word + item->length > mData->size() ||
+		    (uint64_t)item->value + value_size > mData->size())
+			throw std::runtime_error("compiled dictionary entry is outside of the data");
+	}
+}
+
+tts::compiled_dictionary::entry
+tts::compiled_dictionary::lookup(const char *aWord, std::size_t aLength) const
+{
+	if (aLength == 0) return {};
+
+	// The buckets contain the entry index + 1 (0 for an empty bucket), with
+	// collisions resolved by linear probing. The probing stops after every
+	// bucket has been checked, in case none of the buckets are empty.
+	uint32_t bucket = hash_word(aWord, aLength) & mBucketMask;
+	for (uint32_t n = 0; n <= mBucketMask; ++n)
+	{
+		uint32_t index = mBuckets[bucket];
+		if (index == 0)
+			break;
+
+		const dictdb_entry *item = (const dictdb_entry *)(mEntries + ((index - 1) * DICTDB_ENTRY_SIZE));
+		if (item->length == aLength && memcmp(mData->begin() + item->word, aWord, aLength) == 0)
+			return (*this)[index - 1];
+		bucket = (bucket + 1) & mBucketMask;
+	}
+	return {};
+}
+
+tts::compiled_dictionary::entry
+tts::compiled_dictionary::operator[](std::size_t aIndex) const
+{
+	if (aIndex >= mSize) return {};
+
+	const dictdb_entry *item = (const dictdb_entry *)(mEntries + (aIndex * DICTDB_ENTRY_SIZE));
+	const char *value = mData->begin() + item->value;
+
+	entry ret;
+	ret.type = (entry_type)item->type;
+	switch (ret.type)
+	{
+	case entry_type::phonemes:
+		ret.phonemes = { (const ipa::phoneme *)value, (const ipa::phoneme *)value + item->count };
+		break;
+	case entry_type::say_as:
+		ret.say_as = { value, value + item->count };
+		break;
+	default:
+		ret.type = entry_type::no_match;
+		break;
+	}
+	return ret;
+}
+
+cainteoir::buffer
+tts::compiled_dictionary::word(std::size_t aIndex) const
+{
+	if (aIndex >= mSize) return { nullptr, nullptr };
+
+	const dictdb_entry *item = (const dictdb_entry *)(mEntries + (aIndex * DICTDB_ENTRY_SIZE));
+	const char *word = mData->begin() + item->word;
+	return { word, word + item->length };
+}
+
+bool tts::compiled_dictionary::pronounce(const buffer &aWord,
+                                         const std::shared_ptr<tts::phoneme_reader> &aPronunciationRules,
+                                         ipa::phonemes &aPhonemes,
+                                         int depth) const
+{
+	auto entry = lookup(aWord);
+	switch (entry.type)
+	{
+	case entry_type::phonemes:
+		aPhonemes.assign(entry.phonemes.begin(), entry.phonemes.end());
+		return true;
+	case entry_type::say_as:
+		if (depth == 5)
+		{
+			fprintf(stderr, "error: too much recursion for entry '%s'.\n", aWord.str().c_str());
+			return false;
+		}
+		return pronounce(entry.say_as, aPronunciationRules, aPhonemes, depth + 1);
+	case entry_type::no_match:
+		return tts::pronounce_unmatched(std::make_shared<cainteoir::buffer>(aWord.begin(), aWord.end()),
+			aPronunciationRules, aPhonemes, depth,
+			[this, &aPronunciationRules](const std::shared_ptr<buffer> &aEntry, ipa::phonemes &aEntryPhonemes, int aDepth)
+			{
+				return pronounce(*aEntry, aPronunciationRules, aEntryPhonemes, aDepth);
+			});
+	}
+
+	return false;
+}
+
+// compiled dictionary reader //////////////////////////////////////////////////
+
+struct compiled_dictionary_reader : public tts::dictionary_reader
+{
+	compiled_dictionary_reader(const std::shared_ptr<cainteoir::buffer> &aData)
+		: mDictionary(aData)
+		, mCurrent(0)
+	{
+	}
+
+	bool read();
+private:
+	tts::compiled_dictionary mDictionary;
+	std::size_t mCurrent;
+};
+
+bool compiled_dictionary_reader::read()
+{
+	if (mCurrent == mDictionary.size())
+		return false;
+
+	auto match = mDictionary.word(mCurrent);
+	word = cainteoir::make_buffer(match.begin(), match.size());
+
+	auto value = mDictionary[mCurrent++];
+	entry = { cainteoir::object_type::dictionary };
+	switch (value.type)
+	{
+	case tts::compiled_dictionary::entry_type::phonemes:
+		entry.put("Entry::pronunciation", ipa::phonemes(value.phonemes.begin(), value.phonemes.end()));
+		break;
+	case tts::compiled_dictionary::entry_type::say_as:
+		entry.put("Entry::pronunciation", cainteoir::make_buffer(value.say_as.begin(), value.say_as.size()));
+		break;
+	default:
+		break;
+	}
+	return true;
+}
+
+std::shared_ptr<tts::dictionary_reader>
+tts::createCompiledDictionaryReader(const char *aDictionaryPath)
+{
+	auto data = cainteoir::make_file_buffer(aDictionaryPath);
+	if (!data) return {};
+
+	return std::make_shared<compiled_dictionary_reader>(data);
+}
+
+// compiled dictionary writer //////////////////////////////////////////////////
+
+struct compiled_entry_t
+{
+	tts::compiled_dictionary::entry_type type;
+	std::vector<uint64_t> phonemes;
+	std::string say_as;
+};
+
+void
+tts::compile_dictionary(const char *aFileName, FILE *aOutput)
+{
+	if (!aOutput) return;
+
+	auto reader = tts::createDictionaryReader(aFileName);
+	if (!reader)
+		throw std::runtime_error("unsupported dictionary format");
+
+	std::map<std::string, compiled_entry_t> words;
+	uint32_t num_phonemes = 0;
+	uint32_t string_size = 0;
+	while (reader->read())
+	{
+		std::string word = reader->word->str();
+		if (word.empty() || word.size() > 0xFFFF || words.find(word) != words.end())
+			continue;
+
+		const auto &value = reader->entry.get("Entry::pronunciation");
+		compiled_entry_t entry;
+		switch (value.type())
+		{
+		case cainteoir::object_type::phonemes:
+		case cainteoir::object_type::phonemes_ref:
+			entry.type = compiled_dictionary::entry_type::phonemes;
+			for (const auto &p : *value.phonemes())
+				entry.phonemes.push_back(p.get(ipa::main | ipa::diacritics | ipa::suprasegmentals));
+			num_phonemes += entry.phonemes.size();
+			break;
+		case cainteoir::object_type::buffer:
+		case cainteoir::object_type::buffer_ref:
+			entry.type = compiled_dictionary::entry_type::say_as;
+			entry.say_as = value.buffer()->str();
+			string_size += entry.say_as.size() + 1;
+			break;
+		default:
+			continue;
+		}
+
+		string_size += word.size() + 1;
+		words[word] = entry;
+	}
+
+	// Size the hash table to keep the load factor at or below 0.5.
+	uint32_t num_buckets = 1;
+	while (num_buckets < words.size() * 2)
+		num_buckets <<= 1;
+
+	uint32_t entries_offset = DICTDB_HEADER_SIZE + (num_buckets * sizeof(uint32_t));
+	uint32_t phonemes_offset = entries_offset + (words.size() * DICTDB_ENTRY_SIZE);
+	phonemes_offset = (phonemes_offset + 7) & ~7; // align to the phoneme feature size
+	uint32_t strings_offset = phonemes_offset + (num_phonemes * sizeof(uint64_t));
+
+	// Header
+
+	uint16_t endianness = 0x3031;
+	uint32_t num_entries = words.size();
+	fputs("DICTDB", aOutput);
+	fwrite(&endianness, sizeof(endianness), 1, aOutput);
+	fwrite(&num_entries, sizeof(num_entries), 1, aOutput);
+	fwrite(&phonemes_offset, sizeof(phonemes_offset), 1, aOutput);
+	fwrite(&strings_offset, sizeof(strings_offset), 1, aOutput);
+	fwrite(&num_buckets, sizeof(num_buckets), 1, aOutput);
+
+	// Hash Table
+
+	std::vector<uint32_t> buckets(num_buckets, 0);
+	uint32_t index = 0;
+	for (const auto &entry : words)
+	{
+		uint32_t bucket = hash_word(entry.first.c_str(), entry.first.size()) & (num_buckets - 1);
+		while (buckets[bucket] != 0)
+			bucket = (bucket + 1) & (num_buckets - 1);
+		buckets[bucket] = ++index;
+	}
+	fwrite(&buckets[0], sizeof(uint32_t), num_buckets, aOutput);
+
+	// Entries
+
+	uint32_t phoneme_pos = phonemes_offset;
+	uint32_t string_pos = strings_offset;
+	for (const auto &entry : words)
+	{
+		dictdb_entry item;
+		item.word = string_pos;
+		item.length = entry.first.size();
+		item.type = (uint8_t)entry.second.type;
+		item.reserved = 0;
+		string_pos += entry.first.size() + 1;
+		switch (entry.second.type)
+		{
+		case compiled_dictionary::entry_type::phonemes:
+			item.value = phoneme_pos;
+			item.count = entry.second.phonemes.size();
+			phoneme_pos += item.count * sizeof(uint64_t);
+			break;
+		default:
+			item.value = string_pos;
+			item.count = entry.second.say_as.size();
+			string_pos += item.count + 1;
+			break;
+		}
+		fwrite(&item, sizeof(item), 1, aOutput);
+	}
+
+	for (uint32_t pos = entries_offset + (num_entries * DICTDB_ENTRY_SIZE); pos != phonemes_offset; ++pos)
+		fputc(0, aOutput);
+
+	// Phonemes
+
+	for (const auto &entry : words)
+	{
+		if (!entry.second.phonemes.empty())
+			fwrite(&entry.second.phonemes[0], sizeof(uint64_t), entry.second.phonemes.size(), aOutput);
+	}
+
+	// Strings
+
+	for (const auto &entry : words)
+	{
+		fwrite(entry.first.c_str(), entry.first.size() + 1, 1, aOutput);
+		if (entry.second.type == compiled_dictionary::entry_type::say_as)
+			fwrite(entry.second.say_as.c_str(), entry.second.say_as.size() + 1, 1, aOutput);
+	}
+}
@@ -183,6 +183,55 @@ tts::dictionary::lookup(const key_type &aWord) const
 	return (match == mEntries.end()) ? no_match : match->second;
 }
 
+bool tts::pronounce_unmatched(const std::shared_ptr<buffer> &aWord,
+                              const std::shared_ptr<tts::phoneme_reader> &aPronunciationRules,
+                              ipa::phonemes &aPhonemes,
+                              int depth,
+                              const std::function<bool (const std::shared_ptr<buffer> &, ipa::phonemes &, int)> &aPronounce)
+{
+	multiword_entry words{ aWord, depth == 0
+	                            ? multiword_entry::hyphenated : multiword_entry::stressed };
+	if (words.is_multiword()) try
+	{
+		while (words.have_word())
+		{
+			const auto &entry = *words;
+
+			if (words.position() != 0 &&
+			    entry.stress == tts::initial_stress::unstressed)
+				aPhonemes.push_back(ipa::syllable_break);
+
+			ipa::phonemes phonemes;
+			if (aPronounce(entry.word, phonemes, depth + 1))
+				tts::make_stressed(phonemes, aPhonemes, entry.stress);
+			else
+				throw tts::phoneme_error("unable to pronounce the hyphenated word");
+
+			++words;
+		}
+		return true;
+	}
+	catch (const tts::phoneme_error &e)
+	{
+		aPhonemes.clear();
+	}
+
+	if (aPronunciationRules.get()) try
+	{
+		aPronunciationRules->reset(aWord);
+		while (aPronunciationRules->read())
+			aPhonemes.push_back(*aPronunciationRules);
+		return true;
+	}
+	catch (const tts::phoneme_error &e)
+	{
+		// Unable to pronounce the word using the ruleset, so fall
+		// through to the failure logic below.
+	}
+
+	return false;
+}
+
 bool tts::dictionary::pronounce(const std::shared_ptr<buffer> &aWord,
                                 const std::shared_ptr<tts::phoneme_reader> &aPronunciationRules,
                                 ipa::phonemes &aPhonemes,
@@ -202,47 +251,11 @@ bool tts::dictionary::pronounce(const std::shared_ptr<buffer> &aWord,
 		}
 		return pronounce(entry.buffer(), aPronunciationRules, aPhonemes, depth + 1);
 	case object_type::null: // no match
-		{
-			multiword_entry words{ aWord, depth == 0
-			                            ? multiword_entry::hyphenated : multiword_entry::stressed };
-			if (words.is_multiword()) try
-			{
-				while (words.have_word())
-				{
-					const auto &entry = *words;
-
-					if (words.position() != 0 &&
-					    entry.stress == tts::initial_stress::unstressed)
-						aPhonemes.push_back(ipa::syllable_break);
-
-					ipa::phonemes phonemes;
-					if (pronounce(entry.word, aPronunciationRules, phonemes, depth + 1))
-						tts::make_stressed(phonemes, aPhonemes, entry.stress);
-					else
-						throw tts::phoneme_error("unable to pronounce the hyphenated word");
-
-					++words;
-				}
-				return true;
-			}
-			catch (const tts::phoneme_error &e)
+		return tts::pronounce_unmatched(aWord, aPronunciationRules, aPhonemes, depth,
+			[this, &aPronunciationRules](const std::shared_ptr<buffer> &aEntry, ipa::phonemes &aEntryPhonemes, int aDepth)
 			{
-				aPhonemes.clear();
-			}
-		}
-		if (aPronunciationRules.get()) try
-		{
-			aPronunciationRules->reset(aWord);
-			while (aPronunciationRules->read())
-				aPhonemes.push_back(*aPronunciationRules);
-			return true;
-		}
-		catch (const tts::phoneme_error &e)
-		{
-			// Unable to pronounce the word using the ruleset, so fall
-			// through to the failure logic below.
-		}
-		break;
+				return pronounce(aEntry, aPronunciationRules, aEntryPhonemes, aDepth);
+			});
 	}
 
 	return false;
@@ -314,6 +327,8 @@ std::shared_ptr<tts::dictionary_reader> tts::createDictionaryReader(const char *
 	fclose(f);
 
 	auto header = std::make_shared<cainteoir::buffer>(data, data + n);
+	if (header->startswith("DICTDB"))
+		return createCompiledDictionaryReader(aDictionaryPath);
 	if (m::cainteoir.match(header))
 		return createCainteoirDictionaryReader(aDictionaryPath);
 	if (m::cmudict.match(header))
@@ -22,6 +22,7 @@
 #define CAINTEOIR_ENGINE_DICTIONARY_DICTIONARY_FORMAT_HPP
 
 #include <cainteoir/dictionary.hpp>
+#include <functional>
 
 namespace cainteoir { namespace tts
 {
@@ -31,6 +32,8 @@ namespace cainteoir { namespace tts
 
 	std::shared_ptr<dictionary_reader> createCMUDictionaryReader(const char *aDictionaryPath);
 
+	std::shared_ptr<dictionary_reader> createCompiledDictionaryReader(const char *aDictionaryPath);
+
 	// formatters
 
 	std::shared_ptr<dictionary_formatter> createCainteoirDictionaryFormatter(FILE *out);
@@ -40,6 +43,17 @@ namespace cainteoir { namespace tts
 	std::shared_ptr<dictionary_formatter> createEspeakDictionaryFormatter(FILE *out);
 
 	std::shared_ptr<dictionary_formatter> createDictionaryEntryFormatter(FILE *out);
+
+	// pronunciation
+
+	// Pronounce a word that does not have a dictionary entry. This is used by
+	// the dictionary implementations, with aPronounce looking up the words in
+	// a multi-word entry.
+	bool pronounce_unmatched(const std::shared_ptr<buffer> &aWord,
+	                         const std::shared_ptr<phoneme_reader> &aPronunciationRules,
+	                         ipa::phonemes &aPhonemes,
+	                         int depth,
+	                         const std::function<bool (const std::shared_ptr<buffer> &, ipa::phonemes &, int)> &aPronounce);
 }}
 
 #endif
@@ -24,21 +24,25 @@
 #include <cainteoir/document.hpp>
 #include <cainteoir/unicode.hpp>
 
-#include <iostream>
+#include <unordered_map>
+#include <pthread.h>
 
 namespace rdf  = cainteoir::rdf;
 namespace rql  = cainteoir::rdf::query;
 namespace utf8 = cainteoir::utf8;
 
-static inline cainteoir::document::const_iterator
-get_child(const cainteoir::document::list_type &children, size_t index)
-{
-	if (index == size_t(-1)) return children.end();
+// The document items are stored in fixed size chunks so that the items do not
+// move in memory when more of the document is read. This allows the iterators
+// to access the items that have been read without locking the document.
+static const size_t chunk_size = 256;
 
-	cainteoir::document::const_iterator pos = children.begin();
-	std::advance(pos, index);
-	return pos;
-}
+struct document_lock
+{
+	document_lock(pthread_mutex_t &aLock) : mLock(aLock) { pthread_mutex_lock(&mLock); }
+	~document_lock() { pthread_mutex_unlock(&mLock); }
+private:
+	pthread_mutex_t &mLock;
+};
 
 cainteoir::document_item &
 cainteoir::document_item::clear()
@@ -162,17 +166,140 @@ cainteoir::ref_entry::ref_entry(const rql::results &aEntry)
 	}
 }
 
+struct cainteoir::document::data
+{
+	data(const std::shared_ptr<document_reader> &aReader, rdf::graph &aMetadata);
+	~data();
+
+	const document_item *read_next();
+
+	bool read_until(size_t aCount);
+
+	std::shared_ptr<document_reader> reader;
+	rdf::graph *metadata;
+
+	std::vector<std::unique_ptr<document_item[]>> chunks;
+	size_t count;
+	size_t length;
+	// The index of the first item with each anchor. Later items with the same
+	// anchor do not replace it, so indexof returns the first item.
+	std::unordered_map<std::string, size_t> anchors;
+
+	pthread_mutex_t lock;
+};
+
+cainteoir::document::data::data(const std::shared_ptr<document_reader> &aReader, rdf::graph &aMetadata)
+	: reader(aReader)
+	, metadata(&aMetadata)
+	, count(0)
+	, length(0)
+{
+	pthread_mutex_init(&lock, nullptr);
+}
+
+cainteoir::document::data::~data()
+{
+	pthread_mutex_destroy(&lock);
+}
+
+const cainteoir::document_item *
+cainteoir::document::data::read_next()
+{
+	if (!reader) return nullptr;
+
+	try
+	{
+		if (!reader->read(metadata))
+		{
+			reader.reset();
+			return nullptr;
+		}
+	}
+	catch (...)
+	{
+		reader.reset();
+		throw;
+	}
+
+	if (count % chunk_size == 0)
+		chunks.emplace_back(new document_item[chunk_size]);
+
+	document_item &item = chunks.back()[count % chunk_size];
+	item = *reader;
+	++count;
+
+	if (item.type & cainteoir::events::anchor)
+		anchors.insert({ item.anchor.str(), count });
+	if (item.type & cainteoir::events::text)
+		length = item.range.end();
+	return &item;
+}
+
+bool cainteoir::document::data::read_until(size_t aCount)
+{
+	while (count < aCount)
+	{
+		if (!read_next())
+			return false;
+	}
+	return true;
+}
+
 cainteoir::document::document(const std::shared_ptr<document_reader> &aReader, rdf::graph &aMetadata)
-	: mLength(0)
+	: mData(std::make_shared<data>(aReader, aMetadata))
+{
+}
+
+cainteoir::document::metadata_lock::metadata_lock(const document &aDocument)
+	: mData(aDocument.mData)
+{
+	pthread_mutex_lock(&mData->lock);
+}
+
+cainteoir::document::metadata_lock::~metadata_lock()
 {
-	while (aReader->read(&aMetadata))
+	pthread_mutex_unlock(&mData->lock);
+}
+
+size_t cainteoir::document::text_length() const
+{
+	document_lock lock(mData->lock);
+	mData->read_until(size_t(-1));
+	return mData->length;
+}
+
+size_t cainteoir::document::size() const
+{
+	document_lock lock(mData->lock);
+	mData->read_until(size_t(-1));
+	return mData->count;
+}
+
+cainteoir::document::const_iterator
+cainteoir::document::at(size_t aIndex) const
+{
+	const_iterator item;
+	if (aIndex != size_t(-1))
+		fetch(item, aIndex);
+	return item;
+}
+
+void cainteoir::document::fetch(const_iterator &aItem, size_t aIndex) const
+{
+	document_lock lock(mData->lock);
+	if (!mData->read_until(aIndex + 1))
 	{
-		mChildren.push_back(*aReader);
-		if (aReader->type & cainteoir::events::anchor)
-			mAnchors[aReader->anchor.str()] = mChildren.size();
-		if (aReader->type & cainteoir::events::text)
-			mLength = aReader->range.end();
+		aItem = const_iterator();
+		return;
 	}
+
+	size_t first = aIndex - (aIndex % chunk_size);
+	const document_item *chunk = mData->chunks[aIndex / chunk_size].get();
+
+	aItem.mDocument = this;
+	aItem.mIndex = aIndex;
+	aItem.mItem = chunk + (aIndex - first);
+	aItem.mLast = chunk + std::min(chunk_size, mData->count - first);
 }
 
 cainteoir::document::range_type
@@ -184,7 +311,7 @@ cainteoir::document::children(const std::pair<const rdf::uri, const rdf::uri> &a
 	if (from == size_t(-1)) from = 0;
 	if (from > to) std::swap(from, to);
 
-	return range_type(get_child(mChildren, from), get_child(mChildren, to));
+	return range_type(at(from), at(to));
 }
 
 cainteoir::document::range_type
@@ -209,11 +336,11 @@ cainteoir::navigation(const rdf::graph &aMetadata,
 {
 	const rdf::uri *toc_entries = nullptr;
 
-	auto listings = rql::select(aMetadata,
-	                            rql::subject == aSubject && rql::predicate == rdf::ref("listing"));
+	const auto &listings = rql::select(aMetadata,
+	                                   rql::subject == aSubject && rql::predicate == rdf::ref("listing"));
 	for (auto &query : listings)
 	{
-		auto listing = rql::select(aMetadata, rql::subject == rql::object(query));
+		const auto &listing = rql::select(aMetadata, rql::subject == rql::object(query));
 		if (rql::contains(listing, rql::predicate == rdf::ref("type") && rql::object == aListing))
 		{
 			toc_entries = &rql::object(query);
@@ -234,8 +361,21 @@ cainteoir::navigation(const rdf::graph &aMetadata,
 
 size_t cainteoir::document::indexof(const rdf::uri &aAnchor) const
 {
-	auto at = mAnchors.find(aAnchor.str());
-	return (at == mAnchors.end()) ? size_t(-1) : at->second;
+	if (aAnchor.empty()) return size_t(-1);
+
+	const std::string anchor = aAnchor.str();
+
+	document_lock lock(mData->lock);
+	auto at = mData->anchors.find(anchor);
+	if (at != mData->anchors.end())
+		return at->second;
+
+	while (const document_item *item = mData->read_next())
+	{
+		if ((item->type & cainteoir::events::anchor) && item->anchor.str() == anchor)
+			return mData->count;
+	}
+	return size_t(-1);
 }
 
 struct document_range : public cainteoir::document_reader
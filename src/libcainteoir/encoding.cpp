@@ -84,6 +84,58 @@ static inline bool is_native_encoding(const std::string &encoding)
 	return !strcasecmp(encoding.c_str(), "utf-8") || !strcasecmp(encoding.c_str(), "us-ascii");
 }
 
+// Single-byte character sets (e.g. windows-1252 and cp437) are decoded using a
+// table of the UTF-8 sequences for each byte. The table is built using iconv
+// when the character set is selected. Bytes that are not valid in the
+// character set have an empty sequence, so are skipped.
+
+struct single_byte_decoder : public cainteoir::detail::decoder
+{
+	struct entry
+	{
+		uint8_t length;
+		char utf8[3]; // single-byte character sets map to the BMP
+	};
+
+	entry table[256];
+
+	void decode(const cainteoir::buffer &data, cainteoir::rope &decoded) const
+	{
+		size_t length = decoded_length(data);
+		if (length == 0)
+			return;
+
+		std::shared_ptr<cainteoir::buffer> ret = std::make_shared<cainteoir::data_buffer>(length);
+		convert(data, (char *)ret->begin());
+		decoded += ret;
+	}
+
+	void decode(const cainteoir::buffer &data, std::string &decoded) const
+	{
+		size_t offset = decoded.size();
+		decoded.resize(offset + decoded_length(data));
+		convert(data, &decoded[offset]);
+	}
+
+	size_t decoded_length(const cainteoir::buffer &data) const
+	{
+		size_t length = 0;
+		for (uint8_t c : data)
+			length += table[c].length;
+		return length;
+	}
+
+	void convert(const cainteoir::buffer &data, char *out) const
+	{
+		for (uint8_t c : data)
+		{
+			const entry &e = table[c];
+			for (int i = 0; i != e.length; ++i)
+				*out++ = e.utf8[i];
+		}
+	}
+};
+
 #ifdef HAVE_ICONV_H
 
 #include <iconv.h>
@@ -108,20 +160,35 @@ struct native_decoder : public cainteoir::detail::decoder
 	}
 
 	void decode(const cainteoir::buffer &data, cainteoir::rope &decoded) const
+	{
+		std::string ret;
+		decode(data, ret);
+		if (!ret.empty())
+			decoded += cainteoir::make_buffer(ret.c_str(), ret.size());
+	}
+
+	void decode(const cainteoir::buffer &data, std::string &decoded) const
 	{
 		char *in = (char *)data.begin();
 		size_t inlen = data.size();
 
-		char buffer[1024] = {0};
+		// Size the output from the input, growing it if the decoded text is
+		// larger than that.
+		size_t used = decoded.size();
+		decoded.resize(used + inlen * 2);
 		while (inlen != 0)
 		{
-			char *out = buffer;
-			size_t outlen = sizeof(buffer);
+			char *start = &decoded[used];
+			char *out = start;
+			size_t outlen = decoded.size() - used;
+
+			size_t ret = iconv(cvt, &in, &inlen, &out, &outlen);
+			used += out - start;
 
-			if (iconv(cvt, &in, &inlen, &out, &outlen) == (size_t)-1) switch (errno)
+			if (ret == (size_t)-1) switch (errno)
 			{
 			case E2BIG: // output buffer too small
-				// this is ok ... process in chunks
+				decoded.resize(decoded.size() * 2);
 				break;
 			case EILSEQ: // illegal character (multi-byte sequence)
 			case EINVAL: // incomplete multi-byte sequence
@@ -133,15 +200,51 @@ struct native_decoder : public cainteoir::detail::decoder
 			default:
 				throw std::runtime_error(strerror(errno));
 			}
+		}
+		decoded.resize(used);
+	}
 
-			if (outlen != sizeof(buffer))
-				decoded += cainteoir::make_buffer(buffer, sizeof(buffer) - outlen);
+	bool single_byte_table(single_byte_decoder::entry *table) const
+	{
+		bool single_byte = true;
+		for (int c = 0; c != 256 && single_byte; ++c)
+		{
+			char byte = c;
+			char *in = &byte;
+			size_t inlen = 1;
+			char *out = table[c].utf8;
+			size_t outlen = sizeof(table[c].utf8);
+
+			iconv(cvt, nullptr, nullptr, nullptr, nullptr);
+			if (iconv(cvt, &in, &inlen, &out, &outlen) == (size_t)-1)
+			{
+				// Multi-byte sequences and characters outside the BMP
+				// cannot be represented in the table.
+				if (errno != EILSEQ)
+					single_byte = false;
+			}
+			else if (out == table[c].utf8) // e.g. a shift sequence
+				single_byte = false;
+
+			table[c].length = out - table[c].utf8;
 		}
+		iconv(cvt, nullptr, nullptr, nullptr, nullptr);
+		return single_byte;
 	}
 
 	iconv_t cvt;
 };
 
+static std::shared_ptr<cainteoir::detail::decoder> create_decoder(const char *aEncoding)
+{
+	auto decoder = std::make_shared<native_decoder>(aEncoding);
+
+	auto table = std::make_shared<single_byte_decoder>();
+	if (decoder->single_byte_table(table->table))
+		return table;
+	return decoder;
+}
+
 #else
 
 struct native_decoder : public cainteoir::detail::decoder
@@ -156,16 +259,28 @@ struct native_decoder : public cainteoir::detail::decoder
 		// ascii pass-through.
 		throw std::runtime_error(i18n("unsupported character set"));
 	}
+
+	void decode(const cainteoir::buffer &data, std::string &decoded) const
+	{
+		throw std::runtime_error(i18n("unsupported character set"));
+	}
 };
 
+static std::shared_ptr<cainteoir::detail::decoder> create_decoder(const char *aEncoding)
+{
+	return std::make_shared<native_decoder>(aEncoding);
+}
+
 #endif
 
 cainteoir::encoding::encoding(int aCodepage)
+	: mNative(false)
 {
 	set_encoding(aCodepage);
 }
 
 cainteoir::encoding::encoding(const char *aEncoding)
+	: mNative(false)
 {
 	set_encoding(aEncoding);
 }
@@ -188,8 +303,9 @@ bool cainteoir::encoding::set_encoding(const char *aEncoding)
 	if (mEncoding == aEncoding)
 		return false;
 
-	mDecoder  = std::make_shared<native_decoder>(aEncoding);
+	mDecoder  = create_decoder(aEncoding);
 	mEncoding = aEncoding;
+	mNative   = is_native_encoding(mEncoding);
 	return true;
 }
 
@@ -202,7 +318,7 @@ std::shared_ptr<cainteoir::buffer> cainteoir::encoding::lookup(uint8_t c) const
 
 std::shared_ptr<cainteoir::buffer> cainteoir::encoding::decode(const std::shared_ptr<cainteoir::buffer> &data) const
 {
-	if (!data.get() || is_native_encoding(mEncoding))
+	if (!data.get() || mNative)
 		return data;
 
 	cainteoir::rope ret;
@@ -215,7 +331,7 @@ void cainteoir::encoding::decode(const std::shared_ptr<cainteoir::buffer> &data,
 	if (!data.get())
 		return;
 
-	if (is_native_encoding(mEncoding))
+	if (mNative)
 	{
 		decoded += data;
 		return;
@@ -223,3 +339,14 @@ void cainteoir::encoding::decode(const std::shared_ptr<cainteoir::buffer> &data,
 
 	mDecoder->decode(*data, decoded);
 }
+
+void cainteoir::encoding::decode(const cainteoir::buffer &data, std::string &decoded) const
+{
+	if (mNative)
+	{
+		decoded.append(data.begin(), data.end());
+		return;
+	}
+
+	mDecoder->decode(data, decoded);
+}
@@ -25,7 +25,9 @@
 #include <cainteoir/engines.hpp>
 #include <cainteoir/stopwatch.hpp>
 #include "tts_engine.hpp"
+#include "spsc_queue.hpp"
 #include <stdexcept>
+#include <atomic>
 
 static const int CHARACTERS_PER_WORD = 6;
 
@@ -45,6 +47,39 @@ static inline double percentageof(size_t a, size_t b)
 	return (double(a) / b) * 100.0;
 }
 
+// The speech is generated on a synthesis thread and written to the audio device
+// on an audio thread, so the synthesizer can run ahead of the audio output. The
+// text ranges and document events are passed through the queue with the audio
+// data so the callbacks are called when the associated audio is written.
+struct speech_event
+{
+	enum class type
+	{
+		audio,         // Audio data to write to the audio device.
+		text_range,    // The text range of the following audio data.
+		document_item, // A document event from the range being read.
+		progress,      // The end of the text block that has been spoken.
+	};
+
+	speech_event()
+		: kind(type::progress)
+		, range(0, 0)
+		, item(nullptr)
+		, offset(0)
+	{
+	}
+
+	type kind;
+	std::vector<short> samples;
+	cainteoir::range<uint32_t> range;
+	const cainteoir::document_item *item;
+	size_t offset;
+};
+
+// The number of events that the synthesis thread can run ahead of the audio
+// thread by.
+static const size_t SPEECH_EVENT_QUEUE_SIZE = 64;
+
 struct speech_impl : public tts::speech , public tts::synthesis_callback
 {
 	tts::engine *engine;
@@ -59,21 +94,32 @@ struct speech_impl : public tts::speech , public tts::synthesis_callback
 	std::vector<cainteoir::ref_entry>::const_iterator mRefEntryTo;
 	const cainteoir::ref_entry *mRefEntry;
 
-	tts::state_t speechState;
+	std::atomic<tts::state_t> speechState;
 	pthread_t threadId;
+	pthread_t synthesisId;
+	cainteoir::spsc_queue<speech_event, SPEECH_EVENT_QUEUE_SIZE> mEvents;
+	pthread_t loaderId;
+	bool mLoading;
 	std::string mErrorMessage;
+	mutable pthread_mutex_t mErrorLock;
+
+	// The engines that are not reentrant hold a lock while they are speaking,
+	// so the events are not waited on while the engine is speaking. The events
+	// that do not fit in the queue are pushed after the engine returns.
+	std::vector<speech_event> mPending;
+	bool mInEngine;
 
 	cainteoir::stopwatch mTimer; /* The time taken to read the document. */
 	double mElapsedTime; /* The amount of time elapsed since |mStartTime|. */
-	double mTotalTime; /* The (estimated) total amount of time to read the document. */
+	std::atomic<double> mTotalTime; /* The (estimated) total amount of time to read the document. */
 
-	double mProgress;  /* The percentage of the document read. */
+	std::atomic<double> mProgress;  /* The percentage of the document read. */
 
 	size_t currentOffset; /* The current offset from the beginning to the current block being read. */
 	size_t speakingPos;   /* The position within the block where the speaking is upto. */
 	size_t speakingLen;   /* The length of the word/fragment being spoken. */
 	size_t textOffset;    /* The starting offset of the text in the document item events. */
-	size_t textLen;       /* The length of the text range being read. */
+	std::atomic<size_t> textLen; /* The length of the text range being read (updated by the loader thread). */
 	int wordsPerMinute;   /* The speech rate of the current voice. */
 
 	speech_impl(tts::engine *aEngine,
@@ -88,6 +134,8 @@ struct speech_impl : public tts::speech , public tts::synthesis_callback
 
 	void preprocess_events(const cainteoir::document::range_type &aDocument);
 
+	void load_text_length();
+
 	cainteoir::document::const_iterator begin() const { return mFrom; }
 	cainteoir::document::const_iterator end()   const { return mTo; }
 
@@ -95,6 +143,14 @@ struct speech_impl : public tts::speech , public tts::synthesis_callback
 	void progress(size_t n);
 	void finished();
 
+	void dispatch(speech_event &event);
+
+	void push(speech_event &&event);
+
+	void error(const char *message);
+
+	void synthesize(cainteoir::buffer *text);
+
 	// tts::speech 
 
 	bool is_speaking() const;
@@ -131,8 +187,6 @@ static void * speak_tts_thread(void *data)
 
 	try
 	{
-		speak->started();
-
 		int depth = 0;
 		int media_overlay_depth = -1;
 		for (auto &node : *speak)
@@ -173,26 +227,16 @@ static void * speak_tts_thread(void *data)
 				switch (mode)
 				{
 				case tts::media_overlays_mode::tts_only:
-					speak->engine->speak(node.content.get(), 0, speak);
+					speak->synthesize(node.content.get());
 					break;
 				case tts::media_overlays_mode::tts_and_media_overlays:
 					if (media_overlay_depth == -1)
-						speak->engine->speak(node.content.get(), 0, speak);
+						speak->synthesize(node.content.get());
 					break;
 				}
 				speak->progress(node.range.end());
 			}
 
-			if (node.type & cainteoir::events::anchor && speak->mRefEntryFrom != speak->mRefEntryTo)
-			{
-				const auto &ref = *speak->mRefEntryFrom;
-				if (ref.location == node.anchor)
-				{
-					speak->mRefEntry = &ref;
-					++speak->mRefEntryFrom;
-				}
-			}
-
 			if (speak->state() == tts::stopped)
 				break;
 		}
@@ -200,13 +244,54 @@ static void * speak_tts_thread(void *data)
 	catch (const std::exception &e)
 	{
 		fprintf(stderr, "error: %s\n", e.what());
-		speak->mErrorMessage = e.what();
+		speak->error(e.what());
+	}
+
+	speak->mEvents.close();
+	return nullptr;
+}
+
+static void * speak_audio_thread(void *data)
+{
+	speech_impl *speak = (speech_impl *)data;
+
+	try
+	{
+		speak->started();
+
+		speech_event event;
+		while (speak->state() != tts::stopped && speak->mEvents.pop(event))
+			speak->dispatch(event);
+	}
+	catch (const std::exception &e)
+	{
+		fprintf(stderr, "error: %s\n", e.what());
+		speak->error(e.what());
+		speak->speechState = tts::stopped;
 	}
 
+	// Stop the synthesis thread if the audio was stopped before the end.
+	speak->mEvents.close();
+	pthread_join(speak->synthesisId, nullptr);
+
 	speak->finished();
 	return nullptr;
 }
 
+static void * load_document_thread(void *data)
+{
+	speech_impl *speak = (speech_impl *)data;
+	try
+	{
+		speak->load_text_length();
+	}
+	catch (const std::exception &)
+	{
+		// The error is reported by the thread speaking the document.
+	}
+	return nullptr;
+}
+
 speech_impl::speech_impl(tts::engine *aEngine,
                          std::shared_ptr<cainteoir::audio> aAudio,
                          const std::vector<cainteoir::ref_entry> &aListing,
@@ -218,6 +303,8 @@ speech_impl::speech_impl(tts::engine *aEngine,
 	: engine(aEngine)
 	, audio(aAudio)
 	, speechState(cainteoir::tts::speaking)
+	, mLoading(false)
+	, mInEngine(false)
 	, speakingPos(0)
 	, speakingLen(0)
 	, textOffset(-1)
@@ -231,6 +318,8 @@ speech_impl::speech_impl(tts::engine *aEngine,
 	, mMediaOverlays(aMediaOverlays)
 	, mCallback(callback)
 {
+	pthread_mutex_init(&mErrorLock, nullptr);
+
 	preprocess_events(aDocument.children());
 
 	if (mRefEntryFrom != mRefEntryTo)
@@ -241,38 +330,76 @@ speech_impl::speech_impl(tts::engine *aEngine,
 	}
 
 	started();
-	int ret = pthread_create(&threadId, nullptr, speak_tts_thread, (void *)this);
+
+	if (pthread_create(&synthesisId, nullptr, speak_tts_thread, (void *)this) != 0)
+		throw std::runtime_error(i18n("unable to create the speech synthesis thread."));
+	if (pthread_create(&threadId, nullptr, speak_audio_thread, (void *)this) != 0)
+	{
+		speechState = cainteoir::tts::stopped;
+		mEvents.close();
+		pthread_join(synthesisId, nullptr);
+		throw std::runtime_error(i18n("unable to create the speech audio thread."));
+	}
+
+	// The document is read as it is spoken, so calculate the length of the
+	// text to the end of the document in the background.
+	if (mTo == cainteoir::document::const_iterator() && mFrom != mTo)
+		mLoading = pthread_create(&loaderId, nullptr, load_document_thread, (void *)this) == 0;
 }
 
 speech_impl::~speech_impl()
 {
+	if (mLoading)
+		pthread_join(loaderId, nullptr);
+	pthread_mutex_destroy(&mErrorLock);
 }
 
 void speech_impl::preprocess_events(const cainteoir::document::range_type &aDocument)
 {
-	bool in_range = false;
-	for (auto &node : aDocument)
+	auto node = aDocument.begin();
+	for (; node != aDocument.end(); ++node)
 	{
-		if (in_range)
+		if (mCallback)
+			mCallback->onevent(*node);
+
+		if (node == mFrom)
 		{
-			if (node.type & cainteoir::events::text)
-			{
-				if (textOffset == -1)
-					textOffset = node.range.begin();
-				textLen = node.range.end();
-			}
+			++node;
+			break;
+		}
+	}
+
+	for (; node != aDocument.end(); ++node)
+	{
+		if (node->type & cainteoir::events::text)
+		{
+			if (textOffset == -1)
+				textOffset = node->range.begin();
+			textLen = node->range.end();
 
-			if (&node == &*mTo)
+			// The end of an unbounded range is found when loading the document.
+			if (mTo == aDocument.end())
 				return;
 		}
-		else
-		{
-			if (mCallback)
-				mCallback->onevent(node);
 
-			if (&node == &*mFrom)
-				in_range = true;
+		if (node == mTo)
+			return;
+	}
+}
+
+void speech_impl::load_text_length()
+{
+	for (auto node = mFrom; node != mTo; ++node)
+	{
+		if (node->type & cainteoir::events::text)
+		{
+			textLen = node->range.end();
+			if (mProgress <= 0.1) // not estimated from the speaking rate yet
+				mTotalTime = (double(textLen - textOffset) / CHARACTERS_PER_WORD / wordsPerMinute * 60.0);
 		}
+
+		if (speechState == cainteoir::tts::stopped)
+			return;
 	}
 }
 
@@ -288,8 +415,10 @@ void speech_impl::started()
 
 void speech_impl::progress(size_t n)
 {
-	currentOffset = n;
-	ontextrange({ 0, 0 });
+	speech_event event;
+	event.kind = speech_event::type::progress;
+	event.offset = n;
+	push(std::move(event));
 }
 
 void speech_impl::finished()
@@ -306,13 +435,24 @@ bool speech_impl::is_speaking() const
 void speech_impl::stop()
 {
 	speechState = cainteoir::tts::stopped;
+	mEvents.close();
 	pthread_join(threadId, nullptr);
+	if (mLoading)
+	{
+		pthread_join(loaderId, nullptr);
+		mLoading = false;
+	}
 }
 
 void speech_impl::wait()
 {
 	pthread_join(threadId, nullptr);
 	speechState = cainteoir::tts::stopped;
+	if (mLoading)
+	{
+		pthread_join(loaderId, nullptr);
+		mLoading = false;
+	}
 }
 
 double speech_impl::elapsedTime() const
@@ -340,7 +480,10 @@ size_t speech_impl::position() const
 
 std::string speech_impl::error_message() const
 {
-	return mErrorMessage;
+	pthread_mutex_lock(&mErrorLock);
+	std::string ret = mErrorMessage;
+	pthread_mutex_unlock(&mErrorLock);
+	return ret;
 }
 
 const cainteoir::ref_entry &speech_impl::context() const
@@ -355,32 +498,128 @@ tts::state_t speech_impl::state() const
 
 void speech_impl::onaudiodata(short *data, int nsamples)
 {
-	audio->write((const char *)data, nsamples*2);
+	speech_event event;
+	event.kind = speech_event::type::audio;
+	event.samples.assign(data, data + nsamples);
+	push(std::move(event));
 }
 
 void speech_impl::ontextrange(const cainteoir::range<uint32_t> &range)
 {
-	speakingPos = range.begin();
-	speakingLen = range.size();
+	speech_event event;
+	event.kind = speech_event::type::text_range;
+	event.range = range;
+	push(std::move(event));
+}
 
-	size_t actualPos = currentOffset + speakingPos;
+void speech_impl::onevent(const cainteoir::document_item &item)
+{
+	speech_event event;
+	event.kind = speech_event::type::document_item;
+	event.item = &item;
+	push(std::move(event));
+}
 
-	mElapsedTime = mTimer.elapsed();
-	mProgress = percentageof(actualPos - textOffset, textLen - textOffset);
+void speech_impl::synthesize(cainteoir::buffer *text)
+{
+	mInEngine = true;
+	try
+	{
+		engine->speak(text, 0, this);
+	}
+	catch (...)
+	{
+		mInEngine = false;
+		mPending.clear();
+		throw;
+	}
+	mInEngine = false;
 
-	if (mElapsedTime > 0.1 && mProgress > 0.1)
+	for (auto &event : mPending)
 	{
-		mTotalTime = (mElapsedTime / mProgress) * 100.0;
+		push(std::move(event));
+		if (speechState == cainteoir::tts::stopped)
+			break;
 	}
+	mPending.clear();
+}
 
-	if (mCallback)
-		mCallback->ontextrange({ (uint32_t)actualPos, (uint32_t)(actualPos + speakingLen) });
+void speech_impl::push(speech_event &&event)
+{
+	if (mInEngine)
+	{
+		if (mPending.empty() && mEvents.try_push(std::move(event)))
+			return;
+		if (mEvents.closed())
+			speechState = cainteoir::tts::stopped;
+		else
+			mPending.push_back(std::move(event));
+		return;
+	}
+
+	// The queue is closed when the audio thread stops, so there is nothing
+	// to synthesize the rest of the document for.
+	if (!mEvents.push(std::move(event)))
+		speechState = cainteoir::tts::stopped;
 }
 
-void speech_impl::onevent(const cainteoir::document_item &item)
+void speech_impl::error(const char *message)
+{
+	// Keep the first error, as any later errors are caused by it.
+	pthread_mutex_lock(&mErrorLock);
+	if (mErrorMessage.empty())
+		mErrorMessage = message;
+	pthread_mutex_unlock(&mErrorLock);
+}
+
+void speech_impl::dispatch(speech_event &event)
 {
-	if (mCallback)
-		mCallback->onevent(item);
+	switch (event.kind)
+	{
+	case speech_event::type::audio:
+		audio->write((const char *)event.samples.data(), event.samples.size()*2);
+		break;
+	case speech_event::type::progress:
+		currentOffset = event.offset;
+		event.range = { 0, 0 };
+		// fallthrough
+	case speech_event::type::text_range:
+		{
+			speakingPos = event.range.begin();
+			speakingLen = event.range.size();
+
+			size_t actualPos = currentOffset + speakingPos;
+
+			mElapsedTime = mTimer.elapsed();
+			mProgress = percentageof(actualPos - textOffset, textLen - textOffset);
+
+			if (mElapsedTime > 0.1 && mProgress > 0.1)
+			{
+				mTotalTime = (mElapsedTime / mProgress) * 100.0;
+			}
+
+			if (mCallback)
+				mCallback->ontextrange({ (uint32_t)actualPos, (uint32_t)(actualPos + speakingLen) });
+		}
+		break;
+	case speech_event::type::document_item:
+		{
+			const cainteoir::document_item &item = *event.item;
+			if (mCallback)
+				mCallback->onevent(item);
+
+			if (item.type & cainteoir::events::anchor && mRefEntryFrom != mRefEntryTo)
+			{
+				const auto &ref = *mRefEntryFrom;
+				if (ref.location == item.anchor)
+				{
+					mRefEntry = &ref;
+					++mRefEntryFrom;
+				}
+			}
+		}
+		break;
+	}
 }
 
 tts::engines::engines(rdf::graph &metadata)
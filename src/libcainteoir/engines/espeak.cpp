@@ -34,6 +34,7 @@ namespace ipa = cainteoir::ipa;
 #include <cainteoir/path.hpp>
 
 #include <espeak/speak_lib.h>
+#include <pthread.h>
 #include <unistd.h>
 #include <sstream>
 
@@ -435,11 +436,16 @@ bool espeak_engine::select_voice(const char *voicename, const std::string &phone
 	return false;
 }
 
+// eSpeak uses global state, so only one document can be spoken at a time.
+static pthread_mutex_t espeak_lock = PTHREAD_MUTEX_INITIALIZER;
+
 void espeak_engine::speak(cainteoir::buffer *text, size_t offset, tts::synthesis_callback *callback)
 {
 	std::string txt = text->str(); // null-terminate the text buffer
+	pthread_mutex_lock(&espeak_lock);
 	espeak_Synth(txt.c_str() + offset, txt.size() - offset, 0, POS_CHARACTER, 0, espeakCHARS_UTF8|espeakENDPAUSE, nullptr, callback);
 	espeak_Synchronize();
+	pthread_mutex_unlock(&espeak_lock);
 }
 
 std::shared_ptr<tts::phoneme_reader> espeak_engine::pronunciation()
@@ -33,8 +33,10 @@ namespace css = cainteoir::css;
 #if defined(HAVE_MBROLA)
 
 #include <cainteoir/path.hpp>
+#include <cainteoir/stopwatch.hpp>
 
 #include <sys/wait.h>
+#include <pthread.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <dirent.h>
@@ -190,81 +192,35 @@ ssize_t pipe_t::read(void *buf, size_t count, const procstat_t &proc, timeval ti
 	}
 }
 
-struct mbrola_synthesizer : public tts::synthesizer
+struct mbrola_process
 {
-	mbrola_synthesizer(const char *database,
-	                   std::shared_ptr<tts::prosody_writer> aWriter,
-	                   const char *aVolumeScale,
-	                   const std::vector<tts::unit_t> &aUnits,
-	                   cainteoir::range<const tts::phoneme_units *> aPhonemes);
-
-	~mbrola_synthesizer();
-
-	/** @name audio_info */
-	//@{
-
-	int channels() const { return 1; }
-
-	int frequency() const { return sample_rate; }
-
-	const rdf::uri &format() const { return sample_format; }
-
-	//@}
-	/** @name tts::synthesizer */
-	//@{
+	mbrola_process(const char *aDatabase,
+	               const char *aVolumeScale,
+	               const std::shared_ptr<tts::prosody_writer> &aWriter);
 
-	void bind(const std::shared_ptr<tts::prosody_reader> &aProsody);
+	~mbrola_process();
 
-	bool synthesize(cainteoir::audio *out);
+	bool is_alive() const;
 
-	//@}
-private:
 	void flush();
 
-	enum state_t
-	{
-		need_data,
-		have_data,
-		write_data,
-		read_errors,
-		read_error_line,
-	};
+	void drain();
 
 	pid_t pid;
 	procstat_t proc;
 	FILE *pho;
 	pipe_t audio;
 	pipe_t error;
-	state_t state;
-
-	char mMessage[512];
-	ssize_t mRead;
-	ssize_t mAvailable;
-	char *mCurrentMessage;
-
 	int sample_rate;
-	rdf::uri sample_format;
-
-	std::shared_ptr<tts::prosody_reader> prosody;
 	std::shared_ptr<tts::prosody_writer> writer;
-
-	const std::vector<tts::unit_t> &mUnits;
-	cainteoir::range<const tts::phoneme_units *> mPhonemes;
 };
 
-mbrola_synthesizer::mbrola_synthesizer(const char *aDatabase,
-                                       std::shared_ptr<tts::prosody_writer> aWriter,
-                                       const char *aVolumeScale,
-                                       const std::vector<tts::unit_t> &aUnits,
-                                       cainteoir::range<const tts::phoneme_units *> aPhonemes)
+mbrola_process::mbrola_process(const char *aDatabase,
+                               const char *aVolumeScale,
+                               const std::shared_ptr<tts::prosody_writer> &aWriter)
 	: pho(nullptr)
-	, state(need_data)
 	, sample_rate(0)
-	, sample_format(rdf::tts("s16le"))
 	, writer(aWriter)
-	, mUnits(aUnits)
-	, mPhonemes(aPhonemes)
-	, mCurrentMessage(mMessage)
 {
 	pipe_t input;
 
@@ -310,14 +266,278 @@ mbrola_synthesizer::mbrola_synthesizer(const char *aDatabase,
 	sample_rate = header[24] + (header[25] << 8) + (header[26] << 16) + (header[27] << 24);
 }
 
-mbrola_synthesizer::~mbrola_synthesizer()
+mbrola_process::~mbrola_process()
 {
 	fclose(pho);
+	audio.close(pipe_t::read_fd);
+	error.close(pipe_t::read_fd);
+	waitpid(pid, nullptr, 0);
+}
+
+bool mbrola_process::is_alive() const
+{
+	try
+	{
+		return proc.stat() != procstat_t::zombie;
+	}
+	catch (const std::runtime_error &)
+	{
+		return false;
+	}
+}
+
+void mbrola_process::flush()
+{
+	fputs("#\n", pho);
+	fflush(pho);
+}
+
+void mbrola_process::drain()
+{
+	// Discard any audio and error messages from a partially synthesized
+	// utterance so the next synthesizer using this process starts clean.
+
+	flush();
+
+	char data[1024];
+	while (audio.read(data, sizeof(data), proc) > 0)
+		;
+	while (error.read(data, sizeof(data), proc, { 0, 50 }) > 0)
+		;
+}
+
+struct mbrola_pool
+{
+	mbrola_pool(const char *aDatabase,
+	            const char *aVolumeScale,
+	            const std::vector<tts::unit_t> &aUnits);
+
+	~mbrola_pool();
+
+	void resize(int aPoolSize);
+
+	std::shared_ptr<mbrola_process> acquire();
+
+	void release(const std::shared_ptr<mbrola_process> &aProcess, bool aClean);
+
+	tts::synthesizer_pool_stats stats();
+private:
+	std::shared_ptr<mbrola_process> create_process();
+
+	const char *mDatabase;
+	const char *mVolumeScale;
+	const std::vector<tts::unit_t> &mUnits;
+
+	int mPoolSize; /* The number of processes to keep warm (0 = one per synthesizer). */
+	int mActive;   /* The number of processes used by active synthesizers. */
+	std::list<std::shared_ptr<mbrola_process>> mIdle;
+	tts::synthesizer_pool_stats mStats;
+
+	pthread_mutex_t mLock;
+	pthread_cond_t mReleased;
+};
+
+mbrola_pool::mbrola_pool(const char *aDatabase,
+                         const char *aVolumeScale,
+                         const std::vector<tts::unit_t> &aUnits)
+	: mDatabase(aDatabase)
+	, mVolumeScale(aVolumeScale)
+	, mUnits(aUnits)
+	, mPoolSize(0)
+	, mActive(0)
+	, mStats{ 0, 0, 0, 0.0 }
+{
+	pthread_mutex_init(&mLock, nullptr);
+	pthread_cond_init(&mReleased, nullptr);
+}
+
+mbrola_pool::~mbrola_pool()
+{
+	mIdle.clear();
+	pthread_cond_destroy(&mReleased);
+	pthread_mutex_destroy(&mLock);
+}
+
+void mbrola_pool::resize(int aPoolSize)
+{
+	pthread_mutex_lock(&mLock);
+	mPoolSize = aPoolSize < 0 ? 0 : aPoolSize;
+	while ((int)mIdle.size() + mActive > mPoolSize && !mIdle.empty())
+		mIdle.pop_back();
+	int missing = mPoolSize - (int)mIdle.size() - mActive;
+	pthread_cond_broadcast(&mReleased);
+	pthread_mutex_unlock(&mLock);
+
+	// Start the processes outside the lock, as loading the MBROLA database
+	// can take a while ...
+
+	std::list<std::shared_ptr<mbrola_process>> warm;
+	for (int i = 0; i < missing; ++i)
+		warm.push_back(create_process());
+
+	pthread_mutex_lock(&mLock);
+	mIdle.splice(mIdle.end(), warm);
+	pthread_cond_broadcast(&mReleased);
+	pthread_mutex_unlock(&mLock);
+}
+
+std::shared_ptr<mbrola_process> mbrola_pool::acquire()
+{
+	std::shared_ptr<mbrola_process> process;
+
+	pthread_mutex_lock(&mLock);
+	if (mPoolSize != 0 && mIdle.empty() && mActive >= mPoolSize)
+	{
+		cainteoir::stopwatch timer;
+		while (mPoolSize != 0 && mIdle.empty() && mActive >= mPoolSize)
+			pthread_cond_wait(&mReleased, &mLock);
+		++mStats.waits;
+		mStats.wait_time += timer.elapsed();
+	}
+
+	while (!mIdle.empty() && !process)
+	{
+		process = mIdle.front();
+		mIdle.pop_front();
+		if (!process->is_alive())
+			process.reset();
+	}
+
+	if (process)
+		++mStats.hits;
+	else
+		++mStats.misses;
+	++mActive;
+	pthread_mutex_unlock(&mLock);
+
+	if (!process) try
+	{
+		process = create_process();
+	}
+	catch (...)
+	{
+		pthread_mutex_lock(&mLock);
+		--mActive;
+		pthread_cond_signal(&mReleased);
+		pthread_mutex_unlock(&mLock);
+		throw;
+	}
+	return process;
+}
+
+void mbrola_pool::release(const std::shared_ptr<mbrola_process> &aProcess, bool aClean)
+{
+	pthread_mutex_lock(&mLock);
+	bool keep = mPoolSize != 0;
+	pthread_mutex_unlock(&mLock);
+
+	// Drain the process outside of the lock, as it waits on the process.
+	keep = keep && aProcess->is_alive();
+	if (keep && !aClean) try
+	{
+		aProcess->drain();
+	}
+	catch (const std::runtime_error &)
+	{
+		keep = false;
+	}
+
+	pthread_mutex_lock(&mLock);
+	--mActive;
+	if (keep && (int)mIdle.size() + mActive < mPoolSize)
+		mIdle.push_front(aProcess);
+	pthread_cond_signal(&mReleased);
+	pthread_mutex_unlock(&mLock);
+}
+
+tts::synthesizer_pool_stats mbrola_pool::stats()
+{
+	pthread_mutex_lock(&mLock);
+	tts::synthesizer_pool_stats ret = mStats;
+	pthread_mutex_unlock(&mLock);
+	return ret;
+}
+
+std::shared_ptr<mbrola_process> mbrola_pool::create_process()
+{
+	auto writer = tts::createPhoWriter(tts::create_unit_writer(mUnits, "_"));
+	return std::make_shared<mbrola_process>(mDatabase, mVolumeScale, writer);
+}
+
+struct mbrola_synthesizer : public tts::synthesizer
+{
+	mbrola_synthesizer(const std::shared_ptr<mbrola_pool> &aPool,
+	                   const std::vector<tts::unit_t> &aUnits,
+	                   cainteoir::range<const tts::phoneme_units *> aPhonemes);
+
+	~mbrola_synthesizer();
+
+	/** @name audio_info */
+	//@{
+
+	int channels() const { return 1; }
+
+	int frequency() const { return mProcess->sample_rate; }
+
+	const rdf::uri &format() const { return sample_format; }
+
+	//@}
+	/** @name tts::synthesizer */
+	//@{
+
+	void bind(const std::shared_ptr<tts::prosody_reader> &aProsody);
+
+	bool synthesize(cainteoir::audio *out);
+
+	//@}
+private:
+	enum state_t
+	{
+		need_data,
+		have_data,
+		write_data,
+		read_errors,
+		read_error_line,
+	};
+
+	std::shared_ptr<mbrola_pool> mPool;
+	std::shared_ptr<mbrola_process> mProcess;
+	state_t state;
+
+	char mMessage[512];
+	ssize_t mRead;
+	ssize_t mAvailable;
+	char *mCurrentMessage;
+
+	rdf::uri sample_format;
+
+	std::shared_ptr<tts::prosody_reader> prosody;
+
+	const std::vector<tts::unit_t> &mUnits;
+	cainteoir::range<const tts::phoneme_units *> mPhonemes;
+};
+
+mbrola_synthesizer::mbrola_synthesizer(const std::shared_ptr<mbrola_pool> &aPool,
+                                       const std::vector<tts::unit_t> &aUnits,
+                                       cainteoir::range<const tts::phoneme_units *> aPhonemes)
+	: mPool(aPool)
+	, mProcess(aPool->acquire())
+	, state(need_data)
+	, mCurrentMessage(mMessage)
+	, sample_format(rdf::tts("s16le"))
+	, mUnits(aUnits)
+	, mPhonemes(aPhonemes)
+{
+}
+
+mbrola_synthesizer::~mbrola_synthesizer()
+{
+	mPool->release(mProcess, state == need_data);
 }
 
 void mbrola_synthesizer::bind(const std::shared_ptr<tts::prosody_reader> &aProsody)
 {
-	prosody = tts::create_unit_reader(aProsody, mUnits, mPhonemes);
+	prosody = tts::create_prosody_reader(tts::create_unit_block_reader(tts::create_prosody_block_reader(aProsody), mUnits, mPhonemes));
 }
 
 bool mbrola_synthesizer::synthesize(cainteoir::audio *out)
@@ -335,12 +555,12 @@ bool mbrola_synthesizer::synthesize(cainteoir::audio *out)
 		{
 			if (state == need_data)
 				return false;
-			flush();
+			mProcess->flush();
 			state = write_data;
 			continue;
 		}
 
-		if (writer->write(*prosody))
+		if (mProcess->writer->write(*prosody))
 			state = have_data;
 
 		if (prosody->first.phoneme1 == ipa::intonation_break &&
@@ -348,13 +568,13 @@ bool mbrola_synthesizer::synthesize(cainteoir::audio *out)
 		{
 			if (state == have_data)
 			{
-				flush();
+				mProcess->flush();
 				state = write_data;
 			}
 		}
 		break;
 	case write_data:
-		read = audio.read(data, sizeof(data), proc);
+		read = mProcess->audio.read(data, sizeof(data), mProcess->proc);
 		if (read > 0)
 		{
 			if (out)
@@ -369,7 +589,7 @@ bool mbrola_synthesizer::synthesize(cainteoir::audio *out)
 		break;
 	case read_errors:
 		mAvailable = sizeof(mMessage) - (mCurrentMessage - mMessage);
-		mRead = error.read(mCurrentMessage, mAvailable, proc, { 0, 50 });
+		mRead = mProcess->error.read(mCurrentMessage, mAvailable, mProcess->proc, { 0, 50 });
 		state = (mRead > 0) ? read_error_line : write_data;
 		break;
 	case read_error_line:
@@ -415,12 +635,6 @@ bool mbrola_synthesizer::synthesize(cainteoir::audio *out)
 	}
 }
 
-void mbrola_synthesizer::flush()
-{
-	fputs("#\n", pho);
-	fflush(pho);
-}
-
 struct mbrola_voice : public tts::voice
 {
 	mbrola_voice(const std::shared_ptr<cainteoir::buffer> &aData,
@@ -439,6 +653,10 @@ struct mbrola_voice : public tts::voice
 	std::shared_ptr<tts::prosody_writer> unit_writer() { return mWriter; }
 
 	cainteoir::range<const tts::phoneme_units *> phones() { return mPhonemes; };
+
+	void set_pool_size(int aPoolSize) { mPool->resize(aPoolSize); }
+
+	tts::synthesizer_pool_stats pool_stats() { return mPool->stats(); }
 private:
 	char mDatabase[256];
 	std::string mVolumeScale;
@@ -449,6 +667,7 @@ private:
 	std::vector<tts::unit_t> mUnits;
 	cainteoir::range<const tts::phoneme_units *> mPhonemes;
 	std::shared_ptr<tts::pitch_model> mPitchModel;
+	std::shared_ptr<mbrola_pool> mPool;
 };
 
 mbrola_voice::mbrola_voice(const std::shared_ptr<cainteoir::buffer> &aData,
@@ -473,7 +692,7 @@ mbrola_voice::mbrola_voice(const std::shared_ptr<cainteoir::buffer> &aData,
 		data.seek(data.u32());
 		break;
 	case tts::DURATION_TABLE_MAGIC:
-		mDurations = tts::createDurationModel(data);
+		mDurations = tts::createDurationModel(data, aData);
 		break;
 	case tts::PHONEME_UNIT_TABLE_MAGIC:
 		read_phoneme_units(data, mUnits);
@@ -492,11 +711,13 @@ mbrola_voice::mbrola_voice(const std::shared_ptr<cainteoir::buffer> &aData,
 	default:
 		throw std::runtime_error("unsupported section in MBROLA voice file");
 	}
+
+	mPool = std::make_shared<mbrola_pool>(mDatabase, mVolumeScale.c_str(), mUnits);
 }
 
 std::shared_ptr<tts::synthesizer> mbrola_voice::synthesizer()
 {
-	return std::make_shared<mbrola_synthesizer>(mDatabase, mWriter, mVolumeScale.c_str(), mUnits, mPhonemes);
+	return std::make_shared<mbrola_synthesizer>(mPool, mUnits, mPhonemes);
 }
 
 std::shared_ptr<tts::prosody_reader>
@@ -32,6 +32,7 @@ namespace tts = cainteoir::tts;
 
 #include <picoapi.h>
 #include <cainteoir/path.hpp>
+#include <pthread.h>
 
 #define PICO_MEM_SIZE        2500000
 #define N_LINGWARE_RESOURCES 2
@@ -144,6 +145,10 @@ private:
 	pico_Resource mResources[N_LINGWARE_RESOURCES];
 	pico_Engine mEngine;
 	const voice_data *mSelectedVoice;
+
+	// The Pico engine is not reentrant, so only one document can be spoken at
+	// a time.
+	pthread_mutex_t mLock;
 };
 
 pico_engine::pico_engine(rdf::graph &metadata, std::string &baseuri, std::string &default_voice)
@@ -160,6 +165,8 @@ pico_engine::pico_engine(rdf::graph &metadata, std::string &baseuri, std::string
 	for (int i = 0; i < N_LINGWARE_RESOURCES; ++i)
 		mResources[i] = nullptr;
 
+	pthread_mutex_init(&mLock, nullptr);
+
 	mMemory = malloc(PICO_MEM_SIZE);
 	check_return(pico_initialize(mMemory, PICO_MEM_SIZE, &mSystem));
 
@@ -194,6 +201,7 @@ pico_engine::~pico_engine()
 		pico_terminate(&mSystem);
 		free(mMemory);
 	}
+	pthread_mutex_destroy(&mLock);
 }
 
 bool pico_engine::select_voice(const char *voicename, const std::string &phonemeset)
@@ -211,13 +219,23 @@ bool pico_engine::select_voice(const char *voicename, const std::string &phoneme
 
 void pico_engine::speak(cainteoir::buffer *text, size_t offset, tts::synthesis_callback *callback)
 {
-	if (speak_text(text->begin(), text->size(), callback))
+	pthread_mutex_lock(&mLock);
+	try
+	{
+		if (speak_text(text->begin(), text->size(), callback))
+		{
+			// Pico will only process the current sentence if it finds the next sentence
+			// break or a NULL character. Therefore, we force Pico to read the rest of the
+			// current buffer:
+			speak_text("\0", 1, callback);
+		}
+	}
+	catch (...)
 	{
-		// Pico will only process the current sentence if it finds the next sentence
-		// break or a NULL character. Therefore, we force Pico to read the rest of the
-		// current buffer:
-		speak_text("\0", 1, callback);
+		pthread_mutex_unlock(&mLock);
+		throw;
 	}
+	pthread_mutex_unlock(&mLock);
 }
 
 std::shared_ptr<tts::phoneme_reader> pico_engine::pronunciation()
@@ -0,0 +1,450 @@
+/* A unit concatenation synthesizer using TD-PSOLA.
+ *
+ * Copyright (C) 2015 Reece H. Dunn
+ *
+ * This file is part of cainteoir-engine.
+ *
+ * cainteoir-engine is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * cainteoir-engine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cainteoir-engine.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "compatibility.hpp"
+
+#include "../synthesizer/synth.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <cmath>
+
+namespace tts = cainteoir::tts;
+namespace ipa = cainteoir::ipa;
+namespace rdf = cainteoir::rdf;
+namespace rql = cainteoir::rdf::query;
+namespace css = cainteoir::css;
+
+// The unit audio and pitch marks stored in the voice database.
+struct unit_audio
+{
+	const int16_t *samples;
+	uint32_t num_samples;
+	const uint32_t *marks;
+	uint32_t num_marks;
+};
+
+struct psola_synthesizer : public tts::synthesizer
+{
+	psola_synthesizer(const std::vector<tts::unit_t> &aUnits,
+	                  cainteoir::range<const tts::phoneme_units *> aPhonemes,
+	                  const std::vector<unit_audio> &aAudio,
+	                  int aFrequency,
+	                  float aVolumeScale);
+
+	/** @name audio_info */
+	//@{
+
+	int channels() const { return 1; }
+
+	int frequency() const { return mFrequency; }
+
+	const rdf::uri &format() const { return mFormat; }
+
+	//@}
+	/** @name tts::synthesizer */
+	//@{
+
+	void bind(const std::shared_ptr<tts::prosody_reader> &aProsody);
+
+	bool synthesize(cainteoir::audio *out);
+
+	//@}
+private:
+	void add_unit(uint16_t aUnit, uint64_t aDuration);
+
+	void overlap_add(uint64_t aCenter, const unit_audio &aAudio, uint32_t aMark, uint32_t aPeriod);
+
+	float pitch_at(float aOffset) const;
+
+	void write(cainteoir::audio *out, uint64_t aEnd);
+
+	const std::vector<tts::unit_t> &mUnits;
+	cainteoir::range<const tts::phoneme_units *> mPhonemes;
+	const std::vector<unit_audio> &mAudio;
+
+	std::shared_ptr<tts::prosody_reader> mProsody;
+	rdf::uri mFormat;
+	int mFrequency;
+	float mVolumeScale;
+	uint32_t mMinPeriod;
+	uint32_t mMaxPeriod;
+
+	// The overlap-added output samples, starting at sample mBase.
+	std::vector<float> mOutput;
+	uint64_t mBase;
+
+	// The sample at which the next unit starts.
+	uint64_t mUnitStart;
+
+	// The sample at which the next pitch period is placed.
+	double mSynthMark;
+
+	// The Hann windows for each pitch period length.
+	std::vector<std::vector<float>> mWindows;
+	std::vector<short> mSamples;
+};
+
+psola_synthesizer::psola_synthesizer(const std::vector<tts::unit_t> &aUnits,
+                                     cainteoir::range<const tts::phoneme_units *> aPhonemes,
+                                     const std::vector<unit_audio> &aAudio,
+                                     int aFrequency,
+                                     float aVolumeScale)
+	: mUnits(aUnits)
+	, mPhonemes(aPhonemes)
+	, mAudio(aAudio)
+	, mFormat(rdf::tts("s16le"))
+	, mFrequency(aFrequency)
+	, mVolumeScale(aVolumeScale)
+	, mMinPeriod(aFrequency / 500)
+	, mMaxPeriod(aFrequency / 50)
+	, mBase(0)
+	, mUnitStart(0)
+	, mSynthMark(0)
+	, mWindows(mMaxPeriod + 1)
+{
+}
+
+void psola_synthesizer::bind(const std::shared_ptr<tts::prosody_reader> &aProsody)
+{
+	mProsody = tts::create_prosody_reader(tts::create_unit_block_reader(tts::create_prosody_block_reader(aProsody), mUnits, mPhonemes));
+}
+
+bool psola_synthesizer::synthesize(cainteoir::audio *out)
+{
+	if (!mProsody) return false;
+
+	bool have_data = false;
+	while (mProsody->read())
+	{
+		const auto &phone = mProsody->first;
+		uint64_t duration = phone.duration.as(css::time::seconds).value() * mFrequency;
+
+		if (phone.phoneme1.get(ipa::phoneme_type) == ipa::unit)
+		{
+			add_unit(phone.phoneme1.get(ipa::unit_value) >> 8, duration);
+			have_data = true;
+		}
+		else
+		{
+			mUnitStart += duration;
+			if (duration != 0)
+				have_data = true;
+		}
+
+		if (phone.phoneme1 == ipa::intonation_break && phone.phoneme2 == ipa::unspecified)
+			break;
+
+		// Write the audio for long phrases as it is generated. The samples
+		// before the previous pitch period will not change.
+		if (mSynthMark > mBase + mFrequency + mMaxPeriod)
+			write(out, mSynthMark - mMaxPeriod);
+	}
+
+	if (!have_data)
+		return false;
+
+	// Write the rest of the phrase, including the end of the last pitch period.
+	write(out, std::max(mUnitStart, mBase + mOutput.size()));
+	mUnitStart = mBase;
+	mSynthMark = mBase;
+	return true;
+}
+
+void psola_synthesizer::add_unit(uint16_t aUnit, uint64_t aDuration)
+{
+	if (aUnit >= mAudio.size() || aDuration == 0)
+	{
+		mUnitStart += aDuration;
+		return;
+	}
+
+	const unit_audio &audio = mAudio[aUnit];
+	const tts::unit_t &unit = mUnits[aUnit];
+	if (audio.num_marks == 0)
+	{
+		mUnitStart += aDuration;
+		return;
+	}
+
+	// The part of the phoneme this unit covers, for mapping the unit onto the
+	// phoneme's pitch envelope.
+	float phoneme_start = unit.phoneme_start;
+	float phoneme_end = 100;
+	if (aUnit + 1u < mUnits.size() && mUnits[aUnit + 1].phoneme_start > unit.phoneme_start)
+		phoneme_end = mUnits[aUnit + 1].phoneme_start;
+
+	// The part of the unit audio that is used.
+	double first = (double)audio.num_samples * unit.unit_start / 100.0;
+	double last  = (double)audio.num_samples * unit.unit_end / 100.0;
+
+	const uint64_t unit_end = mUnitStart + aDuration;
+	if (mSynthMark < mUnitStart)
+		mSynthMark = mUnitStart;
+
+	while (mSynthMark < unit_end)
+	{
+		double pos = (mSynthMark - mUnitStart) / aDuration;
+		uint32_t target = first + pos * (last - first);
+
+		// Find the analysis pitch mark closest to the target sample.
+		auto mark = std::lower_bound(audio.marks, audio.marks + audio.num_marks, target,
+			[](uint32_t a, uint32_t b) { return (a & tts::PITCH_MARK_OFFSET) < b; });
+		if (mark == audio.marks + audio.num_marks)
+			--mark;
+		else if (mark != audio.marks &&
+		         target - (mark[-1] & tts::PITCH_MARK_OFFSET) < (*mark & tts::PITCH_MARK_OFFSET) - target)
+			--mark;
+
+		uint32_t offset = *mark & tts::PITCH_MARK_OFFSET;
+		uint32_t period;
+		if (mark + 1 != audio.marks + audio.num_marks)
+			period = (mark[1] & tts::PITCH_MARK_OFFSET) - offset;
+		else if (mark != audio.marks)
+			period = offset - (mark[-1] & tts::PITCH_MARK_OFFSET);
+		else
+			period = mFrequency / 100;
+		period = std::min(std::max(period, mMinPeriod), mMaxPeriod);
+
+		overlap_add(mSynthMark, audio, offset, period);
+
+		float pitch = (*mark & tts::PITCH_MARK_VOICED) ? pitch_at(phoneme_start + pos * (phoneme_end - phoneme_start)) : 0;
+		if (pitch > 0)
+			mSynthMark += std::min(std::max((uint32_t)(mFrequency / pitch), mMinPeriod), mMaxPeriod);
+		else
+			mSynthMark += period;
+	}
+
+	mUnitStart = unit_end;
+}
+
+void psola_synthesizer::overlap_add(uint64_t aCenter, const unit_audio &aAudio, uint32_t aMark, uint32_t aPeriod)
+{
+	auto &window = mWindows[aPeriod];
+	if (window.empty())
+	{
+		window.resize(2 * aPeriod);
+		for (uint32_t i = 0; i < 2 * aPeriod; ++i)
+			window[i] = 0.5f - 0.5f * cos(M_PI * i / aPeriod);
+	}
+
+	uint64_t end = aCenter + aPeriod;
+	if (end - mBase > mOutput.size())
+		mOutput.resize(end - mBase, 0.0f);
+
+	// The window covers the samples [-aPeriod, aPeriod) around the pitch marks.
+	int64_t start = -(int64_t)std::min<uint64_t>(aPeriod, std::min<uint64_t>(aMark, aCenter - mBase));
+	int64_t stop  = std::min<int64_t>(aPeriod, (int64_t)aAudio.num_samples - aMark);
+
+	float *dst = &mOutput[aCenter - mBase];
+	const int16_t *src = aAudio.samples + aMark;
+	const float *w = &window[aPeriod];
+	for (int64_t i = start; i < stop; ++i)
+		dst[i] += w[i] * src[i];
+}
+
+float psola_synthesizer::pitch_at(float aOffset) const
+{
+	const auto &envelope = mProsody->envelope;
+	if (envelope.empty())
+		return 0;
+
+	if (aOffset <= envelope.front().offset)
+		return envelope.front().pitch.as(css::frequency::hertz).value();
+
+	for (size_t i = 1; i < envelope.size(); ++i)
+	{
+		if (aOffset <= envelope[i].offset)
+		{
+			float a = envelope[i - 1].pitch.as(css::frequency::hertz).value();
+			float b = envelope[i].pitch.as(css::frequency::hertz).value();
+			float t = (aOffset - envelope[i - 1].offset) / (envelope[i].offset - envelope[i - 1].offset);
+			return a + t * (b - a);
+		}
+	}
+
+	return envelope.back().pitch.as(css::frequency::hertz).value();
+}
+
+void psola_synthesizer::write(cainteoir::audio *out, uint64_t aEnd)
+{
+	if (aEnd <= mBase)
+		return;
+
+	size_t count = aEnd - mBase;
+	if (count > mOutput.size())
+		mOutput.resize(count, 0.0f);
+
+	mSamples.resize(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		float sample = mOutput[i] * mVolumeScale;
+		if (sample > 32767.0f)
+			mSamples[i] = 32767;
+		else if (sample < -32768.0f)
+			mSamples[i] = -32768;
+		else
+			mSamples[i] = (short)sample;
+	}
+
+	if (out)
+		out->write((const char *)&mSamples[0], count * sizeof(short));
+
+	mOutput.erase(mOutput.begin(), mOutput.begin() + count);
+	mBase = aEnd;
+}
+
+struct psola_voice : public tts::voice
+{
+	psola_voice(const std::shared_ptr<cainteoir::buffer> &aData,
+	            const rdf::graph &aMetadata,
+	            const rdf::uri &aVoice);
+
+	std::shared_ptr<tts::synthesizer> synthesizer();
+
+	std::shared_ptr<tts::duration_model> durations() { return mDurations; }
+
+	std::shared_ptr<tts::pitch_model> pitch_model() { return mPitchModel; }
+
+	std::shared_ptr<tts::prosody_reader>
+	unit_reader(const std::shared_ptr<tts::prosody_reader> &aProsody);
+
+	std::shared_ptr<tts::prosody_writer> unit_writer() { return mWriter; }
+
+	cainteoir::range<const tts::phoneme_units *> phones() { return mPhonemes; };
+
+	void set_pool_size(int) {}
+
+	tts::synthesizer_pool_stats pool_stats() { return { 0, 0, 0, 0.0 }; }
+private:
+	std::shared_ptr<tts::prosody_writer> mWriter;
+	std::shared_ptr<cainteoir::buffer> mData;
+	std::shared_ptr<tts::duration_model> mDurations;
+
+	std::vector<tts::unit_t> mUnits;
+	cainteoir::range<const tts::phoneme_units *> mPhonemes;
+	std::shared_ptr<tts::pitch_model> mPitchModel;
+
+	std::vector<unit_audio> mAudio;
+	int mFrequency;
+	float mVolumeScale;
+};
+
+psola_voice::psola_voice(const std::shared_ptr<cainteoir::buffer> &aData,
+                         const rdf::graph &aMetadata,
+                         const rdf::uri &aVoice)
+	: mData(aData)
+	, mPhonemes(nullptr, nullptr)
+{
+	const auto voice = rql::select(aMetadata, rql::subject == aVoice);
+	mFrequency = rql::select_value<int>(voice, rql::predicate == rdf::tts("frequency"));
+	mVolumeScale = rql::select_value<float>(voice, rql::predicate == rdf::tts("volumeScale"));
+
+	// The pitch periods are between 2ms and 20ms, so they are less than a
+	// sample long for lower frequencies.
+	if (mFrequency < 500)
+		throw std::runtime_error("the PSOLA voice frequency is too low");
+
+	auto phonemes = tts::create_unit_writer(mUnits, "_");
+	mWriter = tts::createPhoWriter(phonemes);
+
+	std::vector<std::pair<const char *, unit_audio>> audio;
+
+	cainteoir::native_endian_buffer data(aData);
+	data.seek(tts::VOICEDB_HEADER_SIZE);
+	while (!data.eof()) switch (data.magic())
+	{
+	case tts::STRING_TABLE_MAGIC:
+		data.seek(data.u32());
+		break;
+	case tts::DURATION_TABLE_MAGIC:
+		mDurations = tts::createDurationModel(data, aData);
+		break;
+	case tts::PHONEME_UNIT_TABLE_MAGIC:
+		read_phoneme_units(data, mUnits);
+		break;
+	case tts::PHONEME_TABLE_MAGIC:
+		mPhonemes = data.array<tts::phoneme_units>();
+		break;
+	case tts::PITCH_DATA_MAGIC:
+		{
+			css::frequency base{ data.f16_16(), css::frequency::hertz };
+			css::frequency step{ data.f16_16(), css::frequency::hertz };
+			css::frequency sdev{ data.f16_16(), css::frequency::hertz };
+			mPitchModel = std::make_shared<tts::pitch_model>(base, step, sdev);
+		}
+		break;
+	case tts::UNIT_AUDIO_TABLE_MAGIC:
+		{
+			uint16_t n = data.u16();
+			uint32_t data_size = data.u32();
+			for (uint16_t i = 0; i != n; ++i)
+			{
+				const char *name = data.pstr();
+				uint32_t samples = data.u32();
+				uint32_t num_samples = data.u32();
+				uint32_t marks = data.u32();
+				uint32_t num_marks = data.u32();
+				if (samples + num_samples * sizeof(int16_t) > aData->size() ||
+				    marks + num_marks * sizeof(uint32_t) > aData->size())
+					throw std::runtime_error("unit audio is outside the PSOLA voice file");
+
+				audio.push_back({ name, {
+					(const int16_t *)(aData->begin() + samples), num_samples,
+					(const uint32_t *)(aData->begin() + marks), num_marks
+				}});
+			}
+			data.seek(data.offset() + data_size);
+		}
+		break;
+	default:
+		throw std::runtime_error("unsupported section in PSOLA voice file");
+	}
+
+	// Index the unit audio by the unit table entries.
+	mAudio.reserve(mUnits.size());
+	for (const auto &unit : mUnits)
+	{
+		auto match = std::find_if(audio.begin(), audio.end(),
+			[&unit](const std::pair<const char *, unit_audio> &entry) { return !strcmp(entry.first, unit.name); });
+		if (match == audio.end())
+			throw std::runtime_error(std::string("no audio for unit `") + unit.name + "` in PSOLA voice file");
+		mAudio.push_back(match->second);
+	}
+}
+
+std::shared_ptr<tts::synthesizer> psola_voice::synthesizer()
+{
+	return std::make_shared<psola_synthesizer>(mUnits, mPhonemes, mAudio, mFrequency, mVolumeScale);
+}
+
+std::shared_ptr<tts::prosody_reader>
+psola_voice::unit_reader(const std::shared_ptr<tts::prosody_reader> &aProsody)
+{
+	return tts::create_unit_reader(aProsody, mUnits, mPhonemes);
+}
+
+std::shared_ptr<tts::voice>
+tts::create_psola_voice(const std::shared_ptr<cainteoir::buffer> &aData,
+                        const rdf::graph &aMetadata,
+                        const rdf::uri &aVoice)
+{
+	return std::make_shared<psola_voice>(aData, aMetadata, aVoice);
+}
@@ -0,0 +1,155 @@
+/* Bounded single-producer, single-consumer queue.
+ *
+ * Copyright (C) 2015 Reece H. Dunn
+ *
+ * This file is part of cainteoir-engine.
+ *
+ * cainteoir-engine is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * cainteoir-engine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cainteoir-engine.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CAINTEOIR_ENGINE_SPSC_QUEUE_HPP
+#define CAINTEOIR_ENGINE_SPSC_QUEUE_HPP
+
+#include <atomic>
+#include <pthread.h>
+
+namespace cainteoir
+{
+	// A ring buffer passing items from one producer thread to one consumer
+	// thread. The items are passed without locking. The lock is only used to
+	// block the producer when the queue is full and the consumer when the
+	// queue is empty.
+	template <typename T, std::size_t N>
+	class spsc_queue
+	{
+	public:
+		spsc_queue()
+			: mHead(0)
+			, mTail(0)
+			, mClosed(false)
+			, mProducerWaiting(false)
+			, mConsumerWaiting(false)
+		{
+			pthread_mutex_init(&mLock, nullptr);
+			pthread_cond_init(&mChanged, nullptr);
+		}
+
+		~spsc_queue()
+		{
+			pthread_cond_destroy(&mChanged);
+			pthread_mutex_destroy(&mLock);
+		}
+
+		// Add an item to the queue, waiting while the queue is full. Returns
+		// false if the queue has been closed.
+		bool push(T &&aItem)
+		{
+			std::size_t tail = mTail.load(std::memory_order_relaxed);
+			while (tail - mHead.load(std::memory_order_acquire) == N)
+			{
+				if (!wait_while(mProducerWaiting, [this, tail]() { return tail - mHead.load() == N; }))
+					return false;
+			}
+			if (mClosed.load(std::memory_order_acquire))
+				return false;
+
+			mItems[tail % N] = std::move(aItem);
+			mTail.store(tail + 1, std::memory_order_seq_cst);
+			notify(mConsumerWaiting);
+			return true;
+		}
+
+		// Add an item to the queue without waiting. Returns false if the queue
+		// is full or has been closed, in which case aItem is not moved from.
+		bool try_push(T &&aItem)
+		{
+			std::size_t tail = mTail.load(std::memory_order_relaxed);
+			if (tail - mHead.load(std::memory_order_acquire) == N)
+				return false;
+			if (mClosed.load(std::memory_order_acquire))
+				return false;
+
+			mItems[tail % N] = std::move(aItem);
+			mTail.store(tail + 1, std::memory_order_seq_cst);
+			notify(mConsumerWaiting);
+			return true;
+		}
+
+		// Remove an item from the queue, waiting while the queue is empty.
+		// Returns false if the queue is empty and has been closed.
+		bool pop(T &aItem)
+		{
+			std::size_t head = mHead.load(std::memory_order_relaxed);
+			while (mTail.load(std::memory_order_acquire) == head)
+			{
+				if (!wait_while(mConsumerWaiting, [this, head]() { return mTail.load() == head; }))
+				{
+					if (mTail.load(std::memory_order_acquire) == head)
+						return false;
+				}
+			}
+
+			aItem = std::move(mItems[head % N]);
+			mHead.store(head + 1, std::memory_order_seq_cst);
+			notify(mProducerWaiting);
+			return true;
+		}
+
+		// Stop adding items to the queue, waking any waiting threads. The
+		// consumer can read the items that are in the queue.
+		void close()
+		{
+			pthread_mutex_lock(&mLock);
+			mClosed.store(true);
+			pthread_cond_broadcast(&mChanged);
+			pthread_mutex_unlock(&mLock);
+		}
+
+		bool closed() const { return mClosed.load(); }
+	private:
+		template <typename Predicate>
+		bool wait_while(std::atomic<bool> &aWaiting, Predicate aBlocked)
+		{
+			pthread_mutex_lock(&mLock);
+			aWaiting.store(true);
+			while (aBlocked() && !mClosed.load())
+				pthread_cond_wait(&mChanged, &mLock);
+			aWaiting.store(false);
+			bool open = !mClosed.load();
+			pthread_mutex_unlock(&mLock);
+			return open;
+		}
+
+		void notify(const std::atomic<bool> &aWaiting)
+		{
+			if (aWaiting.load())
+			{
+				pthread_mutex_lock(&mLock);
+				pthread_cond_broadcast(&mChanged);
+				pthread_mutex_unlock(&mLock);
+			}
+		}
+
+		T mItems[N];
+		std::atomic<std::size_t> mHead;
+		std::atomic<std::size_t> mTail;
+		std::atomic<bool> mClosed;
+		std::atomic<bool> mProducerWaiting;
+		std::atomic<bool> mConsumerWaiting;
+		pthread_mutex_t mLock;
+		pthread_cond_t mChanged;
+	};
+}
+
+#endif
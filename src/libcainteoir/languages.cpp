@@ -25,7 +25,12 @@
 #include <cainteoir/locale.hpp>
 #include <cainteoir/document.hpp>
 #include <cainteoir/path.hpp>
+#include <unordered_map>
 #include <algorithm>
+#include <stdexcept>
+#include <cstring>
+#include <vector>
+#include <map>
 
 namespace rdf  = cainteoir::rdf;
 namespace rql  = cainteoir::rdf::query;
@@ -54,58 +59,234 @@ static std::string capitalize(std::string s)
 	return s;
 }
 
+// Language Subtag Registry Compiler ///////////////////////////////////////////
+
+static constexpr uint32_t SUBTAGDB_HEADER_SIZE = 20;
+static constexpr uint32_t SUBTAGDB_ENTRY_SIZE = 8;
+
+struct subtagdb_entry
+{
+	uint32_t code;
+	uint32_t value;
+};
+
+static_assert(sizeof(subtagdb_entry) == SUBTAGDB_ENTRY_SIZE, "subtagdb_entry is not packed");
+
+static uint32_t write_entries(const std::map<std::string, std::string> &aEntries,
+                              uint32_t aStringPos,
+                              FILE *aOutput)
+{
+	for (const auto &entry : aEntries)
+	{
+		subtagdb_entry item;
+		item.code = aStringPos;
+		aStringPos += entry.first.size() + 1;
+		item.value = aStringPos;
+		aStringPos += entry.second.size() + 1;
+		fwrite(&item, sizeof(item), 1, aOutput);
+	}
+	return aStringPos;
+}
+
+static void write_strings(const std::map<std::string, std::string> &aEntries, FILE *aOutput)
+{
+	for (const auto &entry : aEntries)
+	{
+		fwrite(entry.first.c_str(),  entry.first.size()  + 1, 1, aOutput);
+		fwrite(entry.second.c_str(), entry.second.size() + 1, 1, aOutput);
+	}
+}
+
+void lang::compile_subtag_registry(const char *aFileName, FILE *aOutput)
+{
+	if (!aOutput) return;
+
+	rdf::graph data;
+	if (!cainteoir::createDocumentReader(aFileName, data, std::string()))
+		throw std::runtime_error(i18n("unsupported language subtag registry format"));
+
+	// Collect the statements for each subtag in a single pass over the graph.
+
+	struct subtag_t
+	{
+		std::string code;
+		std::string label;
+		std::string prefix;
+	};
+
+	std::unordered_map<std::string, subtag_t> statements;
+	std::vector<std::pair<std::string, bool>> types;
+	for (auto &query : data)
+	{
+		const rdf::uri &predicate = rql::predicate(query);
+		if (predicate == rdf::rdf("type"))
+		{
+			types.push_back({ rql::subject(query).str(), rql::object(query) == rdf::iana("ExtLang") });
+			continue;
+		}
+
+		if (predicate.ns != rdf::iana.href)
+			continue;
+
+		auto &subtag = statements[rql::subject(query).str()];
+		if (predicate.ref == "code" && subtag.code.empty())
+			subtag.code = rql::value(query);
+		else if (predicate.ref == "label" && subtag.label.empty())
+			subtag.label = rql::value(query);
+		else if (predicate.ref == "prefix" && subtag.prefix.empty())
+			subtag.prefix = rql::value(query);
+	}
+
+	std::map<std::string, std::string> subtags;
+	std::map<std::string, std::string> extlangs;
+	for (auto &type : types)
+	{
+		const auto &subtag = statements[type.first];
+		subtags[subtag.code] = subtag.label;
+		if (type.second)
+			extlangs.insert({ subtag.code, subtag.prefix });
+	}
+
+	// Header
+
+	uint16_t endianness = 0x3031;
+	uint32_t num_subtags = subtags.size();
+	uint32_t num_extlangs = extlangs.size();
+	uint32_t strings_offset = SUBTAGDB_HEADER_SIZE + ((num_subtags + num_extlangs) * SUBTAGDB_ENTRY_SIZE);
+	fputs("TAGSDB", aOutput);
+	fwrite(&endianness, sizeof(endianness), 1, aOutput);
+	fwrite(&num_subtags, sizeof(num_subtags), 1, aOutput);
+	fwrite(&num_extlangs, sizeof(num_extlangs), 1, aOutput);
+	fwrite(&strings_offset, sizeof(strings_offset), 1, aOutput);
+
+	// Subtag and ExtLang Tables
+
+	uint32_t string_pos = write_entries(subtags, strings_offset, aOutput);
+	write_entries(extlangs, string_pos, aOutput);
+
+	// Strings
+
+	write_strings(subtags, aOutput);
+	write_strings(extlangs, aOutput);
+}
+
+// Language Subtag Registry ////////////////////////////////////////////////////
+
 struct LanguageData
 {
 	LanguageData();
 
-	std::map<std::string, std::string> subtags;
-	std::map<std::string, lang::tag> extlangs;
+	const char *subtag(const std::string &aCode) const
+	{
+		return lookup(mSubtags, mSubtagCount, aCode);
+	}
+
+	const char *extlang_prefix(const std::string &aCode) const
+	{
+		return lookup(mExtLangs, mExtLangCount, aCode);
+	}
+private:
+	const char *lookup(const subtagdb_entry *aEntries, uint32_t aCount, const std::string &aCode) const;
+
+	std::shared_ptr<cainteoir::buffer> mData;
+	const subtagdb_entry *mSubtags;
+	uint32_t mSubtagCount;
+	const subtagdb_entry *mExtLangs;
+	uint32_t mExtLangCount;
 };
 
 LanguageData::LanguageData()
+	: mSubtags(nullptr)
+	, mSubtagCount(0)
+	, mExtLangs(nullptr)
+	, mExtLangCount(0)
 {
-	rdf::graph data;
 	try
 	{
-		auto path = cainteoir::get_data_path() / "languages.rdf.gz";
-		cainteoir::createDocumentReader(path, data, std::string());
+		// Use the compiled registry if it is installed, otherwise compile the
+		// registry when it is first used.
+		try
+		{
+			mData = cainteoir::make_file_buffer(cainteoir::get_data_path() / "languages.sdb");
+		}
+		catch (const std::exception &)
+		{
+			cainteoir::memory_file out;
+			lang::compile_subtag_registry(cainteoir::get_data_path() / "languages.rdf.gz", out);
+			mData = out.buffer();
+		}
+
+		const char *header = mData->begin();
+		if (mData->size() < SUBTAGDB_HEADER_SIZE ||
+		    strncmp(header, "TAGSDB", 6) != 0 || *(const uint16_t *)(header + 6) != 0x3031)
+			throw std::runtime_error(i18n("unsupported language subtag registry format"));
+
+		uint32_t num_subtags  = *(const uint32_t *)(header + 8);
+		uint32_t num_extlangs = *(const uint32_t *)(header + 12);
+		uint64_t num_entries = (uint64_t)num_subtags + num_extlangs;
+		if (SUBTAGDB_HEADER_SIZE + num_entries * SUBTAGDB_ENTRY_SIZE > mData->size())
+			throw std::runtime_error("end of file");
+
+		// The strings are validated here, so the lookups do not need to check
+		// that they are within the data. The string table must end with a NUL
+		// so the last string is terminated.
+		const subtagdb_entry *entries = (const subtagdb_entry *)(header + SUBTAGDB_HEADER_SIZE);
+		if (mData->end()[-1] != '\0')
+			throw std::runtime_error(i18n("unsupported language subtag registry format"));
+
+		for (const subtagdb_entry *entry = entries, *last = entries + num_entries; entry != last; ++entry)
+		{
+			if (entry->code >= mData->size() || entry->value >= mData->size())
+				throw std::runtime_error(i18n("unsupported language subtag registry format"));
+		}
+
+		mSubtags      = entries;
+		mSubtagCount  = num_subtags;
+		mExtLangs     = entries + num_subtags;
+		mExtLangCount = num_extlangs;
 	}
 	catch (const std::exception & e)
 	{
 		printf("error: %s\n", e.what());
 	}
+}
 
-	for (auto &language : rql::select(data, rql::predicate == rdf::rdf("type")))
+const char *LanguageData::lookup(const subtagdb_entry *aEntries, uint32_t aCount, const std::string &aCode) const
+{
+	int begin = 0;
+	int end = aCount - 1;
+
+	while (begin <= end)
 	{
-		rql::results statements = rql::select(data, rql::subject == rql::subject(language));
-		auto id     = rql::select_value<std::string>(statements, rql::predicate == rdf::iana("code"));
-		auto name   = rql::select_value<std::string>(statements, rql::predicate == rdf::iana("label"));
-		auto prefix = rql::select_value<std::string>(statements, rql::predicate == rdf::iana("prefix"));
-
-		subtags[id] = name;
-		if (rql::object(language) == rdf::iana("ExtLang"))
-			extlangs.insert({ id, { prefix, id }});
+		int pos = (begin + end) / 2;
+
+		int comp = strcmp(aCode.c_str(), mData->begin() + aEntries[pos].code);
+		if (comp == 0)
+			return mData->begin() + aEntries[pos].value;
+		else if (comp > 0)
+			begin = pos + 1;
+		else
+			end = pos - 1;
 	}
+
+	return nullptr;
 }
 
-static LanguageData *language_data()
+static const LanguageData *language_data()
 {
-	static std::shared_ptr<LanguageData> data;
-	if (!data.get())
-		data = std::make_shared<LanguageData>();
-	return data.get();
+	static const LanguageData data;
+	return &data;
 }
 
 static std::string localize_subtag(const char *iso_codes, const std::string &id)
 {
-	auto data = language_data();
-	auto entry = data->subtags.find(id);
-	if (entry == data->subtags.end())
+	const char *name = language_data()->subtag(id);
+	if (!name)
 		return id;
 #ifdef ENABLE_NLS
-	return dgettext(iso_codes, entry->second.c_str());
+	return dgettext(iso_codes, name);
 #else
-	return entry->second;
+	return name;
 #endif
 }
 
@@ -170,13 +351,14 @@ static const lang::tag *lookup_alias(std::string lang)
 	return nullptr;
 }
 
-static const lang::tag *lookup_extlang(std::string lang)
+static bool lookup_extlang(std::string lang, lang::tag &aTag)
 {
-	auto data = language_data();
-	auto entry = data->extlangs.find(to_lower(lang));
-	if (entry == data->extlangs.end())
-		return nullptr;
-	return &entry->second;
+	lang = to_lower(lang);
+	const char *prefix = language_data()->extlang_prefix(lang);
+	if (!prefix)
+		return false;
+	aTag = { prefix, lang };
+	return true;
 }
 
 static const std::string get_region_code(const std::string &lang, const std::string &code)
@@ -224,10 +406,7 @@ lang::tag lang::make_lang(const std::string &code)
 			lang.private_use = item;
 		else if (lang.lang.empty())
 		{
-			const lang::tag *extlang = lookup_extlang(item);
-			if (extlang)
-				lang = *extlang;
-			else
+			if (!lookup_extlang(item, lang))
 				lang.lang = item;
 		}
 		else switch (item.length())
@@ -241,9 +420,9 @@ lang::tag lang::make_lang(const std::string &code)
 		case 3:
 			if (lang.extlang.empty())
 			{
-				const lang::tag *extlang = lookup_extlang(item);
-				if (extlang && extlang->lang == lang.lang)
-					lang.extlang = extlang->extlang;
+				lang::tag extlang { "" };
+				if (lookup_extlang(item, extlang) && extlang.lang == lang.lang)
+					lang.extlang = extlang.extlang;
 				else
 					lang.region = get_region_code(lang.lang, item);
 			}
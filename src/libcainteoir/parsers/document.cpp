@@ -29,6 +29,23 @@
 namespace rdf = cainteoir::rdf;
 namespace mime = cainteoir::mime;
 
+static unsigned int parser_threads = 1;
+
+// Is the document not in one of the formats detected by createDocumentReader
+// from its content?
+static bool is_plain_text(const std::shared_ptr<cainteoir::buffer> &aData)
+{
+	return !mime::gzip.match(aData)
+	    && !mime::zip.match(aData)
+	    && !mime::smil.match(aData)
+	    && !mime::xml.match(aData)
+	    && !mime::email.match(aData)
+	    && !mime::mime.match(aData)
+	    && !mime::html.match(aData)
+	    && !mime::rtf.match(aData)
+	    && !mime::pdf.match(aData);
+}
+
 std::shared_ptr<cainteoir::xml::reader>
 cainteoir::createXmlReader(const std::shared_ptr<buffer> &aData, const char *aDefaultEncoding)
 {
@@ -53,6 +70,16 @@ cainteoir::createDocumentReader(std::shared_ptr<buffer> &aData,
 
 	if (mime::gzip.match(aData))
 	{
+		// Plain text documents are read as they are decompressed, so large
+		// compressed text files are not held in memory.
+		auto stream = cainteoir::inflate_gzip_stream(aData, 0);
+		if (!stream->read())
+			return std::shared_ptr<document_reader>();
+
+		auto head = std::make_shared<cainteoir::buffer>(stream->begin(), stream->end());
+		if (is_plain_text(head))
+			return createPlainTextReader(stream, aSubject, aPrimaryMetadata, aTitle);
+
 		std::shared_ptr<cainteoir::buffer> decompressed = cainteoir::inflate_gzip(*aData, 0);
 		return createDocumentReader(decompressed, aSubject, aPrimaryMetadata, aTitle);
 	}
@@ -154,6 +181,16 @@ cainteoir::createDocumentReader(const char *aFilename,
 	return createDocumentReader(data, subject, aPrimaryMetadata, aTitle, aDefaultEncoding);
 }
 
+void cainteoir::setDocumentParserThreads(unsigned int aThreads)
+{
+	parser_threads = aThreads == 0 ? 1 : aThreads;
+}
+
+unsigned int cainteoir::documentParserThreads()
+{
+	return parser_threads;
+}
+
 void cainteoir::supportedDocumentFormats(rdf::graph &metadata, capability_types capabilities)
 {
 	std::string baseuri = "http://rhdunn.github.com/cainteoir/formats/document";
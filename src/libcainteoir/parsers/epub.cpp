@@ -24,6 +24,7 @@
 
 #include <cainteoir/path.hpp>
 #include <stdexcept>
+#include <pthread.h>
 
 namespace rdf    = cainteoir::rdf;
 namespace rql    = cainteoir::rdf::query;
@@ -41,9 +42,55 @@ enum class state
 	eof,             // End of the file.
 };
 
+// The events of a spine item that has been parsed on a worker thread.
+struct spine_item
+{
+	enum class status
+	{
+		pending,    // The item has not been parsed.
+		parsing,    // The item is being parsed by a worker thread.
+		parsed,     // The events have been read from the item.
+		not_loaded, // The item is not a supported content document.
+		failed,     // An error occurred parsing the item.
+	};
+
+	spine_item(const rql::results &aItem)
+		: item(aItem)
+		, state(status::pending)
+	{
+	}
+
+	rql::results item;
+	status state;
+	std::vector<cainteoir::document_item> events;
+	std::string error;
+};
+
+struct spine_item_reader : public cainteoir::document_reader
+{
+	spine_item_reader(std::vector<cainteoir::document_item> &&aEvents)
+		: mEvents(std::move(aEvents))
+		, mCurrent(mEvents.begin())
+	{
+	}
+
+	bool read(rdf::graph *)
+	{
+		if (mCurrent == mEvents.end()) return false;
+
+		*((document_item *)this) = *mCurrent;
+		++mCurrent;
+		return true;
+	}
+
+	std::vector<cainteoir::document_item> mEvents;
+	std::vector<cainteoir::document_item>::const_iterator mCurrent;
+};
+
 struct epub_document_reader : public cainteoir::document_reader
 {
 	epub_document_reader(std::shared_ptr<cainteoir::archive> &aData, const rdf::uri &aSubject, rdf::graph &aPrimaryMetadata, const char *aDefaultEncoding);
+	~epub_document_reader();
 
 	bool read(rdf::graph *aMetadata);
 
@@ -57,7 +104,16 @@ struct epub_document_reader : public cainteoir::document_reader
 	const char *mDefaultEncoding;
 
 	rdf::graph mManifest;
-	rql::results mManifestItem;
+	std::vector<spine_item> mSpine;
+	size_t mSpineItem;
+
+	unsigned int mThreads;
+	std::vector<pthread_t> mWorkers;
+	size_t mNextParseItem;
+	bool mStopWorkers;
+	pthread_mutex_t mLock;
+	pthread_cond_t mParsed;
+	pthread_cond_t mConsumed;
 
 	std::shared_ptr<cainteoir::document_reader> media_overlay;
 	rdf::uri mTextRef;
@@ -68,19 +124,32 @@ struct epub_document_reader : public cainteoir::document_reader
 	enum class document_type
 	{
 		toc,
-		text,
 		media_overlay,
 	};
 
 	bool load_document(const rql::results &aItem, document_type aType);
 	void next_media_overlay_entry();
+
+	std::shared_ptr<cainteoir::document_reader> create_content_reader(const rql::results &aItem) const;
+	std::shared_ptr<cainteoir::document_reader> parsed_content_reader();
+	void parse_spine_items();
 };
 
+static void *parse_spine_items_thread(void *data)
+{
+	((epub_document_reader *)data)->parse_spine_items();
+	return nullptr;
+}
+
 epub_document_reader::epub_document_reader(std::shared_ptr<cainteoir::archive> &aData, const rdf::uri &aSubject, rdf::graph &aPrimaryMetadata, const char *aDefaultEncoding)
 	: mData(aData)
 	, mSubject(aSubject)
 	, mState(state::title)
 	, mDefaultEncoding(aDefaultEncoding)
+	, mSpineItem(0)
+	, mThreads(cainteoir::documentParserThreads())
+	, mNextParseItem(0)
+	, mStopWorkers(false)
 {
 	auto ocf = cainteoir::createOcfReader(cainteoir::createXmlReader(mData->read("META-INF/container.xml"), mDefaultEncoding));
 	if (!ocf.get())
@@ -115,7 +184,55 @@ epub_document_reader::epub_document_reader(std::shared_ptr<cainteoir::archive> &
 	while (opf->read(&mManifest))
 		;
 
-	mManifestItem = rql::select(mManifest, rql::subject == mSubject && rql::predicate == rdf::ref("spine"));
+	auto spine = rql::select(mManifest, rql::subject == mSubject && rql::predicate == rdf::ref("spine"));
+	while (!spine.empty())
+	{
+		const rdf::uri &item = rql::object(spine.front());
+		auto first = rql::select(mManifest, rql::subject == item && rql::predicate == rdf::rdf("first"));
+
+		spine = rql::select(mManifest, rql::subject == item && rql::predicate == rdf::rdf("rest"));
+		if (!spine.empty())
+		{
+			if (rql::object(spine.front()) == rdf::rdf("nil"))
+				spine.clear();
+		}
+
+		if (!first.empty())
+			mSpine.push_back({ rql::select(mManifest, rql::subject == rql::object(first.front())) });
+	}
+
+	// Inflate the spine documents in the background while the earlier
+	// documents are being parsed.
+	if (mThreads > 1)
+	{
+		std::list<std::string> prefetch;
+		for (auto &item : mSpine)
+		{
+			auto target = rql::select(item.item, rql::predicate == rdf::ref("target"));
+			if (!target.empty())
+				prefetch.push_back((opf_root / rql::object(target.front()).str()).str());
+		}
+		mData->prefetch(prefetch, mThreads);
+	}
+
+	pthread_mutex_init(&mLock, nullptr);
+	pthread_cond_init(&mParsed, nullptr);
+	pthread_cond_init(&mConsumed, nullptr);
+}
+
+epub_document_reader::~epub_document_reader()
+{
+	pthread_mutex_lock(&mLock);
+	mStopWorkers = true;
+	pthread_cond_broadcast(&mConsumed);
+	pthread_mutex_unlock(&mLock);
+
+	for (auto &worker : mWorkers)
+		pthread_join(worker, nullptr);
+
+	pthread_cond_destroy(&mConsumed);
+	pthread_cond_destroy(&mParsed);
+	pthread_mutex_destroy(&mLock);
 }
 
 bool epub_document_reader::read(rdf::graph *aMetadata)
@@ -178,36 +295,28 @@ bool epub_document_reader::read(rdf::graph *aMetadata)
 		mState = state::publication;
 		break;
 	case state::publication:
-		if (mManifestItem.empty())
+		if (mSpineItem == mSpine.size())
 			mState = state::eof;
 		else
 		{
-			const rdf::uri &item = rql::object(mManifestItem.front());
-			auto first = rql::select(mManifest, rql::subject == item && rql::predicate == rdf::rdf("first"));
-
-			mManifestItem = rql::select(mManifest, rql::subject == item && rql::predicate == rdf::rdf("rest"));
-			if (!mManifestItem.empty())
-			{
-				if (rql::object(mManifestItem.front()) == rdf::rdf("nil"))
-					mManifestItem.clear();
-			}
+			const auto &item = mSpine[mSpineItem].item;
 
-			if (!first.empty())
+			auto media = rql::select(item, rql::predicate == rdf::ref("media-overlay"));
+			if (!media.empty())
 			{
-				auto item = rql::select(mManifest, rql::subject == rql::object(first.front()));
+				auto item = rql::select(mManifest, rql::subject == rql::object(media.front()));
 
-				auto media = rql::select(item, rql::predicate == rdf::ref("media-overlay"));
-				if (!media.empty())
-				{
-					auto item = rql::select(mManifest, rql::subject == rql::object(media.front()));
+				if (load_document(item, document_type::media_overlay))
+					next_media_overlay_entry();
+			}
 
-					if (load_document(item, document_type::media_overlay))
-						next_media_overlay_entry();
-				}
+			if (mThreads > 1)
+				child = parsed_content_reader();
+			else
+				child = create_content_reader(mSpine[mSpineItem++].item);
 
-				if (load_document(item, document_type::text))
-					mState = state::content;
-			}
+			if (child)
+				mState = state::content;
 		}
 		break;
 	case state::eof:
@@ -246,16 +355,6 @@ bool epub_document_reader::load_document(const rql::results &aItem, document_typ
 		else
 			return false;
 		break;
-	case document_type::text:
-		if (mimetype == "application/xhtml+xml")
-		{
-			anchor = mData->location(filename.str(), {});
-			rdf::graph innerMetadata;
-			child = cainteoir::createHtmlReader(reader, anchor, innerMetadata, std::string(), "application/xhtml+xml", {});
-		}
-		else
-			return false;
-		break;
 	case document_type::media_overlay:
 		if (filename.str() == mCurrentOverlay.str())
 			return false;
@@ -273,6 +372,109 @@ bool epub_document_reader::load_document(const rql::results &aItem, document_typ
 	return true;
 }
 
+std::shared_ptr<cainteoir::document_reader>
+epub_document_reader::create_content_reader(const rql::results &aItem) const
+{
+	auto target = rql::object(rql::select(aItem, rql::predicate == rdf::ref("target")).front());
+	auto mimetype = rql::select_value<std::string>(aItem, rql::predicate == rdf::ref("mimetype"));
+
+	cainteoir::path filename = opf_root / target.str();
+	auto reader = cainteoir::createXmlReader(mData->read(filename), mDefaultEncoding);
+	if (!reader)
+	{
+		fprintf(stderr, i18n("document '%s' not found in ePub archive.\n"), (const char *)filename);
+		return {};
+	}
+
+	if (mimetype != "application/xhtml+xml")
+		return {};
+
+	rdf::graph innerMetadata;
+	return cainteoir::createHtmlReader(reader, mData->location(filename.str(), {}), innerMetadata, std::string(), "application/xhtml+xml", {});
+}
+
+// Get the events of a spine item parsed by the worker threads, starting the
+// worker threads if they are not running.
+std::shared_ptr<cainteoir::document_reader>
+epub_document_reader::parsed_content_reader()
+{
+	if (mWorkers.empty())
+	{
+		for (unsigned int i = 0; i < mThreads && i < mSpine.size(); ++i)
+		{
+			pthread_t worker;
+			if (pthread_create(&worker, nullptr, parse_spine_items_thread, (void *)this) == 0)
+				mWorkers.push_back(worker);
+		}
+		if (mWorkers.empty())
+			return create_content_reader(mSpine[mSpineItem++].item);
+	}
+
+	pthread_mutex_lock(&mLock);
+	spine_item &item = mSpine[mSpineItem];
+	while (item.state == spine_item::status::pending || item.state == spine_item::status::parsing)
+		pthread_cond_wait(&mParsed, &mLock);
+	++mSpineItem;
+	pthread_cond_broadcast(&mConsumed);
+	pthread_mutex_unlock(&mLock);
+
+	switch (item.state)
+	{
+	case spine_item::status::failed:
+		throw std::runtime_error(item.error);
+	case spine_item::status::parsed:
+		return std::make_shared<spine_item_reader>(std::move(item.events));
+	default:
+		return {};
+	}
+}
+
+// Parse the spine items in order on a worker thread. The workers only parse
+// a few items ahead of the item being read to limit the memory used to store
+// the parsed events.
+void epub_document_reader::parse_spine_items()
+{
+	pthread_mutex_lock(&mLock);
+	while (true)
+	{
+		while (!mStopWorkers && mNextParseItem < mSpine.size() && mNextParseItem >= mSpineItem + mThreads * 2)
+			pthread_cond_wait(&mConsumed, &mLock);
+
+		if (mStopWorkers || mNextParseItem == mSpine.size())
+			break;
+
+		spine_item &item = mSpine[mNextParseItem++];
+		item.state = spine_item::status::parsing;
+		pthread_mutex_unlock(&mLock);
+
+		std::vector<cainteoir::document_item> events;
+		spine_item::status state = spine_item::status::not_loaded;
+		std::string error;
+		try
+		{
+			auto reader = create_content_reader(item.item);
+			if (reader)
+			{
+				while (reader->read())
+					events.push_back(*reader);
+				state = spine_item::status::parsed;
+			}
+		}
+		catch (const std::exception &e)
+		{
+			state = spine_item::status::failed;
+			error = e.what();
+		}
+
+		pthread_mutex_lock(&mLock);
+		item.events = std::move(events);
+		item.error = error;
+		item.state = state;
+		pthread_cond_broadcast(&mParsed);
+	}
+	pthread_mutex_unlock(&mLock);
+}
+
 void epub_document_reader::next_media_overlay_entry()
 {
 	if (!media_overlay)
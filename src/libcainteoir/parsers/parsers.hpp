@@ -82,6 +82,12 @@ namespace cainteoir
 	                      rdf::graph &aPrimaryMetadata,
 	                      const std::string &aTitle);
 
+	std::shared_ptr<document_reader>
+	createPlainTextReader(const std::shared_ptr<buffer_reader> &aData,
+	                      const rdf::uri &aSubject,
+	                      rdf::graph &aPrimaryMetadata,
+	                      const std::string &aTitle);
+
 	std::shared_ptr<document_reader>
 	createRdfXmlReader(const std::shared_ptr<xml::reader> &aReader,
 	                   const rdf::uri &aSubject,
@@ -108,6 +114,8 @@ namespace cainteoir
 	std::shared_ptr<document_reader>
 	createZipReader(std::shared_ptr<archive> &aData);
 
+	unsigned int documentParserThreads();
+
 	std::pair<bool, std::shared_ptr<buffer>>
 	parseMimeHeaders(std::shared_ptr<buffer> &aData,
                          const rdf::uri &aSubject,
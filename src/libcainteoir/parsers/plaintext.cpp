@@ -32,18 +32,35 @@ struct plaintext_document_reader : public cainteoir::document_reader
 		state_eof,
 	};
 
-	plaintext_document_reader(std::shared_ptr<cainteoir::buffer> &aData, const rdf::uri &aSubject, const std::string &aTitle);
+	plaintext_document_reader(const std::shared_ptr<cainteoir::buffer> &aData, const rdf::uri &aSubject, const std::string &aTitle);
+
+	plaintext_document_reader(const std::shared_ptr<cainteoir::buffer_reader> &aStream, const rdf::uri &aSubject, const std::string &aTitle);
 
 	bool read(rdf::graph *aMetadata);
 
+	std::shared_ptr<cainteoir::buffer> read_stream_paragraph();
+
+	std::shared_ptr<cainteoir::buffer> read_paragraph();
+
 	std::shared_ptr<cainteoir::buffer> mData;
+	const char *mCurrent;
+	std::shared_ptr<cainteoir::buffer_reader> mStream;
+	std::string mPending;
+	std::string::size_type mPendingPos;
+	bool mChunkPending;
 	rdf::uri mSubject;
 	state mState;
 	std::string mTitle;
 };
 
-plaintext_document_reader::plaintext_document_reader(std::shared_ptr<cainteoir::buffer> &aData, const rdf::uri &aSubject, const std::string &aTitle)
+// The maximum size of a paragraph to buffer when streaming the text.
+#define MAX_PARTIAL_PARAGRAPH 65536
+
+plaintext_document_reader::plaintext_document_reader(const std::shared_ptr<cainteoir::buffer> &aData, const rdf::uri &aSubject, const std::string &aTitle)
 	: mData(aData)
+	, mCurrent(aData->begin())
+	, mPendingPos(0)
+	, mChunkPending(false)
 	, mSubject(aSubject)
 	, mState(state_title)
 	, mTitle(aTitle)
@@ -57,6 +74,118 @@ plaintext_document_reader::plaintext_document_reader(std::shared_ptr<cainteoir::
 	}
 }
 
+// The stream is positioned on the first chunk of text.
+plaintext_document_reader::plaintext_document_reader(const std::shared_ptr<cainteoir::buffer_reader> &aStream, const rdf::uri &aSubject, const std::string &aTitle)
+	: plaintext_document_reader(std::make_shared<cainteoir::buffer>(aStream->begin(), aStream->end()), aSubject, aTitle)
+{
+	mStream = aStream;
+	mChunkPending = true;
+}
+
+// A paragraph in the document text. This keeps the document text alive while
+// the paragraph is being used.
+struct paragraph_buffer : public cainteoir::buffer
+{
+	paragraph_buffer(const std::shared_ptr<cainteoir::buffer> &aData, const char *aBegin, const char *aEnd)
+		: cainteoir::buffer(aBegin, aEnd)
+		, mData(aData)
+	{
+	}
+
+	std::shared_ptr<cainteoir::buffer> mData;
+};
+
+// Find the start of the paragraph after aCurrent. Paragraphs are separated
+// by blank lines, which are kept at the end of the previous paragraph so the
+// text events cover the whole document.
+static const char *next_paragraph(const char *aCurrent, const char *aEnd)
+{
+	const char *current = aCurrent;
+	while ((current = (const char *)memchr(current, '\n', aEnd - current)) != nullptr)
+	{
+		const char *paragraph = nullptr;
+		++current;
+		while (current != aEnd && (*current == ' ' || *current == '\t' || *current == '\r' || *current == '\n'))
+		{
+			if (*current == '\n')
+				paragraph = current + 1;
+			++current;
+		}
+
+		if (current == aEnd)
+			return aEnd;
+		if (paragraph)
+			return paragraph;
+	}
+	return aEnd;
+}
+
+// Get the next paragraph from the document text. Only the text up to the end
+// of the paragraph is scanned, so the first paragraph is available without
+// reading the rest of the document.
+std::shared_ptr<cainteoir::buffer> plaintext_document_reader::read_paragraph()
+{
+	if (mCurrent == mData->end())
+		return {};
+
+	const char *begin = mCurrent;
+	mCurrent = next_paragraph(mCurrent, mData->end());
+	if (begin == mData->begin() && mCurrent == mData->end())
+		return mData;
+	return std::make_shared<paragraph_buffer>(mData, begin, mCurrent);
+}
+
+// Get the next paragraph from the stream. Paragraphs longer than 64 KB are
+// split on a line boundary, or a UTF-8 character boundary for long lines, so
+// the memory used does not depend on the size of the document.
+std::shared_ptr<cainteoir::buffer> plaintext_document_reader::read_stream_paragraph()
+{
+	while (true)
+	{
+		const char *begin = mPending.c_str() + mPendingPos;
+		const char *end   = mPending.c_str() + mPending.size();
+		const char *next  = next_paragraph(begin, end);
+		bool split = next != end;
+		if (!split && end - begin >= MAX_PARTIAL_PARAGRAPH)
+		{
+			split = true;
+			while (next != begin && next[-1] != '\n')
+				--next;
+			if (next == begin)
+			{
+				next = end;
+				while (next != begin && (next[-1] & 0xC0) == 0x80)
+					--next;
+				if (next != begin && (next[-1] & 0x80) == 0x80)
+					--next;
+				if (next == begin) // invalid UTF-8 sequence
+					next = end;
+			}
+		}
+
+		if (split)
+		{
+			mPendingPos += next - begin;
+			return cainteoir::make_buffer(begin, next - begin);
+		}
+
+		if (!mChunkPending && !mStream->read())
+			break;
+
+		mChunkPending = false;
+		mPending.erase(0, mPendingPos);
+		mPending.append(mStream->begin(), mStream->end());
+		mPendingPos = 0;
+	}
+
+	if (mPendingPos == mPending.size())
+		return {};
+
+	auto text = cainteoir::make_buffer(mPending.c_str() + mPendingPos, mPending.size() - mPendingPos);
+	mPendingPos = mPending.size();
+	return text;
+}
+
 bool plaintext_document_reader::read(rdf::graph *aMetadata)
 {
 	switch (mState)
@@ -86,9 +215,17 @@ bool plaintext_document_reader::read(rdf::graph *aMetadata)
 		mState = mData->empty() ? state_eof : state_text;
 		return true;
 	case state_text:
-		clear().text_event(mData);
-		mState = state_eof;
-		break;
+		{
+			auto text = mStream ? read_stream_paragraph() : read_paragraph();
+			if (text)
+			{
+				clear().text_event(text);
+				break;
+			}
+			mState = state_eof;
+			clear();
+		}
+		return false;
 	case state_eof:
 		clear();
 		return false;
@@ -96,16 +233,14 @@ bool plaintext_document_reader::read(rdf::graph *aMetadata)
 	return true;
 }
 
-std::shared_ptr<cainteoir::document_reader>
-cainteoir::createPlainTextReader(std::shared_ptr<buffer> &aData,
-                                 const rdf::uri &aSubject,
-                                 rdf::graph &aPrimaryMetadata,
-                                 const std::string &aTitle)
+static bool is_plain_text(const cainteoir::buffer &aData,
+                          const rdf::uri &aSubject,
+                          rdf::graph &aPrimaryMetadata)
 {
 	// Octet Stream ...
 
-	const uint8_t *begin = (const uint8_t *)aData->begin();
-	const uint8_t *end   = (const uint8_t *)aData->end();
+	const uint8_t *begin = (const uint8_t *)aData.begin();
+	const uint8_t *end   = (const uint8_t *)aData.end();
 	if (begin + 101 < end) // only check the first 100 bytes
 		end = begin + 101;
 
@@ -115,7 +250,7 @@ cainteoir::createPlainTextReader(std::shared_ptr<buffer> &aData,
 		{
 			printf("error: control character 0x%02X found ... treating as octet stream.\n", *begin);
 			aPrimaryMetadata.statement(aSubject, rdf::tts("mimetype"), rdf::literal("application/octet-stream"));
-			return std::shared_ptr<cainteoir::document_reader>();
+			return false;
 		}
 		++begin;
 	}
@@ -123,5 +258,27 @@ cainteoir::createPlainTextReader(std::shared_ptr<buffer> &aData,
 	// Plain Text ...
 
 	aPrimaryMetadata.statement(aSubject, rdf::tts("mimetype"), rdf::literal("text/plain"));
+	return true;
+}
+
+std::shared_ptr<cainteoir::document_reader>
+cainteoir::createPlainTextReader(std::shared_ptr<buffer> &aData,
+                                 const rdf::uri &aSubject,
+                                 rdf::graph &aPrimaryMetadata,
+                                 const std::string &aTitle)
+{
+	if (!is_plain_text(*aData, aSubject, aPrimaryMetadata))
+		return std::shared_ptr<cainteoir::document_reader>();
+	return std::make_shared<plaintext_document_reader>(aData, aSubject, aTitle);
+}
+
+std::shared_ptr<cainteoir::document_reader>
+cainteoir::createPlainTextReader(const std::shared_ptr<buffer_reader> &aData,
+                                 const rdf::uri &aSubject,
+                                 rdf::graph &aPrimaryMetadata,
+                                 const std::string &aTitle)
+{
+	if (!is_plain_text(*aData, aSubject, aPrimaryMetadata))
+		return std::shared_ptr<cainteoir::document_reader>();
 	return std::make_shared<plaintext_document_reader>(aData, aSubject, aTitle);
 }
@@ -885,6 +885,21 @@ private:
 	std::stack<context_data> ctx;
 };
 
+// The default counter styles are the same for every HTML document, so they are
+// parsed once and shared by all the readers, including the readers for the
+// documents in an EPUB spine that are parsed on worker threads. The shared
+// style manager is not modified after it has been created.
+static const std::shared_ptr<const css::style_manager> &default_styles()
+{
+	static const std::shared_ptr<const css::style_manager> styles = []()
+	{
+		auto styles = std::make_shared<css::style_manager>();
+		styles->parse("/css/counterstyles.css");
+		return styles;
+	}();
+	return styles;
+}
+
 html_document_reader::html_document_reader(const std::shared_ptr<xml::reader> &aReader,
                                            const rdf::uri &aSubject,
                                            rdf::graph &aPrimaryMetadata,
@@ -893,12 +908,11 @@ html_document_reader::html_document_reader(const std::shared_ptr<xml::reader> &a
                                            const cainteoir::path &aBaseUri)
 	: reader(aReader)
 	, mSubject(aSubject)
+	, stylemgr(default_styles())
 	, trim_left(cainteoir::whitespace::preserve)
 	, mBaseUri(aBaseUri)
 	, mDepth(0)
 {
-	stylemgr.parse("/css/counterstyles.css");
-
 	ctx.push({ nullptr, &html_document_reader::parse_document_root, 0, true });
 	read(&aPrimaryMetadata);
 
@@ -25,7 +25,9 @@
 #include <cainteoir/xmlreader.hpp>
 #include <cainteoir/unicode.hpp>
 
+#include <unordered_map>
 #include <stdlib.h>
+#include <pthread.h>
 
 using cainteoir::xml::detail::entity;
 using cainteoir::xml::detail::entity_set;
@@ -176,6 +178,168 @@ const cainteoir::xml::ns cainteoir::xml::xmlns::xhtml( "h",     "http://www.w3.o
 const cainteoir::xml::ns cainteoir::xml::xmlns::xml(   "xml",   "http://www.w3.org/XML/1998/namespace");
 const cainteoir::xml::ns cainteoir::xml::xmlns::xsd(   "xsd",   "http://www.w3.org/2001/XMLSchema");
 
+// Namespace URIs are interned when they are associated with a context, so the
+// context lookups for each element and attribute compare ids instead of
+// strings. The empty namespace URI has the id 0. The namespace URIs declared in
+// documents that are not associated with a context share the unknown_namespace
+// id, so reading documents does not add to the registry.
+//
+// The context entries are held in open addressing hash tables keyed on the
+// element or attribute name. The names are hashed without their case for case
+// insensitive contexts. The tables are shared by all the readers using the
+// same entries, so creating a reader does not rebuild them.
+
+struct cainteoir::xml::detail::entry_table
+{
+	std::vector<cainteoir::xml::context::entry_ref> entries;
+	cainteoir::buffer::match_type match;
+	std::vector<const cainteoir::xml::context::entry_ref *> slots;
+	uint32_t mask;
+
+	entry_table(const std::initializer_list<const cainteoir::xml::context::entry_ref> &aEntries,
+	            cainteoir::buffer::match_type aMatch);
+
+	bool matches(const std::initializer_list<const cainteoir::xml::context::entry_ref> &aEntries,
+	             cainteoir::buffer::match_type aMatch) const;
+
+	uint32_t hash(const char *aName, size_t aLength) const
+	{
+		uint32_t value = 2166136261u; // FNV-1a
+		for (const char *c = aName, *last = aName + aLength; c != last; ++c)
+		{
+			char ch = *c;
+			if (match == cainteoir::buffer::ignore_case && ch >= 'A' && ch <= 'Z')
+				ch = ch - 'A' + 'a';
+			value = (value ^ (uint8_t)ch) * 16777619u;
+		}
+		return value;
+	}
+};
+
+cainteoir::xml::detail::entry_table::entry_table(const std::initializer_list<const cainteoir::xml::context::entry_ref> &aEntries,
+                                                 cainteoir::buffer::match_type aMatch)
+	: entries(aEntries.begin(), aEntries.end())
+	, match(aMatch)
+{
+	uint32_t size = 8;
+	while (size < entries.size() * 2)
+		size *= 2;
+	slots.resize(size, nullptr);
+	mask = size - 1;
+
+	for (auto &entry : entries)
+	{
+		uint32_t slot = hash(entry.name, strlen(entry.name)) & mask;
+		while (slots[slot] && cainteoir::buffer(slots[slot]->name).compare(entry.name, match) != 0)
+			slot = (slot + 1) & mask;
+		if (!slots[slot]) // keep the first entry if the name is listed more than once
+			slots[slot] = &entry;
+	}
+}
+
+bool cainteoir::xml::detail::entry_table::matches(const std::initializer_list<const cainteoir::xml::context::entry_ref> &aEntries,
+                                                  cainteoir::buffer::match_type aMatch) const
+{
+	if (match != aMatch || entries.size() != aEntries.size())
+		return false;
+
+	auto entry = entries.begin();
+	for (auto &item : aEntries)
+	{
+		if (entry->name != item.name || entry->data != item.data)
+			return false;
+		++entry;
+	}
+	return true;
+}
+
+static const uint32_t unknown_namespace = 1;
+
+struct xml_registry
+{
+	std::unordered_map<std::string, uint32_t> ids;
+	std::unordered_map<const cainteoir::xml::context::entry_ref *, std::vector<std::shared_ptr<const cainteoir::xml::detail::entry_table>>> tables;
+	pthread_rwlock_t lock;
+
+	xml_registry()
+	{
+		pthread_rwlock_init(&lock, nullptr);
+		ids.insert({ std::string(), 0 });
+	}
+
+	std::vector<uint32_t> aliases;
+
+	uint32_t find(const std::string &aHref) const
+	{
+		auto match = ids.find(aHref);
+		return match == ids.end() ? unknown_namespace : match->second;
+	}
+
+	uint32_t intern(const std::string &aHref)
+	{
+		auto match = ids.find(aHref);
+		if (match != ids.end())
+			return match->second;
+
+		uint32_t id = ids.size() + 1; // skip unknown_namespace
+		ids.insert({ aHref, id });
+		return id;
+	}
+
+	// Namespace URIs ending in '#' use the entries for the URI without the
+	// '#' if they do not have their own entries.
+	uint32_t alias(uint32_t aId, const std::string &aHref)
+	{
+		if (aliases.size() <= aId)
+			aliases.resize(aId + 1, 0);
+		if (aliases[aId] == 0)
+		{
+			if (aHref.empty() || aHref.back() == '#')
+				aliases[aId] = aId;
+			else
+				aliases[aId] = intern(aHref + '#');
+		}
+		return aliases[aId];
+	}
+};
+
+static xml_registry &registry()
+{
+	static xml_registry data;
+	return data;
+}
+
+uint32_t cainteoir::xml::namespace_id(const std::string &aHref)
+{
+	if (aHref.empty())
+		return 0;
+
+	xml_registry &data = registry();
+	pthread_rwlock_rdlock(&data.lock);
+	uint32_t id = data.find(aHref);
+	pthread_rwlock_unlock(&data.lock);
+	return id;
+}
+
+// The decoded text of nodes with entities or in a non UTF-8 document. The
+// text is held in a std::string so the allocated memory is reused when the
+// buffer is reused for the next node.
+
+struct cainteoir::xml::detail::text_buffer : public cainteoir::buffer
+{
+	std::string data;
+
+	text_buffer() : cainteoir::buffer(nullptr, nullptr)
+	{
+	}
+
+	void update()
+	{
+		first = data.c_str();
+		last  = first + data.size();
+	}
+};
+
 cainteoir::xml::namespaces::namespaces()
 	: mBlockNumber(-1)
 {
@@ -196,7 +360,7 @@ void cainteoir::xml::namespaces::push_block()
 void cainteoir::xml::namespaces::pop_block()
 {
 	--mBlockNumber;
-	while (mNamespaces.back().block > mBlockNumber && !mNamespaces.empty())
+	while (!mNamespaces.empty() && mNamespaces.back().block > mBlockNumber)
 	{
 		mNamespaces.pop_back();
 	}
@@ -204,12 +368,38 @@ void cainteoir::xml::namespaces::pop_block()
 
 std::string cainteoir::xml::namespaces::lookup(const std::string &aPrefix) const
 {
-	for (auto &ns : cainteoir::reverse(mNamespaces))
+	return lookup(cainteoir::buffer(aPrefix.c_str(), aPrefix.c_str() + aPrefix.size()));
+}
+
+std::string cainteoir::xml::namespaces::lookup(const cainteoir::buffer &aPrefix) const
+{
+	const namespace_item *ns = find(aPrefix);
+	return ns ? ns->item.href : std::string();
+}
+
+uint32_t cainteoir::xml::namespaces::lookup_id(const cainteoir::buffer &aPrefix) const
+{
+	const namespace_item *ns = find(aPrefix);
+	if (!ns) return 0;
+
+	// The namespace may be associated with a context after it is declared,
+	// e.g. when the reader is created by the document format detection.
+	if (ns->id == unknown_namespace)
+		ns->id = namespace_id(ns->item.href);
+	return ns->id;
+}
+
+const cainteoir::xml::namespaces::namespace_item *
+cainteoir::xml::namespaces::find(const cainteoir::buffer &aPrefix) const
+{
+	for (auto ns = mNamespaces.rbegin(), last = mNamespaces.rend(); ns != last; ++ns)
 	{
-		if (ns.item.prefix == aPrefix && ns.block <= mBlockNumber)
-			return ns.item.href;
+		if (ns->block <= mBlockNumber &&
+		    ns->item.prefix.size() == aPrefix.size() &&
+		    std::equal(aPrefix.begin(), aPrefix.end(), ns->item.prefix.begin()))
+			return &*ns;
 	}
-	return std::string();
+	return nullptr;
 }
 
 const cainteoir::xml::context::entry cainteoir::xml::unknown_context = {};
@@ -226,31 +416,73 @@ const std::initializer_list<const cainteoir::xml::context::entry_ref> cainteoir:
 	{ "space", &xml::space_attr },
 };
 
-const cainteoir::xml::context::entry *cainteoir::xml::context::lookup(const std::string &aNS, const cainteoir::buffer &aNode) const
+void cainteoir::xml::context::set(const std::string &aNS, const std::initializer_list<const entry_ref> &entries, buffer::match_type match)
 {
-	auto entryset = mNodes.find(aNS);
-	if (entryset == mNodes.end() && *(--aNS.end()) == '#')
-		entryset = mNodes.find(aNS.substr(0, aNS.size() - 1));
+	xml_registry &data = registry();
+	pthread_rwlock_wrlock(&data.lock);
+
+	// The same entries can be used with different match types, e.g. for HTML
+	// and XHTML, so each match type has its own table.
+	std::shared_ptr<const detail::entry_table> entry_table;
+	auto &tables = data.tables[entries.begin()];
+	for (auto &table : tables)
+	{
+		if (table->match != match)
+			continue;
+		if (!table->matches(entries, match))
+			table = std::make_shared<detail::entry_table>(entries, match);
+		entry_table = table;
+		break;
+	}
+	if (!entry_table)
+	{
+		entry_table = std::make_shared<detail::entry_table>(entries, match);
+		tables.push_back(entry_table);
+	}
 
-	if (entryset == mNodes.end())
-		return &unknown_context;
+	uint32_t id = data.intern(aNS);
+	uint32_t alias = data.alias(id, aNS);
 
-	int begin = 0;
-	int end = entryset->second.first.size() - 1;
+	pthread_rwlock_unlock(&data.lock);
 
-	while (begin <= end)
-	{
-		int pos = (begin + end) / 2;
+	set(id, false, entry_table);
+	if (alias != id)
+		set(alias, true, entry_table);
+}
 
-		int comp = aNode.compare((*(entryset->second.first.begin() + pos)).name, entryset->second.second);
-		if (comp == 0)
-			return (entryset->second.first.begin() + pos)->data;
-		else if (comp < 0)
-			begin = pos + 1;
-		else
-			end = pos - 1;
+void cainteoir::xml::context::set(uint32_t aNS, bool aAlias, const std::shared_ptr<const detail::entry_table> &aEntries)
+{
+	for (auto &item : mNodes)
+	{
+		if (item.ns == aNS)
+		{
+			if (aAlias && !item.alias)
+				return;
+			item.alias = aAlias;
+			item.entries = aEntries;
+			return;
+		}
 	}
+	mNodes.push_back({ aNS, aAlias, aEntries });
+}
+
+const cainteoir::xml::context::entry *cainteoir::xml::context::lookup(uint32_t aNS, const cainteoir::buffer &aNode) const
+{
+	for (auto &item : mNodes)
+	{
+		if (item.ns != aNS)
+			continue;
 
+		const detail::entry_table &table = *item.entries;
+		for (uint32_t slot = table.hash(aNode.begin(), aNode.size()) & table.mask;
+		     table.slots[slot];
+		     slot = (slot + 1) & table.mask)
+		{
+			if (aNode.compare(table.slots[slot]->name, table.match) == 0)
+				return table.slots[slot]->data;
+		}
+		return &unknown_context;
+	}
 	return &unknown_context;
 }
 
@@ -316,7 +548,7 @@ bool cainteoir::xml::reader::read()
 	if (mState.state == ParsingText)
 	{
 		mNodeType = textNode;
-		mNodeValue = mEncoding.decode(std::make_shared<cainteoir::buffer>(mState.current, mEnd));
+		decode_node_value(mState.current, mEnd);
 		mState.current = mEnd;
 		return true;
 	}
@@ -372,7 +604,7 @@ bool cainteoir::xml::reader::read()
 					mNodeValue = unquoted_node_value();
 			}
 			else // HTML§12.1.2.3 -- empty attribute
-				mNodeValue = mEncoding.decode(std::make_shared<cainteoir::buffer>(mState.nodeName));
+				decode_node_value(mState.nodeName.begin(), mState.nodeName.end());
 
 			if (mState.state == ParsingXmlProcessingInstructionAttributes)
 			{
@@ -412,7 +644,7 @@ bool cainteoir::xml::reader::read()
 				startPos = ++mState.current;
 				while (mState.current != mEnd && !(mState.current[0] == '-' && mState.current[1] == '-' && mState.current[2] == '>'))
 					++mState.current;
-				mNodeValue = mEncoding.decode(std::make_shared<cainteoir::buffer>(startPos, mState.current));
+				decode_node_value(startPos, mState.current);
 				mState.current += 3;
 			}
 			else if (mState.current[1] == '[' && mState.current[2] == 'C' && mState.current[3] == 'D' && mState.current[4] == 'A' &&
@@ -423,7 +655,7 @@ bool cainteoir::xml::reader::read()
 				startPos = mState.current;
 				while (mState.current != mEnd && !(mState.current[0] == ']' && mState.current[1] == ']' && mState.current[2] == '>'))
 					++mState.current;
-				mNodeValue = mEncoding.decode(std::make_shared<cainteoir::buffer>(startPos, mState.current));
+				decode_node_value(startPos, mState.current);
 				mState.current += 3;
 			}
 			else // DTD
@@ -570,6 +802,13 @@ std::string cainteoir::xml::reader::namespaceUri() const
 	return std::string();
 }
 
+uint32_t cainteoir::xml::reader::node_namespace_id() const
+{
+	if (mState.nodeName.compare("xmlns"))
+		return mNamespaces.lookup_id(mState.nodePrefix);
+	return 0;
+}
+
 void cainteoir::xml::reader::set_begin_tag_type(begin_tag_type aType)
 {
 	if (mState.state == ParsingXmlTagAttributes) switch (aType)
@@ -642,10 +881,22 @@ std::shared_ptr<cainteoir::buffer> cainteoir::xml::reader::unquoted_node_value()
 
 void cainteoir::xml::reader::read_node_value(char terminator1, char terminator2)
 {
+	const char *startPos = mState.current;
+	while (mState.current != mEnd && !(*mState.current == '&' || *mState.current == terminator1 || *mState.current == terminator2))
+		++mState.current;
+
+	if (mState.current == mEnd || *mState.current != '&')
+	{
+		decode_node_value(startPos, mState.current);
+		return;
+	}
+
 	mNodeValue.clear();
+	detail::text_buffer &text = text_arena();
+	mEncoding.decode(cainteoir::buffer(startPos, mState.current), text.data);
 	do
 	{
-		const char *startPos = mState.current;
+		startPos = mState.current;
 		if (*mState.current == '&') // XML§4.1 ; HTML§12.1.4 -- character and entity references
 		{
 			++mState.current;
@@ -659,7 +910,7 @@ void cainteoir::xml::reader::read_node_value(char terminator1, char terminator2)
 			{
 				std::shared_ptr<cainteoir::buffer> entity = parse_entity(cainteoir::buffer(startPos+1, mState.current), mPredefinedEntities, mDoctypeEntities);
 				if (entity)
-					mNodeValue += entity;
+					text.data.append(entity->begin(), entity->end());
 				++mState.current;
 				continue;
 			}
@@ -667,8 +918,58 @@ void cainteoir::xml::reader::read_node_value(char terminator1, char terminator2)
 
 		while (mState.current != mEnd && !(*mState.current == '&' || *mState.current == terminator1 || *mState.current == terminator2))
 			++mState.current;
-		mEncoding.decode(std::make_shared<cainteoir::buffer>(startPos, mState.current), mNodeValue);
+		mEncoding.decode(cainteoir::buffer(startPos, mState.current), text.data);
 	} while (mState.current != mEnd && !(*mState.current == terminator1 || *mState.current == terminator2));
+
+	text.update();
+	mNodeValue = mTextArena;
+}
+
+void cainteoir::xml::reader::decode_node_value(const char *aStart, const char *aEnd)
+{
+	mNodeValue.clear();
+	if (mEncoding.is_native())
+	{
+		mNodeValue = text_view(aStart, aEnd);
+		return;
+	}
+
+	detail::text_buffer &text = text_arena();
+	mEncoding.decode(cainteoir::buffer(aStart, aEnd), text.data);
+	text.update();
+	mNodeValue = mTextArena;
+}
+
+// A view of the document data. This keeps the document data alive, as the
+// node values can be used after the reader has been destroyed.
+struct text_view_buffer : public cainteoir::buffer
+{
+	text_view_buffer(const std::shared_ptr<cainteoir::buffer> &aData, const char *aBegin, const char *aEnd)
+		: cainteoir::buffer(aBegin, aEnd)
+		, mData(aData)
+	{
+	}
+
+	std::shared_ptr<cainteoir::buffer> mData;
+};
+
+std::shared_ptr<cainteoir::buffer> cainteoir::xml::reader::text_view(const char *aStart, const char *aEnd)
+{
+	// The buffer is only reused if the last node value is no longer used.
+	if (mTextView.use_count() == 1)
+		*mTextView = cainteoir::buffer(aStart, aEnd);
+	else
+		mTextView = std::make_shared<text_view_buffer>(mData, aStart, aEnd);
+	return mTextView;
+}
+
+cainteoir::xml::detail::text_buffer &cainteoir::xml::reader::text_arena()
+{
+	// The buffer is only reused if the last node value is no longer used.
+	if (mTextArena.use_count() != 1)
+		mTextArena = std::make_shared<detail::text_buffer>();
+	mTextArena->data.clear();
+	return *mTextArena;
 }
 
 void cainteoir::xml::reader::read_tag(node_type aType)
@@ -695,11 +996,11 @@ void cainteoir::xml::reader::reset_context()
 	switch (mNodeType)
 	{
 	case attribute:
-		mContext = mAttrs.lookup(namespaceUri(), nodeName());
+		mContext = mAttrs.lookup(node_namespace_id(), nodeName());
 		break;
 	case beginTagNode:
 	case endTagNode:
-		mContext = mNodes.lookup(namespaceUri(), nodeName());
+		mContext = mNodes.lookup(node_namespace_id(), nodeName());
 		break;
 	default:
 		break;
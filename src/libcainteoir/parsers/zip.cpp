@@ -18,15 +18,20 @@
  * along with cainteoir-engine.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+
 #include "config.h"
 #include "compatibility.hpp"
 #include "i18n.h"
 
 #include <cainteoir/archive.hpp>
 #include <stdexcept>
+#include <deque>
+#include <pthread.h>
 
-#define ZIP_HEADER_MAGIC      0x04034b50
-#define DATA_DESCRIPTOR_MAGIC 0x08074b50
+#define ZIP_HEADER_MAGIC                0x04034b50
+#define DATA_DESCRIPTOR_MAGIC           0x08074b50
+#define CENTRAL_DIRECTORY_MAGIC         0x02014b50
+#define END_OF_CENTRAL_DIRECTORY_MAGIC  0x06054b50
 
 #define DATA_DESCRIPTOR_FLAG  0x0008
 
@@ -56,15 +61,80 @@ struct zip_data_descriptor
 	uint32_t uncompressed;
 };
 
+struct zip_central_directory_header
+{
+	uint32_t magic;
+	uint16_t made_by_version;
+	uint16_t zip_version;
+	uint16_t flags;
+	uint16_t compression_type;
+	uint16_t mod_filetime;
+	uint16_t mod_filedate;
+	uint32_t crc32;
+	uint32_t compressed;
+	uint32_t uncompressed;
+	uint16_t len_filename;
+	uint16_t len_extra;
+	uint16_t len_comment;
+	uint16_t disk_number;
+	uint16_t internal_attributes;
+	uint32_t external_attributes;
+	uint32_t local_header;
+};
+
+struct zip_end_of_central_directory
+{
+	uint32_t magic;
+	uint16_t disk_number;
+	uint16_t central_directory_disk;
+	uint16_t disk_entries;
+	uint16_t entries;
+	uint32_t central_directory_size;
+	uint32_t central_directory_offset;
+	uint16_t len_comment;
+};
+
 #pragma pack(pop)
 
 struct zip_data
 {
+	enum class status
+	{
+		compressed, // The data has not been inflated, or has been read.
+		inflating,  // The data is being inflated.
+		inflated,   // The prefetched data is held in `cached` until it is read.
+	};
+
 	uint16_t compression_type;
+	const zip_header *header;
 	const char *begin;
 	uint32_t compressed;
 	uint32_t uncompressed;
+	status state;
 	std::shared_ptr<cainteoir::buffer> cached;
+
+	// The local header is only read when the data is needed, so opening an
+	// archive using the central directory does not read the local headers.
+	// This returns nullptr if the data is not within the archive.
+	const char *data(const char *aEnd) const
+	{
+		const char *ptr = begin;
+		if (!ptr)
+		{
+			ptr = (const char *)header;
+			if (aEnd - ptr < (ptrdiff_t)sizeof(zip_header) || header->magic != ZIP_HEADER_MAGIC)
+				return nullptr;
+
+			ptr += sizeof(zip_header);
+			if (aEnd - ptr < (ptrdiff_t)header->len_filename + header->len_extra)
+				return nullptr;
+			ptr += header->len_filename + header->len_extra;
+		}
+
+		if (ptr > aEnd || aEnd - ptr < (ptrdiff_t)compressed)
+			return nullptr;
+		return ptr;
+	}
 };
 
 static const std::initializer_list<cainteoir::decoder_ptr> zip_compression = {
@@ -83,46 +153,190 @@ static const std::initializer_list<cainteoir::decoder_ptr> zip_compression = {
 	nullptr, // 12 - bzip2 compressed
 };
 
+static const std::initializer_list<cainteoir::stream_decoder_ptr> zip_stream_compression = {
+	&cainteoir::copy_stream, // 0 - uncompressed
+	nullptr, // 1
+	nullptr, // 2
+	nullptr, // 3
+	nullptr, // 4
+	nullptr, // 5
+	nullptr, // 6 - imploded
+	nullptr, // 7
+	&cainteoir::inflate_zlib_stream, // 8 - deflated
+	nullptr, // 9
+	nullptr, // 10
+	nullptr, // 11
+	nullptr, // 12 - bzip2 compressed
+};
+
+// The compressed data of an archive entry. This keeps the archive data alive
+// while the entry is being read.
+struct zip_entry_buffer : public cainteoir::buffer
+{
+	zip_entry_buffer(const std::shared_ptr<cainteoir::buffer> &aData, const char *aBegin, const char *aEnd)
+		: cainteoir::buffer(aBegin, aEnd)
+		, mData(aData)
+	{
+	}
+
+	std::shared_ptr<cainteoir::buffer> mData;
+};
+
 class zip_archive : public cainteoir::archive
 {
 public:
 	zip_archive(std::shared_ptr<cainteoir::buffer> aData, const cainteoir::rdf::uri &aSubject);
 
+	~zip_archive();
+
 	const cainteoir::rdf::uri location(const std::string &aFilename, const std::string &aRef) const;
 
 	std::shared_ptr<cainteoir::buffer> read(const char *aFilename) const;
 
+	std::shared_ptr<cainteoir::buffer_reader> read_stream(const char *aFilename) const;
+
+	void prefetch(const std::list<std::string> &aFilenames, unsigned int aThreads) const;
+
 	const std::list<std::string> &files() const;
+
+	void inflate_prefetched_items() const;
 private:
+	bool read_central_directory();
+
+	void read_local_headers();
+
+	const zip_data *lookup(const char *aFilename) const;
+
+	std::shared_ptr<cainteoir::buffer> inflate(const zip_data &item) const;
+
 	std::shared_ptr<cainteoir::buffer> mData;
 	std::map<std::string, zip_data> data;
 	std::list<std::string> filelist;
 	std::string base;
+
+	mutable pthread_mutex_t mLock;
+	mutable pthread_cond_t mInflated;
+	mutable std::deque<zip_data *> mPrefetch;
+	mutable std::vector<pthread_t> mWorkers;
+	mutable unsigned int mActiveWorkers;
+	mutable bool mStopWorkers;
 };
 
+static void *inflate_prefetched_items_thread(void *data)
+{
+	((const zip_archive *)data)->inflate_prefetched_items();
+	return nullptr;
+}
+
 zip_archive::zip_archive(std::shared_ptr<cainteoir::buffer> aData, const cainteoir::rdf::uri &aSubject)
-	: base(aSubject.str() + "!/")
-	, mData(aData)
+	: mData(aData)
+	, base(aSubject.str() + "!/")
+	, mActiveWorkers(0)
+	, mStopWorkers(false)
 {
-	const zip_header * hdr = (const zip_header *)aData->begin();
-	while ((const char *)hdr < aData->end() && hdr->magic == ZIP_HEADER_MAGIC)
+	if (!read_central_directory())
+		read_local_headers();
+
+	pthread_mutex_init(&mLock, nullptr);
+	pthread_cond_init(&mInflated, nullptr);
+}
+
+zip_archive::~zip_archive()
+{
+	pthread_mutex_lock(&mLock);
+	mStopWorkers = true;
+	mPrefetch.clear();
+	pthread_mutex_unlock(&mLock);
+
+	for (auto &worker : mWorkers)
+		pthread_join(worker, nullptr);
+
+	pthread_cond_destroy(&mInflated);
+	pthread_mutex_destroy(&mLock);
+}
+
+bool zip_archive::read_central_directory()
+{
+	const char *first = mData->begin();
+	const char *last  = mData->end();
+	if (last - first < (ptrdiff_t)sizeof(zip_end_of_central_directory))
+		return false;
+
+	// The end of central directory record is at the end of the file,
+	// followed by a comment of up to 65535 bytes.
+	const char *eocd = last - sizeof(zip_end_of_central_directory);
+	const char *limit = (last - first > 65535 + (ptrdiff_t)sizeof(zip_end_of_central_directory))
+	                  ? eocd - 65535 : first;
+	while (eocd >= limit && *(const uint32_t *)eocd != END_OF_CENTRAL_DIRECTORY_MAGIC)
+		--eocd;
+	if (eocd < limit)
+		return false;
+
+	const zip_end_of_central_directory *end = (const zip_end_of_central_directory *)eocd;
+	if (end->central_directory_offset > eocd - first ||
+	    end->central_directory_size > eocd - first - end->central_directory_offset)
+		return false;
+
+	std::map<std::string, zip_data> entries;
+	std::list<std::string> names;
+
+	const char *ptr = first + end->central_directory_offset;
+	const char *cd_end = ptr + end->central_directory_size;
+	for (uint16_t i = 0; i != end->entries; ++i)
+	{
+		const zip_central_directory_header *hdr = (const zip_central_directory_header *)ptr;
+		if (cd_end - ptr < (ptrdiff_t)sizeof(zip_central_directory_header) || hdr->magic != CENTRAL_DIRECTORY_MAGIC)
+			return false;
+
+		const char *name = ptr + sizeof(zip_central_directory_header);
+		ptr = name + hdr->len_filename + hdr->len_extra + hdr->len_comment;
+		if (ptr > cd_end || hdr->local_header > eocd - first - sizeof(zip_header))
+			return false;
+
+		std::string filename(name, name + hdr->len_filename);
+
+		zip_data &item = entries[filename];
+		names.push_back(filename);
+
+		item.compression_type = hdr->compression_type;
+		item.header = (const zip_header *)(first + hdr->local_header);
+		item.begin = nullptr;
+		item.compressed = hdr->compressed;
+		item.uncompressed = hdr->uncompressed;
+		item.state = zip_data::status::compressed;
+	}
+
+	data.swap(entries);
+	filelist.swap(names);
+	return true;
+}
+
+void zip_archive::read_local_headers()
+{
+	const zip_header * hdr = (const zip_header *)mData->begin();
+	while (mData->end() - (const char *)hdr >= (ptrdiff_t)sizeof(zip_header) && hdr->magic == ZIP_HEADER_MAGIC)
 	{
 		const char *ptr = (const char *)hdr + sizeof(zip_header);
+		if (mData->end() - ptr < (ptrdiff_t)hdr->len_filename + hdr->len_extra)
+			break;
+
 		std::string filename(ptr, ptr + hdr->len_filename);
 
 		zip_data &item = data[filename];
 		filelist.push_back(filename);
 
 		item.compression_type = hdr->compression_type;
+		item.header = hdr;
 		item.begin = ptr + hdr->len_filename + hdr->len_extra;
+		item.state = zip_data::status::compressed;
 		if ((hdr->flags & DATA_DESCRIPTOR_FLAG) == DATA_DESCRIPTOR_FLAG)
 		{
 			const char *magic = item.begin;
-			while (magic < aData->end() && *(const uint32_t *)magic != DATA_DESCRIPTOR_MAGIC)
+			while (magic < mData->end() && *(const uint32_t *)magic != DATA_DESCRIPTOR_MAGIC)
 				++magic;
 
 			const zip_data_descriptor *descriptor = (const zip_data_descriptor *)magic;
-			if (magic >= aData->end())
+			if (magic >= mData->end())
 				throw std::runtime_error(i18n("zip file data descriptor entry not found"));
 
 			item.compressed = descriptor->compressed;
@@ -143,7 +357,7 @@ const cainteoir::rdf::uri zip_archive::location(const std::string &aFilename, co
 	return cainteoir::rdf::uri(base + aFilename, aRef);
 }
 
-std::shared_ptr<cainteoir::buffer> zip_archive::read(const char *aFilename) const
+const zip_data *zip_archive::lookup(const char *aFilename) const
 {
 	std::string filename = aFilename;
 	auto entry = data.find(filename);
@@ -158,18 +372,142 @@ std::shared_ptr<cainteoir::buffer> zip_archive::read(const char *aFilename) cons
 		entry = data.find(filename);
 	}
 	if (entry == data.end())
-		return std::shared_ptr<cainteoir::buffer>();
+		return nullptr;
+	return &entry->second;
+}
 
-	const zip_data &item = entry->second;
-	if (item.cached) return item.cached;
+std::shared_ptr<cainteoir::buffer> zip_archive::inflate(const zip_data &item) const
+{
+	if (item.compression_type >= zip_compression.size())
+		throw std::runtime_error(i18n("decompression failed (unsupported compression type)"));
 
 	auto decoder = *(zip_compression.begin() + item.compression_type);
-	if (item.compression_type >= zip_compression.size() || decoder == nullptr)
+	if (decoder == nullptr)
+		throw std::runtime_error(i18n("decompression failed (unsupported compression type)"));
+
+	const char *begin = item.data(mData->end());
+	if (!begin)
+		throw std::runtime_error(i18n("zip file entry data is outside of the archive"));
+	cainteoir::buffer compressed { begin, begin + item.compressed };
+
+	return decoder(compressed, item.uncompressed);
+}
+
+std::shared_ptr<cainteoir::buffer> zip_archive::read(const char *aFilename) const
+{
+	zip_data *item = const_cast<zip_data *>(lookup(aFilename));
+	if (!item)
+		return std::shared_ptr<cainteoir::buffer>();
+
+	pthread_mutex_lock(&mLock);
+	while (item->state == zip_data::status::inflating) // being inflated by a prefetch thread
+		pthread_cond_wait(&mInflated, &mLock);
+
+	// The reader takes the prefetched data, so the archive does not keep the
+	// inflated data after it has been read.
+	if (item->state == zip_data::status::inflated)
+	{
+		std::shared_ptr<cainteoir::buffer> cached = item->cached;
+		item->cached.reset();
+		item->state = zip_data::status::compressed;
+		pthread_mutex_unlock(&mLock);
+		return cached;
+	}
+
+	item->state = zip_data::status::inflating;
+	pthread_mutex_unlock(&mLock);
+
+	std::shared_ptr<cainteoir::buffer> inflated;
+	try
+	{
+		inflated = inflate(*item);
+	}
+	catch (...)
+	{
+		pthread_mutex_lock(&mLock);
+		item->state = zip_data::status::compressed;
+		pthread_cond_broadcast(&mInflated);
+		pthread_mutex_unlock(&mLock);
+		throw;
+	}
+
+	pthread_mutex_lock(&mLock);
+	item->state = zip_data::status::compressed;
+	pthread_cond_broadcast(&mInflated);
+	pthread_mutex_unlock(&mLock);
+	return inflated;
+}
+
+std::shared_ptr<cainteoir::buffer_reader> zip_archive::read_stream(const char *aFilename) const
+{
+	const zip_data *item = lookup(aFilename);
+	if (!item)
+		return std::shared_ptr<cainteoir::buffer_reader>();
+
+	if (item->compression_type >= zip_stream_compression.size())
+		throw std::runtime_error(i18n("decompression failed (unsupported compression type)"));
+
+	auto decoder = *(zip_stream_compression.begin() + item->compression_type);
+	if (decoder == nullptr)
 		throw std::runtime_error(i18n("decompression failed (unsupported compression type)"));
 
-	cainteoir::buffer compressed { item.begin, item.begin + item.compressed };
+	const char *begin = item->data(mData->end());
+	if (!begin)
+		throw std::runtime_error(i18n("zip file entry data is outside of the archive"));
+	return decoder(std::make_shared<zip_entry_buffer>(mData, begin, begin + item->compressed), item->uncompressed);
+}
 
-	return const_cast<zip_data &>(item).cached = decoder(compressed, item.uncompressed);
+void zip_archive::prefetch(const std::list<std::string> &aFilenames, unsigned int aThreads) const
+{
+	pthread_mutex_lock(&mLock);
+	for (auto &filename : aFilenames)
+	{
+		zip_data *item = const_cast<zip_data *>(lookup(filename.c_str()));
+		if (item && item->state == zip_data::status::compressed)
+			mPrefetch.push_back(item);
+	}
+
+	while (mActiveWorkers < aThreads && mActiveWorkers < mPrefetch.size())
+	{
+		pthread_t worker;
+		if (pthread_create(&worker, nullptr, inflate_prefetched_items_thread, (void *)this) != 0)
+			break;
+		mWorkers.push_back(worker);
+		++mActiveWorkers;
+	}
+	pthread_mutex_unlock(&mLock);
+}
+
+void zip_archive::inflate_prefetched_items() const
+{
+	pthread_mutex_lock(&mLock);
+	while (!mStopWorkers && !mPrefetch.empty())
+	{
+		zip_data *item = mPrefetch.front();
+		mPrefetch.pop_front();
+		if (item->state != zip_data::status::compressed)
+			continue;
+
+		item->state = zip_data::status::inflating;
+		pthread_mutex_unlock(&mLock);
+
+		// Errors are reported when the item is read.
+		std::shared_ptr<cainteoir::buffer> inflated;
+		try
+		{
+			inflated = inflate(*item);
+		}
+		catch (const std::exception &)
+		{
+		}
+
+		pthread_mutex_lock(&mLock);
+		item->cached = inflated;
+		item->state = inflated ? zip_data::status::inflated : zip_data::status::compressed;
+		pthread_cond_broadcast(&mInflated);
+	}
+	--mActiveWorkers;
+	pthread_mutex_unlock(&mLock);
 }
 
 const std::list<std::string> &zip_archive::files() const
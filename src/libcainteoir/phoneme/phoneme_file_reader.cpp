@@ -358,18 +358,19 @@ void tts::phoneme_file_reader::read_feature(feature_t &aFeature)
 
 tts::transcription_reader::transcription_reader(tts::phoneme_file_reader &aPhonemeSet)
 {
+	cainteoir::trie<phoneme_t> phonemes;
 	while (aPhonemeSet.read()) switch (aPhonemeSet.type)
 	{
 	case tts::placement::primary:
 		if (aPhonemeSet.phonemes.size() != 1)
 			throw std::runtime_error("ipa-style phonemesets only support mapping to one phoneme");
 
-		mPhonemes.insert(*aPhonemeSet.transcription, { aPhonemeSet.phonemes.front() });
+		phonemes.insert(*aPhonemeSet.transcription, { aPhonemeSet.phonemes.front() });
 		break;
 	case tts::placement::before:
 	case tts::placement::after:
 		{
-			auto &phoneme = mPhonemes.insert(*aPhonemeSet.transcription);
+			auto &phoneme = phonemes.insert(*aPhonemeSet.transcription);
 			phoneme.type = aPhonemeSet.type;
 			switch (aPhonemeSet.feature.type())
 			{
@@ -383,9 +384,10 @@ tts::transcription_reader::transcription_reader(tts::phoneme_file_reader &aPhone
 		}
 		break;
 	case tts::placement::tone:
-		mPhonemes.insert(*aPhonemeSet.transcription, { aPhonemeSet.tone_level });
+		phonemes.insert(*aPhonemeSet.transcription, { aPhonemeSet.tone_level });
 		break;
 	}
+	mPhonemes = phonemes.compile();
 }
 
 std::pair<bool, ipa::phoneme> tts::transcription_reader::read(const char * &mCurrent, const char *mEnd) const
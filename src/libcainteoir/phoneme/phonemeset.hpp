@@ -184,7 +184,7 @@ namespace cainteoir { namespace tts
 			}
 		};
 
-		cainteoir::trie<phoneme_t> mPhonemes;
+		cainteoir::compiled_trie<phoneme_t> mPhonemes;
 
 		std::pair<const char *, const phoneme_t &>
 		next_match(const char *mCurrent, const char *mEnd) const;
@@ -89,6 +89,52 @@ const rql::detail::subject_t   rql::subject;
 const rql::detail::predicate_t rql::predicate;
 const rql::detail::object_t    rql::object;
 
+void rdf::triplestore::push_back(const_reference item)
+{
+	query::results::push_back(item);
+
+	// Statements with a literal object are indexed using the empty URI, as
+	// that is what query::object returns for them.
+	uint32_t s = intern(item->subject);
+	uint32_t p = intern(item->predicate);
+	uint32_t o = intern(query::object(item));
+
+	subjects[s].push_back(item);
+	predicates[p].push_back(item);
+	objects[o].push_back(item);
+	subject_predicates[key(s, p)].push_back(item);
+	predicate_objects[key(p, o)].push_back(item);
+}
+
+uint32_t rdf::triplestore::intern(const rdf::uri &aUri)
+{
+	return ids.insert({ aUri, (uint32_t)ids.size() }).first->second;
+}
+
+const rql::results &rdf::triplestore::lookup(const index_t &aIndex, uint32_t aId)
+{
+	static const query::results empty;
+	if (aId == npos)
+		return empty;
+
+	auto ret = aIndex.find(aId);
+	if (ret == aIndex.end())
+		return empty;
+	return ret->second;
+}
+
+const rql::results &rdf::triplestore::lookup(const pair_index_t &aIndex, uint32_t aFirst, uint32_t aSecond)
+{
+	static const query::results empty;
+	if (aFirst == npos || aSecond == npos)
+		return empty;
+
+	auto ret = aIndex.find(key(aFirst, aSecond));
+	if (ret == aIndex.end())
+		return empty;
+	return ret->second;
+}
+
 rdf::graph::graph() : mContext(std::make_shared<context>())
 {
 	add_namespace("http",   "http:");
@@ -206,17 +252,17 @@ void cainteoir::rdf::query::rdf_list_items(const rdf::graph &aMetadata,
                                            const rdf::uri &aPredicate,
                                            const std::function<void (const std::shared_ptr<const triple> &aStatement)> &onlistitem)
 {
-	auto start = rql::select(aMetadata, rql::subject == aSubject && rql::predicate == aPredicate);
+	const auto &start = rql::select(aMetadata, rql::subject == aSubject && rql::predicate == aPredicate);
 	if (start.empty()) return;
 
 	const rdf::uri *item = &rql::object(start.front());
 	while (item)
 	{
-		auto first = rql::select(aMetadata, rql::subject == *item && rql::predicate == rdf::rdf("first"));
+		const auto &first = rql::select(aMetadata, rql::subject == *item && rql::predicate == rdf::rdf("first"));
 		if (!first.empty())
 			onlistitem(first.front());
 
-		auto rest = rql::select(aMetadata, rql::subject == *item && rql::predicate == rdf::rdf("rest"));
+		const auto &rest = rql::select(aMetadata, rql::subject == *item && rql::predicate == rdf::rdf("rest"));
 		if (!rest.empty())
 		{
 			item = &rql::object(rest.front());
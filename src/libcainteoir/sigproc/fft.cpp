@@ -1,6 +1,6 @@
 /* Fast fourier transform.
  *
- * Copyright (C) 2014 Reece H. Dunn
+ * Copyright (C) 2014-2015 Reece H. Dunn
  *
  * This file is part of cainteoir-engine.
  *
@@ -22,7 +22,16 @@
 #include "compatibility.hpp"
 
 #include <cainteoir/sigproc.hpp>
+#include <stdexcept>
+#include <atomic>
 #include <cmath>
+#include <pthread.h>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#endif
 
 static uint32_t log2(uint32_t aValue)
 {
@@ -32,43 +41,167 @@ static uint32_t log2(uint32_t aValue)
 	return exponent;
 }
 
-static void fft(cainteoir::complex_array &aData, int sign)
+// Twiddle Factors /////////////////////////////////////////////////////////////
+//
+// The butterflies in the FFT stage where the butterfly span is N use the
+// twiddle factors:
+//
+//     w[j] = exp(-i * pi * j / N), for j = 0 .. N-1
+//
+// These only depend on the span and not the size of the FFT, so each table is
+// shared by all the FFT sizes that use it. The tables are created when first
+// used and are never modified after that, so they can be read without locking.
+
+static std::atomic<const cainteoir::complex *> twiddle_tables[32];
+static pthread_mutex_t twiddle_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static const cainteoir::complex *twiddles(uint32_t aSpan)
 {
-	uint32_t size = aData.size();
-	uint32_t m = log2(size);
+	uint32_t index = log2(aSpan);
+	const cainteoir::complex *table = twiddle_tables[index].load(std::memory_order_acquire);
+	if (table)
+		return table;
 
-	if (size == 0 || (size & (size - 1)) != 0) // if size is not a power of 2 ...
-		throw std::runtime_error("FFT data must have 2^n elements (for any n > 0)");
+	pthread_mutex_lock(&twiddle_lock);
+	table = twiddle_tables[index].load(std::memory_order_relaxed);
+	if (!table)
+	{
+		cainteoir::complex *w = new cainteoir::complex[aSpan];
+		for (uint32_t j = 0; j < aSpan; ++j)
+		{
+			double theta = M_PI * j / aSpan;
+			w[j] = { (float)cos(theta), (float)-sin(theta) };
+		}
+		twiddle_tables[index].store(w, std::memory_order_release);
+		table = w;
+	}
+	pthread_mutex_unlock(&twiddle_lock);
+	return table;
+}
 
-	cainteoir::complex *data = &aData[0];
+// Butterfly Kernels ///////////////////////////////////////////////////////////
+//
+// Calculate the decimation-in-frequency butterflies:
+//
+//     a'[j] = a[j] + c[j]
+//     c'[j] = (a[j] - c[j]) * w[j]
 
-	uint32_t le  = size;
-	uint32_t le1 = size;
-	for (uint32_t l = 0; l < m; ++l)
+static inline void butterflies_scalar(cainteoir::complex *a,
+                                      cainteoir::complex *c,
+                                      const cainteoir::complex *w,
+                                      uint32_t n)
+{
+	for (uint32_t j = 0; j < n; ++j)
 	{
-		le    = le1;
-		le1 >>= 1;
+		cainteoir::complex p = { a[j].re + c[j].re, a[j].im + c[j].im };
+		cainteoir::complex q = { a[j].re - c[j].re, a[j].im - c[j].im };
 
-		cainteoir::complex u = { 1.0f, 0.0f };
-		cainteoir::complex w = { cosf(M_PI / le1), sign * sinf(M_PI / le1) };
+		c[j].re = q.re*w[j].re - q.im*w[j].im;
+		c[j].im = q.re*w[j].im + q.im*w[j].re;
 
-		for (auto b = data, bend = data + le1; b < bend; ++b)
-		{
-			for (auto a = b, aend = data + size - le1; a < aend; a += le)
-			{
-				cainteoir::complex *c = a + le1;
+		a[j] = p;
+	}
+}
 
-				cainteoir::complex p = { a->re + c->re, a->im + c->im };
-				cainteoir::complex q = { a->re - c->re, a->im - c->im };
+#if defined(__AVX__)
 
-				c->re = q.re*u.re - q.im*u.im;
-				c->im = q.re*u.im + q.im*u.re;
+static inline uint32_t butterflies_simd(cainteoir::complex *a,
+                                        cainteoir::complex *c,
+                                        const cainteoir::complex *w,
+                                        uint32_t n)
+{
+	uint32_t j = 0;
+	for (; j + 4 <= n; j += 4)
+	{
+		__m256 x = _mm256_loadu_ps((const float *)(a + j));
+		__m256 y = _mm256_loadu_ps((const float *)(c + j));
+		__m256 t = _mm256_loadu_ps((const float *)(w + j));
 
-				*a = p;
-			}
+		__m256 q  = _mm256_sub_ps(x, y);
+		__m256 qs = _mm256_permute_ps(q, _MM_SHUFFLE(2, 3, 0, 1));
+		__m256 r  = _mm256_addsub_ps(_mm256_mul_ps(q,  _mm256_moveldup_ps(t)),
+		                             _mm256_mul_ps(qs, _mm256_movehdup_ps(t)));
 
-			u = { u.re*w.re - u.im*w.im, u.re*w.im + u.im*w.re };
-		}
+		_mm256_storeu_ps((float *)(a + j), _mm256_add_ps(x, y));
+		_mm256_storeu_ps((float *)(c + j), r);
+	}
+	return j;
+}
+
+#elif defined(__SSE__)
+
+static inline uint32_t butterflies_simd(cainteoir::complex *a,
+                                        cainteoir::complex *c,
+                                        const cainteoir::complex *w,
+                                        uint32_t n)
+{
+	const __m128 negate_re = _mm_set_ps(0.0f, -0.0f, 0.0f, -0.0f);
+
+	uint32_t j = 0;
+	for (; j + 2 <= n; j += 2)
+	{
+		__m128 x = _mm_loadu_ps((const float *)(a + j));
+		__m128 y = _mm_loadu_ps((const float *)(c + j));
+		__m128 t = _mm_loadu_ps((const float *)(w + j));
+
+		__m128 q  = _mm_sub_ps(x, y);
+		__m128 qs = _mm_shuffle_ps(q, q, _MM_SHUFFLE(2, 3, 0, 1));
+		__m128 wr = _mm_shuffle_ps(t, t, _MM_SHUFFLE(2, 2, 0, 0));
+		__m128 wi = _mm_shuffle_ps(t, t, _MM_SHUFFLE(3, 3, 1, 1));
+		__m128 r  = _mm_add_ps(_mm_mul_ps(q, wr),
+		                       _mm_xor_ps(_mm_mul_ps(qs, wi), negate_re));
+
+		_mm_storeu_ps((float *)(a + j), _mm_add_ps(x, y));
+		_mm_storeu_ps((float *)(c + j), r);
+	}
+	return j;
+}
+
+#else
+
+static inline uint32_t butterflies_simd(cainteoir::complex *a,
+                                        cainteoir::complex *c,
+                                        const cainteoir::complex *w,
+                                        uint32_t n)
+{
+	return 0;
+}
+
+#endif
+
+static inline void butterflies(cainteoir::complex *a,
+                               cainteoir::complex *c,
+                               const cainteoir::complex *w,
+                               uint32_t n)
+{
+	uint32_t j = butterflies_simd(a, c, w, n);
+	butterflies_scalar(a + j, c + j, w + j, n - j);
+}
+
+// Complex FFT /////////////////////////////////////////////////////////////////
+
+static void fft(cainteoir::complex *data, uint32_t size)
+{
+	if (size == 0 || (size & (size - 1)) != 0) // if size is not a power of 2 ...
+		throw std::runtime_error("FFT data must have 2^n elements (for any n > 0)");
+
+	if (size == 1)
+		return;
+
+	for (uint32_t le = size, le1 = size >> 1; le1 > 1; le = le1, le1 >>= 1)
+	{
+		const cainteoir::complex *w = twiddles(le1);
+		for (auto a = data, end = data + size; a < end; a += le)
+			butterflies(a, a + le1, w, le1);
+	}
+
+	// The last stage has a span of 1, so the twiddle factor is always 1.
+	for (auto a = data, end = data + size; a < end; a += 2)
+	{
+		cainteoir::complex p = { a[0].re + a[1].re, a[0].im + a[1].im };
+		cainteoir::complex q = { a[0].re - a[1].re, a[0].im - a[1].im };
+		a[0] = p;
+		a[1] = q;
 	}
 
 	auto b = data;
@@ -84,19 +217,90 @@ static void fft(cainteoir::complex_array &aData, int sign)
 	}
 }
 
+static void conjugate(cainteoir::complex_array &aData)
+{
+	for (auto & c : aData)
+		c.im = -c.im;
+}
+
 void cainteoir::fft(complex_array &aData)
 {
-	::fft(aData, -1);
+	::fft(aData.data(), aData.size());
 }
 
 void cainteoir::ifft(complex_array &aData)
 {
-	::fft(aData, 1);
+	// ifft(x) = conj(fft(conj(x))) / N, so only the forward twiddle factors
+	// and kernels are needed.
+
+	conjugate(aData);
+	::fft(aData.data(), aData.size());
 
-	float n = aData.size();
+	float scale = 1.0f / aData.size();
 	for (auto & c : aData)
 	{
-		c.re /= n;
-		c.im /= n;
+		c.re *=  scale;
+		c.im *= -scale;
+	}
+}
+
+// Real-Input FFT //////////////////////////////////////////////////////////////
+//
+// The N real samples x[n] are packed into N/2 complex values:
+//
+//     z[k] = x[2k] + i*x[2k+1]
+//
+// and an N/2 point FFT is performed on them. The spectrum of the real samples
+// is then calculated from the spectrum Z of the packed values using:
+//
+//     Fe[k] = (Z[k] + conj(Z[N/2-k])) / 2
+//     Fo[k] = -i * (Z[k] - conj(Z[N/2-k])) / 2
+//     X[k]  = Fe[k] + exp(-2*pi*i*k/N) * Fo[k]
+//
+// with the rest of the spectrum given by X[N-k] = conj(X[k]).
+
+void cainteoir::rfft(complex_array &aData)
+{
+	uint32_t size = aData.size();
+	if (size == 0 || (size & (size - 1)) != 0) // if size is not a power of 2 ...
+		throw std::runtime_error("FFT data must have 2^n elements (for any n > 0)");
+
+	cainteoir::complex *data = aData.data();
+	if (size == 1)
+	{
+		data->im = 0.0f;
+		return;
+	}
+
+	uint32_t half = size / 2;
+	for (uint32_t k = 0; k < half; ++k)
+		data[k] = { data[2*k].re, data[2*k + 1].re };
+
+	::fft(data, half);
+
+	// The twiddle table for a span of N/2 holds exp(-2*pi*i*k/N).
+	const cainteoir::complex *w = twiddles(half);
+
+	cainteoir::complex z0 = data[0];
+	data[0]    = { z0.re + z0.im, 0.0f };
+	data[half] = { z0.re - z0.im, 0.0f };
+
+	for (uint32_t k = 1; k <= half / 2; ++k)
+	{
+		cainteoir::complex a = data[k];
+		cainteoir::complex b = data[half - k];
+
+		cainteoir::complex fe = { (a.re + b.re) * 0.5f, (a.im - b.im) * 0.5f };
+		cainteoir::complex fo = { (a.im + b.im) * 0.5f, (b.re - a.re) * 0.5f };
+		cainteoir::complex t  = { fo.re*w[k].re - fo.im*w[k].im,
+		                          fo.re*w[k].im + fo.im*w[k].re };
+
+		cainteoir::complex x  = { fe.re + t.re,  fe.im + t.im };
+		cainteoir::complex y  = { fe.re - t.re, -fe.im + t.im }; // X[N/2-k] = conj(Fe[k] - t)
+
+		data[k]               = x;
+		data[size - k]        = { x.re, -x.im };
+		data[half - k]        = y;
+		data[half + k]        = { y.re, -y.im };
 	}
 }
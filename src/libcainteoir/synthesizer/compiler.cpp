@@ -28,6 +28,9 @@
 
 #include "synth.hpp"
 
+#include <algorithm>
+#include <cmath>
+
 namespace tts = cainteoir::tts;
 namespace ipa = cainteoir::ipa;
 namespace css = cainteoir::css;
@@ -70,6 +73,8 @@ struct binary_file_writer
 	void u32(uint32_t u) { fwrite(&u, sizeof(u), 1, mOutput); }
 	void u64(uint64_t u) { fwrite(&u, sizeof(u), 1, mOutput); }
 
+	void bytes(const void *data, size_t size) { fwrite(data, 1, size, mOutput); }
+
 	void f8_8(float f);
 	void f16_16(float f);
 
@@ -78,6 +83,8 @@ struct binary_file_writer
 
 	void pstr(const cainteoir::buffer &data) { pstr(data.str()); }
 	void pstr(const std::string &data);
+
+	uint32_t offset() const { return mOffset; }
 private:
 	FILE *mOutput;
 	uint32_t mOffset;
@@ -177,6 +184,144 @@ struct phoneme_t
 	std::list<unit_t> units;
 };
 
+struct unit_audio_t
+{
+	std::string name;
+	std::vector<int16_t> samples;
+	std::vector<uint32_t> marks;
+};
+
+static uint32_t read_le(const uint8_t *data, int bytes)
+{
+	uint32_t value = 0;
+	for (int i = bytes - 1; i >= 0; --i)
+		value = (value << 8) | data[i];
+	return value;
+}
+
+// Read the samples from a 16-bit mono PCM WAVE file.
+static void
+read_unit_audio(const cainteoir::path &aFileName, uint16_t aFrequency, std::vector<int16_t> &aSamples)
+{
+	auto data = cainteoir::make_file_buffer(aFileName);
+	if (!data)
+		throw std::runtime_error("unable to read the unit audio file");
+
+	const uint8_t *current = (const uint8_t *)data->begin();
+	const uint8_t *last = (const uint8_t *)data->end();
+	if (last - current < 12 || memcmp(current, "RIFF", 4) != 0 || memcmp(current + 8, "WAVE", 4) != 0)
+		throw std::runtime_error("unit audio is not a WAVE file");
+
+	bool have_format = false;
+	current += 12;
+	while (last - current >= 8)
+	{
+		uint32_t size = read_le(current + 4, 4);
+		const uint8_t *chunk = current + 8;
+		if (size > (uint32_t)(last - chunk))
+			size = last - chunk;
+
+		if (memcmp(current, "fmt ", 4) == 0 && size >= 16)
+		{
+			if (read_le(chunk, 2) != 1 || read_le(chunk + 2, 2) != 1 || read_le(chunk + 14, 2) != 16)
+				throw std::runtime_error("unit audio is not 16-bit mono PCM audio");
+			if (read_le(chunk + 4, 4) != aFrequency)
+				throw std::runtime_error("unit audio does not match the voice frequency");
+			have_format = true;
+		}
+		else if (memcmp(current, "data", 4) == 0)
+		{
+			if (!have_format)
+				throw std::runtime_error("unit audio does not have a format chunk");
+			aSamples.reserve(size / 2);
+			for (uint32_t i = 0; i + 1 < size; i += 2)
+				aSamples.push_back((int16_t)read_le(chunk + i, 2));
+			return;
+		}
+
+		current = chunk + size + (size & 1);
+	}
+
+	throw std::runtime_error("unit audio does not have a data chunk");
+}
+
+// Find the pitch marks used to overlap-add the unit audio. In voiced regions,
+// a mark is placed on the peak of each pitch period, using autocorrelation to
+// find the period. Unvoiced regions are marked at a fixed interval.
+static void
+find_pitch_marks(const std::vector<int16_t> &aSamples, uint16_t aFrequency, std::vector<uint32_t> &aMarks)
+{
+	const uint32_t min_period = aFrequency / 400;
+	const uint32_t max_period = aFrequency / 60;
+	const uint32_t unvoiced_period = aFrequency / 200;
+	const uint32_t n = aSamples.size();
+
+	std::vector<double> correlation(max_period + 1);
+	uint32_t pos = 0;
+	uint32_t period = 0;
+	while (pos < n)
+	{
+		if (pos + 2 * max_period <= n)
+		{
+			double best = 0.0;
+			for (uint32_t lag = min_period; lag <= max_period; ++lag)
+			{
+				double xy = 0.0, xx = 0.0, yy = 0.0;
+				for (uint32_t i = 0; i < max_period; ++i)
+				{
+					double x = aSamples[pos + i];
+					double y = aSamples[pos + i + lag];
+					xy += x * y;
+					xx += x * x;
+					yy += y * y;
+				}
+				correlation[lag] = (xx * yy > 0.0) ? xy / sqrt(xx * yy) : 0.0;
+				best = std::max(best, correlation[lag]);
+			}
+
+			// Use the shortest period close to the best match, to avoid
+			// picking a multiple of the pitch period.
+			period = 0;
+			if (best >= 0.7) for (uint32_t lag = min_period; lag <= max_period; ++lag)
+			{
+				if (correlation[lag] >= 0.9 * best &&
+				    (lag == max_period || correlation[lag] >= correlation[lag + 1]))
+				{
+					period = lag;
+					break;
+				}
+			}
+		}
+
+		if (period == 0)
+		{
+			aMarks.push_back(pos);
+			pos += unvoiced_period;
+			continue;
+		}
+
+		// Place the mark on the highest sample in the pitch period, searching
+		// around the expected position if the previous mark was voiced.
+		uint32_t first = pos;
+		uint32_t last = std::min(pos + period, n);
+		if (!aMarks.empty() && (aMarks.back() & tts::PITCH_MARK_VOICED))
+		{
+			first = std::max(pos - period / 4, (aMarks.back() & tts::PITCH_MARK_OFFSET) + 1);
+			last = std::min(pos + period / 4 + 1, n);
+		}
+
+		uint32_t mark = first;
+		for (uint32_t i = first; i < last; ++i)
+		{
+			if (aSamples[i] > aSamples[mark])
+				mark = i;
+		}
+
+		aMarks.push_back(mark | tts::PITCH_MARK_VOICED);
+		pos = mark + period;
+	}
+}
+
 static phoneme_t
 parse_phoneme(cainteoir_file_reader &reader, const std::shared_ptr<tts::phoneme_parser> &parser)
 {
@@ -315,6 +460,8 @@ tts::compile_voice(const char *aFileName, FILE *aOutput)
 	uint16_t duration_entries = 0;
 	uint16_t unit_entries = 0;
 
+	std::list<unit_audio_t> unit_audio;
+
 	auto reader = cainteoir_file_reader(cainteoir::path(aFileName));
 	while (reader.read())
 	{
@@ -411,6 +558,34 @@ tts::compile_voice(const char *aFileName, FILE *aOutput)
 
 				pitch_sdev = css::parse_frequency(reader.match());
 			}
+			else if (reader.match().compare("audio") == 0)
+			{
+				if (!reader.read() || reader.type() != cainteoir_file_reader::string)
+					throw std::runtime_error("expected unit name");
+
+				unit_audio.push_back({ reader.match().str(), {}, {} });
+
+				if (!reader.read() || (reader.type() != cainteoir_file_reader::text && reader.type() != cainteoir_file_reader::string))
+					throw std::runtime_error("expected unit audio file name");
+
+				if (frequency < 500)
+					throw std::runtime_error("the voice frequency is too low for unit audio");
+
+				auto filename = cainteoir::path(aFileName).parent() / reader.match().str();
+				read_unit_audio(filename, frequency, unit_audio.back().samples);
+				find_pitch_marks(unit_audio.back().samples, frequency, unit_audio.back().marks);
+			}
+		}
+	}
+
+	if (!unit_audio.empty())
+	{
+		for (const auto &entry : phonemes) for (const auto &unit : entry.units)
+		{
+			auto match = std::find_if(unit_audio.begin(), unit_audio.end(),
+				[&unit](const unit_audio_t &audio) { return unit.name.compare(audio.name.c_str()) == 0; });
+			if (match == unit_audio.end())
+				throw std::runtime_error("no audio for unit `" + unit.name.str() + "`");
 		}
 	}
 
@@ -489,6 +664,44 @@ tts::compile_voice(const char *aFileName, FILE *aOutput)
 		}
 		out.end_section();
 	}
+
+	if (!unit_audio.empty())
+	{
+		// The pitch marks and samples are aligned to 4 bytes so they can be
+		// used directly from the memory mapped voice file.
+		uint32_t data_start = out.offset() + tts::UNIT_AUDIO_TABLE_SIZE + (unit_audio.size() * tts::UNIT_AUDIO_TABLE_ENTRY_SIZE);
+		uint32_t padding = (4 - (data_start % 4)) % 4;
+		uint32_t data_size = padding;
+		for (const auto &audio : unit_audio)
+			data_size += (audio.marks.size() * sizeof(uint32_t)) + (((audio.samples.size() + 1) / 2) * 4);
+
+		out.begin_section("UAD", tts::UNIT_AUDIO_TABLE_SIZE + (unit_audio.size() * tts::UNIT_AUDIO_TABLE_ENTRY_SIZE) + data_size, true);
+		out.u16(unit_audio.size());
+		out.u32(data_size);
+		uint32_t offset = data_start + padding;
+		for (const auto &audio : unit_audio)
+		{
+			out.pstr(audio.name);
+			out.u32(offset + (audio.marks.size() * sizeof(uint32_t)));
+			out.u32(audio.samples.size());
+			out.u32(offset);
+			out.u32(audio.marks.size());
+			offset += (audio.marks.size() * sizeof(uint32_t)) + (((audio.samples.size() + 1) / 2) * 4);
+		}
+
+		const uint8_t zero[4] = { 0, 0, 0, 0 };
+		out.bytes(zero, padding);
+		for (const auto &audio : unit_audio)
+		{
+			if (!audio.marks.empty())
+				out.bytes(&audio.marks[0], audio.marks.size() * sizeof(uint32_t));
+			if (!audio.samples.empty())
+				out.bytes(&audio.samples[0], audio.samples.size() * sizeof(int16_t));
+			if (audio.samples.size() % 2)
+				out.bytes(zero, 2);
+		}
+		out.end_section();
+	}
 }
 
 void
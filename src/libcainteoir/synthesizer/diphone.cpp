@@ -28,97 +28,145 @@ namespace tts = cainteoir::tts;
 namespace ipa = cainteoir::ipa;
 namespace css = cainteoir::css;
 
-struct diphone_reader : public tts::prosody_reader
+struct diphone_reader : public tts::prosody_block_reader
 {
-	diphone_reader(const std::shared_ptr<tts::prosody_reader> &aProsody);
+	diphone_reader(const std::shared_ptr<tts::prosody_block_reader> &aProsody);
 
-	bool read();
+	bool read(tts::prosody_block &aBlock, std::size_t aMaxCount);
 private:
-	std::shared_ptr<tts::prosody_reader> mProsody;
-	float mRemainingDuration;
+	void append(tts::prosody_block &aBlock, const tts::phone &aPhone, const cainteoir::range<const tts::envelope_t *> &aEnvelope);
+
+	std::shared_ptr<tts::prosody_block_reader> mProsody;
+	tts::prosody_block mInput;
+	std::size_t mNext;
+	tts::phone mSecond;
 	std::vector<tts::envelope_t> mRemainingEnvelope;
+	std::vector<tts::envelope_t> mNextEnvelope;
+	bool mEndOfInput;
 	bool mLastDiphone;
 };
 
-diphone_reader::diphone_reader(const std::shared_ptr<tts::prosody_reader> &aProsody)
+static const tts::phone silence = { ipa::separator | ipa::extra_short, ipa::unspecified, { 0, css::time::milliseconds } };
+
+diphone_reader::diphone_reader(const std::shared_ptr<tts::prosody_block_reader> &aProsody)
 	: mProsody(aProsody)
+	, mNext(0)
+	, mSecond(silence)
+	, mEndOfInput(false)
 	, mLastDiphone(false)
 {
-	first  = {};
-	second = { ipa::separator | ipa::extra_short, ipa::unspecified, { 0, css::time::milliseconds } };
 }
 
-bool diphone_reader::read()
+bool diphone_reader::read(tts::prosody_block &aBlock, std::size_t aMaxCount)
 {
-	first = second;
-
-	envelope = mRemainingEnvelope;
-	mRemainingEnvelope.clear();
-
-	if (mProsody->read())
+	aBlock.clear();
+	while (aBlock.count < aMaxCount)
 	{
-		second = mProsody->first;
-		second.duration = { second.duration.value() / 2, second.duration.units() };
-
-		bool haveMidpoint = false;
-		for (auto && env : mProsody->envelope)
+		if (mNext == mInput.count)
 		{
-			if (env.offset == 0 && !envelope.empty() && envelope.back().offset == 50)
+			mNext = 0;
+			if (mEndOfInput || !mProsody->read(mInput, aMaxCount - aBlock.count))
 			{
-				css::frequency pitch = envelope.back().pitch;
-				if (pitch.units() != env.pitch.units() || pitch.value() != env.pitch.value())
-				{
-					fflush(stdout);
-					fprintf(stderr, "warning: mismatched start/end pitch points\n");
-					fflush(stderr);
-				}
+				mInput.clear();
+				mEndOfInput = true;
+				if (mLastDiphone || !aBlock.can_append(mRemainingEnvelope.size()))
+					break;
+
+				mLastDiphone = true;
+				aBlock.append(mSecond, silence);
+				for (const auto &env : mRemainingEnvelope)
+					aBlock.append(env);
+				mRemainingEnvelope.clear();
+				mSecond = silence;
+				continue;
 			}
-			else if (env.offset < 50)
+		}
+
+		auto envelope = mInput.envelope(mNext);
+		if (!aBlock.can_append(mRemainingEnvelope.size() + envelope.size() + 1))
+		{
+			if (aBlock.count == 0)
+				throw std::runtime_error(i18n("The pitch envelope has too many points."));
+			break;
+		}
+
+		append(aBlock, mInput.first[mNext], envelope);
+		++mNext;
+	}
+	return aBlock.count != 0;
+}
+
+void diphone_reader::append(tts::prosody_block &aBlock, const tts::phone &aPhone, const cainteoir::range<const tts::envelope_t *> &aEnvelope)
+{
+	tts::phone second = aPhone;
+	second.duration = { second.duration.value() / 2, second.duration.units() };
+
+	aBlock.append(mSecond, second);
+	for (const auto &env : mRemainingEnvelope)
+		aBlock.append(env);
+
+	std::size_t index = aBlock.count - 1;
+	auto last = [&]() { return aBlock.envelope_points[aBlock.envelope_count - 1]; };
+
+	mNextEnvelope.clear();
+	bool haveMidpoint = false;
+	for (auto && env : aEnvelope)
+	{
+		if (env.offset == 0 && aBlock.envelope_size[index] != 0 && last().offset == 50)
+		{
+			css::frequency pitch = last().pitch;
+			if (pitch.units() != env.pitch.units() || pitch.value() != env.pitch.value())
 			{
-				envelope.push_back({ env.offset + 50, env.pitch });
+				fflush(stdout);
+				fprintf(stderr, "warning: mismatched start/end pitch points\n");
+				fflush(stderr);
 			}
-			else if (env.offset == 50)
+		}
+		else if (env.offset < 50)
+		{
+			aBlock.append({ env.offset + 50, env.pitch });
+		}
+		else if (env.offset == 50)
+		{
+			haveMidpoint = true;
+			aBlock.append({ 100, env.pitch });
+			mNextEnvelope.push_back({ 0, env.pitch });
+		}
+		else // if (env.offset >= 50)
+		{
+			if (!haveMidpoint)
 			{
 				haveMidpoint = true;
-				envelope.push_back({ 100, env.pitch });
-				mRemainingEnvelope.push_back({ 0, env.pitch });
-			}
-			else // if (env.offset >= 50)
-			{
-				if (!haveMidpoint)
+				float pitch2 = env.pitch.value();
+				float pitch1 = aBlock.envelope_size[index] == 0 ? pitch2 : last().pitch.value();
+				if (pitch1 != pitch2)
 				{
-					haveMidpoint = true;
-					float pitch2 = env.pitch.value();
-					float pitch1 = envelope.empty() ? pitch2 : envelope.back().pitch.value();
-					if (pitch1 != pitch2)
-					{
-						int offset2 = envelope.back().offset - 50;
-						int offset1 = env.offset;
-
-						float dPitch = (pitch2 - pitch1) / (offset2 - offset1);
-						pitch1 = ((50 - offset1) * dPitch) + pitch1;
-					}
-
-					envelope.push_back({ 100, { pitch1, css::frequency::hertz }});
-					mRemainingEnvelope.push_back({ 0, { pitch1, css::frequency::hertz }});
+					int offset2 = last().offset - 50;
+					int offset1 = env.offset;
+
+					float dPitch = (pitch2 - pitch1) / (offset2 - offset1);
+					pitch1 = ((50 - offset1) * dPitch) + pitch1;
 				}
-				mRemainingEnvelope.push_back({ env.offset - 50, env.pitch });
+
+				aBlock.append({ 100, { pitch1, css::frequency::hertz }});
+				mNextEnvelope.push_back({ 0, { pitch1, css::frequency::hertz }});
 			}
+			mNextEnvelope.push_back({ env.offset - 50, env.pitch });
 		}
 	}
-	else if (mLastDiphone)
-		return false;
-	else
-	{
-		mLastDiphone = true;
-		second = { ipa::separator | ipa::extra_short, ipa::unspecified, { 0, css::time::milliseconds } };
-	}
 
-	return true;
+	std::swap(mRemainingEnvelope, mNextEnvelope);
+	mSecond = second;
+}
+
+std::shared_ptr<tts::prosody_block_reader>
+tts::create_diphone_block_reader(const std::shared_ptr<prosody_block_reader> &aProsody)
+{
+	return std::make_shared<diphone_reader>(aProsody);
 }
 
 std::shared_ptr<tts::prosody_reader>
 tts::createDiphoneReader(const std::shared_ptr<prosody_reader> &aProsody)
 {
-	return std::make_shared<diphone_reader>(aProsody);
+	return create_prosody_reader(create_diphone_block_reader(create_prosody_block_reader(aProsody)), 1);
 }
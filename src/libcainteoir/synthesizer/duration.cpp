@@ -30,28 +30,126 @@ namespace tts = cainteoir::tts;
 namespace ipa = cainteoir::ipa;
 namespace css = cainteoir::css;
 
-struct duration_model_t : public tts::duration_model
+// A duration from a text duration model file.
+struct duration_file_entry
 {
-	duration_model_t(const std::shared_ptr<cainteoir::buffer> &aDurationModel);
+	ipa::phoneme phoneme1;
+	ipa::phoneme phoneme2;
+	tts::duration duration;
+};
+
+static inline tts::duration to_duration(const duration_file_entry &aEntry)
+{
+	return aEntry.duration;
+}
+
+static inline tts::duration to_duration(const tts::duration_entry &aEntry)
+{
+	css::time mean{ (float)aEntry.mean, css::time::milliseconds };
+	css::time sdev{ (float)aEntry.sdev, css::time::milliseconds };
+	return { mean, sdev };
+}
+
+static constexpr uint16_t empty_slot = 0xFFFF;
 
-	duration_model_t(cainteoir::native_endian_buffer &aData);
+// The durations are looked up through an open addressing hash table of
+// indices into the entries, so the entries can be used in place from the
+// memory mapped voice database.
+template <typename Entry>
+struct duration_model_t : public tts::duration_model
+{
+	duration_model_t()
+		: mEntries(nullptr, nullptr)
+	{
+	}
 
 	css::time lookup(const tts::phone &p, tts::probability_distribution d) const;
+protected:
+	void index(const cainteoir::range<const Entry *> &aEntries);
 private:
-	struct phone_compare
+	static std::size_t hash(ipa::phoneme phoneme1, ipa::phoneme phoneme2)
+	{
+		uint64_t h = (phoneme1.get(~0) ^ (phoneme2.get(~0) * 0x9E3779B97F4A7C15ull)) * 0xFF51AFD7ED558CCDull;
+		return h >> 32;
+	}
+
+	cainteoir::range<const Entry *> mEntries;
+	std::vector<uint16_t> mSlots;
+	std::size_t mMask;
+};
+
+template <typename Entry>
+void duration_model_t<Entry>::index(const cainteoir::range<const Entry *> &aEntries)
+{
+	if (aEntries.size() >= empty_slot)
+		throw std::runtime_error("too many duration model entries");
+
+	std::size_t slots = 16;
+	while (slots < aEntries.size() * 2)
+		slots *= 2;
+
+	mEntries = aEntries;
+	mSlots.assign(slots, empty_slot);
+	mMask = slots - 1;
+
+	const Entry *entries = mEntries.begin();
+	for (uint16_t i = 0; i != mEntries.size(); ++i)
+	{
+		// The first entry for a phoneme is the one that is used.
+		std::size_t slot = hash(entries[i].phoneme1, entries[i].phoneme2) & mMask;
+		while (mSlots[slot] != empty_slot)
+		{
+			const Entry &entry = entries[mSlots[slot]];
+			if (entry.phoneme1 == entries[i].phoneme1 && entry.phoneme2 == entries[i].phoneme2)
+				break;
+			slot = (slot + 1) & mMask;
+		}
+		if (mSlots[slot] == empty_slot)
+			mSlots[slot] = i;
+	}
+}
+
+template <typename Entry>
+css::time duration_model_t<Entry>::lookup(const tts::phone &p, tts::probability_distribution d) const
+{
+	const auto mask = ipa::main | ipa::diacritics | ipa::length; // no tone or stress
+
+	static const tts::duration utterance_pause = { {  25, css::time::milliseconds }, {  5, css::time::milliseconds } };
+	static const tts::duration clause_pause    = { { 200, css::time::milliseconds }, { 50, css::time::milliseconds } };
+
+	const ipa::phoneme phoneme1 = p.phoneme1.get(mask);
+	const ipa::phoneme phoneme2 = p.phoneme2.get(mask);
+
+	if (!mSlots.empty())
 	{
-		bool operator()(const tts::phone &a, const tts::phone &b) const
+		const Entry *entries = mEntries.begin();
+		for (std::size_t slot = hash(phoneme1, phoneme2) & mMask; mSlots[slot] != empty_slot; slot = (slot + 1) & mMask)
 		{
-			if (a.phoneme1 <  b.phoneme1) return true;
-			if (a.phoneme1 == b.phoneme1) return a.phoneme2 < b.phoneme2;
-			return false;
+			const Entry &entry = entries[mSlots[slot]];
+			if (entry.phoneme1 == phoneme1 && entry.phoneme2 == phoneme2)
+				return to_duration(entry).value(d());
 		}
-	};
+	}
 
-	std::map<tts::phone, tts::duration, phone_compare> mDurations;
+	if (p.phoneme2 == ipa::unspecified) switch (p.phoneme1.get(ipa::phoneme_type))
+	{
+	case ipa::foot_break:
+		return utterance_pause.value(d());
+	case ipa::intonation_break:
+		return clause_pause.value(d());
+	}
+
+	return {};
+}
+
+struct duration_file_model : public duration_model_t<duration_file_entry>
+{
+	duration_file_model(const std::shared_ptr<cainteoir::buffer> &aDurationModel);
+private:
+	std::vector<duration_file_entry> mDurations;
 };
 
-duration_model_t::duration_model_t(const std::shared_ptr<cainteoir::buffer> &aDurationModel)
+duration_file_model::duration_file_model(const std::shared_ptr<cainteoir::buffer> &aDurationModel)
 {
 	cainteoir_file_reader reader(aDurationModel);
 	std::shared_ptr<tts::phoneme_parser> phonemeset;
@@ -94,58 +192,40 @@ duration_model_t::duration_model_t(const std::shared_ptr<cainteoir::buffer> &aDu
 			if (phoneme.empty() || p.phoneme1 == ipa::unspecified)
 				throw std::runtime_error("unrecognised phoneme");
 
-			mDurations.insert({ p, tts::duration{ mean, sdev }});
+			mDurations.push_back({ p.phoneme1, p.phoneme2, tts::duration{ mean, sdev }});
 		}
 		else
 			throw std::runtime_error("invalid duration model contents");
 	}
-}
 
-duration_model_t::duration_model_t(cainteoir::native_endian_buffer &aData)
-{
-	for (auto i : cainteoir::range<uint16_t>(0, aData.u16()))
-	{
-		tts::phone p;
-		p.phoneme1 = ipa::phoneme{ aData.u64() };
-		p.phoneme2 = ipa::phoneme{ aData.u64() };
-
-		css::time mean{ (float)aData.u8(), css::time::milliseconds };
-		css::time sdev{ (float)aData.u8(), css::time::milliseconds };
-		mDurations.insert({ p, tts::duration{ mean, sdev }});
-	}
+	if (!mDurations.empty())
+		index({ &mDurations.front(), &mDurations.back() + 1 });
 }
 
-css::time duration_model_t::lookup(const tts::phone &p, tts::probability_distribution d) const
+struct duration_table_model : public duration_model_t<tts::duration_entry>
 {
-	const auto mask = ipa::main | ipa::diacritics | ipa::length; // no tone or stress
-
-	static const tts::duration utterance_pause = { {  25, css::time::milliseconds }, {  5, css::time::milliseconds } };
-	static const tts::duration clause_pause    = { { 200, css::time::milliseconds }, { 50, css::time::milliseconds } };
-
-	auto match = mDurations.find({ p.phoneme1.get(mask), p.phoneme2.get(mask), {}});
-	if (match != mDurations.end())
-		return match->second.value(d());
-
-	if (p.phoneme2 == ipa::unspecified) switch (p.phoneme1.get(ipa::phoneme_type))
-	{
-	case ipa::foot_break:
-		return utterance_pause.value(d());
-	case ipa::intonation_break:
-		return clause_pause.value(d());
-	}
+	duration_table_model(const cainteoir::range<const tts::duration_entry *> &aEntries,
+	                     const std::shared_ptr<cainteoir::buffer> &aData);
+private:
+	std::shared_ptr<cainteoir::buffer> mData;
+};
 
-	return {};
+duration_table_model::duration_table_model(const cainteoir::range<const tts::duration_entry *> &aEntries,
+                                           const std::shared_ptr<cainteoir::buffer> &aData)
+	: mData(aData)
+{
+	index(aEntries);
 }
 
 std::shared_ptr<tts::duration_model>
 tts::createDurationModel(const std::shared_ptr<cainteoir::buffer> &aDurationModel)
 {
 	if (!aDurationModel.get()) return {};
-	return std::make_shared<duration_model_t>(aDurationModel);
+	return std::make_shared<duration_file_model>(aDurationModel);
 }
 
 std::shared_ptr<tts::duration_model>
-tts::createDurationModel(cainteoir::native_endian_buffer &aData)
+tts::createDurationModel(cainteoir::native_endian_buffer &aData, const std::shared_ptr<buffer> &aBuffer)
 {
-	return std::make_shared<duration_model_t>(aData);
+	return std::make_shared<duration_table_model>(aData.array<tts::duration_entry>(), aBuffer);
 }
@@ -62,6 +62,8 @@ tts::write_diphone(const tts::prosody &aProsody,
 
 		aPhonemeSet->flush();
 	}
+
+	return true;
 }
 
 static float parse_number(const char * &current, const char *end)
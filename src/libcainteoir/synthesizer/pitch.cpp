@@ -72,6 +72,15 @@ const tts::pitch &tts::pitch_model::tone(ipa::phoneme::value_type aTone) const
 std::vector<tts::envelope_t>
 tts::pitch_model::envelope(ipa::phoneme aTones,
                            tts::probability_distribution aProbabilityDistribution) const
+{
+	tts::envelope_t points[3];
+	return { points, points + envelope(points, aTones, aProbabilityDistribution) };
+}
+
+std::size_t
+tts::pitch_model::envelope(tts::envelope_t *aEnvelope,
+                           ipa::phoneme aTones,
+                           tts::probability_distribution aProbabilityDistribution) const
 {
 	auto start  = aTones.get(ipa::tone_start);
 	auto middle = aTones.get(ipa::tone_middle);
@@ -87,20 +96,27 @@ tts::pitch_model::envelope(ipa::phoneme aTones,
 			{
 				// peaking/dipping tone
 				css::frequency b = tone(middle).value(aProbabilityDistribution());
-				return {{ 0, a }, { 50, b }, { 100, c }};
+				aEnvelope[0] = { 0, a };
+				aEnvelope[1] = { 50, b };
+				aEnvelope[2] = { 100, c };
+				return 3;
 			}
 			else
 			{
 				// rising/falling tone
-				return {{ 0, a }, { 100, c }};
+				aEnvelope[0] = { 0, a };
+				aEnvelope[1] = { 100, c };
+				return 2;
 			}
 		}
 		else
 		{
 			// level tone
-			return {{ 0, a }, { 100, a }};
+			aEnvelope[0] = { 0, a };
+			aEnvelope[1] = { 100, a };
+			return 2;
 		}
 	}
 
-	return {};
+	return 0;
 }
@@ -29,7 +29,7 @@ namespace tts = cainteoir::tts;
 namespace ipa = cainteoir::ipa;
 namespace css = cainteoir::css;
 
-struct phonemes_to_prosody : public tts::prosody_reader
+struct phonemes_to_prosody : public tts::prosody_block_reader
 {
 	phonemes_to_prosody(const std::shared_ptr<tts::phoneme_reader> &aPhonemes,
 	                    const std::shared_ptr<tts::duration_model> &aDurationModel,
@@ -43,8 +43,10 @@ struct phonemes_to_prosody : public tts::prosody_reader
 	{
 	}
 
-	bool read();
+	bool read(tts::prosody_block &aBlock, std::size_t aMaxCount);
 private:
+	bool next(tts::phone &aPhone);
+
 	std::shared_ptr<tts::phoneme_reader> mPhonemes;
 	std::shared_ptr<tts::duration_model> mDurationModel;
 	std::shared_ptr<tts::pitch_model> mPitchModel;
@@ -52,77 +54,106 @@ private:
 	bool mNeedPhoneme;
 };
 
-bool phonemes_to_prosody::read()
+bool phonemes_to_prosody::read(tts::prosody_block &aBlock, std::size_t aMaxCount)
 {
-	if (mNeedPhoneme)
+	aBlock.clear();
+
+	tts::phone phone;
+	tts::envelope_t envelope[3];
+	while (aBlock.count < aMaxCount && aBlock.can_append(3) && next(phone))
 	{
-		if (!mPhonemes->read())
-			return false;
+		aBlock.append(phone, {});
+		if (mPitchModel.get() && phone.phoneme1 != ipa::syllable_break)
+		{
+			std::size_t points = mPitchModel->envelope(envelope, phone.phoneme1, mProbabilityDistribution);
+			for (std::size_t i = 0; i != points; ++i)
+				aBlock.append(envelope[i]);
+		}
 	}
+	return aBlock.count != 0;
+}
 
-	first.phoneme1 = *mPhonemes;
-	if (mPhonemes->read())
+bool phonemes_to_prosody::next(tts::phone &aPhone)
+{
+	while (true)
 	{
-		if (first.phoneme1.get(ipa::joined_to_next_phoneme) == ipa::joined_to_next_phoneme)
+		if (mNeedPhoneme)
 		{
-			first.phoneme2 = *mPhonemes;
-			mNeedPhoneme = true;
+			if (!mPhonemes->read())
+				return false;
 		}
-		else if (mPhonemes->get(ipa::diacritized) == ipa::diacritized)
+
+		aPhone.phoneme1 = *mPhonemes;
+		if (mPhonemes->read())
 		{
-			first.phoneme2 = *mPhonemes;
-			mNeedPhoneme = true;
+			if (aPhone.phoneme1.get(ipa::joined_to_next_phoneme) == ipa::joined_to_next_phoneme)
+			{
+				aPhone.phoneme2 = *mPhonemes;
+				mNeedPhoneme = true;
+			}
+			else if (mPhonemes->get(ipa::diacritized) == ipa::diacritized)
+			{
+				aPhone.phoneme2 = *mPhonemes;
+				mNeedPhoneme = true;
+			}
+			else if (mPhonemes->get(ipa::syllabicity) == ipa::non_syllabic)
+			{
+				aPhone.phoneme2 = *mPhonemes;
+				mNeedPhoneme = true;
+			}
+			else
+			{
+				aPhone.phoneme2 = { ipa::unspecified };
+				mNeedPhoneme = false;
+			}
 		}
-		else if (mPhonemes->get(ipa::syllabicity) == ipa::non_syllabic)
+		else
 		{
-			first.phoneme2 = *mPhonemes;
+			aPhone.phoneme2 = { ipa::unspecified };
 			mNeedPhoneme = true;
 		}
-		else
+
+		if (aPhone.phoneme1 == ipa::syllable_break)
 		{
-			first.phoneme2 = { ipa::unspecified };
-			mNeedPhoneme = false;
+			aPhone.duration = {};
+			return true;
 		}
-	}
-	else
-	{
-		first.phoneme2 = { ipa::unspecified };
-		mNeedPhoneme = true;
-	}
 
-	if (first.phoneme1 == ipa::syllable_break)
-	{
-		first.duration = {};
-		return true;
-	}
+		if (aPhone.phoneme2 == ipa::unspecified)
+		{
+			if (aPhone.phoneme1.get(ipa::syllabicity) == ipa::non_syllabic)
+			{
+				// The /aI_^@_^/ (FIRE) phoneme gets split into /aI_^/ and /@_^/, while
+				// the /aU_^@_^/ (HOUR) phoneme gets split into /aU_^/ and /@_^/.
+				// Convert /@_^/ to /@/, allowing the phoneme to be processed.
+				aPhone.phoneme1.clear(ipa::syllabicity);
+			}
+			else if (aPhone.phoneme1.get(ipa::phoneme_type) == ipa::separator)
+				continue;
+		}
 
-	if (first.phoneme2 == ipa::unspecified)
-	{
-		if (first.phoneme1.get(ipa::syllabicity) == ipa::non_syllabic)
+		aPhone.duration = mDurationModel->lookup(aPhone, mProbabilityDistribution);
+		if (aPhone.duration.units() == css::time::inherit)
 		{
-			// The /aI_^@_^/ (FIRE) phoneme gets split into /aI_^/ and /@_^/, while
-			// the /aU_^@_^/ (HOUR) phoneme gets split into /aU_^/ and /@_^/.
-			// Convert /@_^/ to /@/, allowing the phoneme to be processed.
-			first.phoneme1.clear(ipa::syllabicity);
+			fprintf(stdout, "Phoneme /");
+			tts::write_explicit_feature(stdout, aPhone.phoneme1);
+			if (aPhone.phoneme2 != ipa::unspecified)
+				tts::write_explicit_feature(stdout, aPhone.phoneme2);
+			fprintf(stdout, "/ is not supported by the duration model.\n");
+			continue;
 		}
-		else if (first.phoneme1.get(ipa::phoneme_type) == ipa::separator)
-			return read();
-	}
 
-	first.duration = mDurationModel->lookup(first, mProbabilityDistribution);
-	if (first.duration.units() == css::time::inherit)
-	{
-		fprintf(stdout, "Phoneme /");
-		tts::write_explicit_feature(stdout, first.phoneme1);
-		if (first.phoneme2 != ipa::unspecified)
-			tts::write_explicit_feature(stdout, first.phoneme2);
-		fprintf(stdout, "/ is not supported by the duration model.\n");
-		return read();
+		return true;
 	}
+}
 
-	if (mPitchModel.get())
-		envelope = mPitchModel->envelope(first.phoneme1, mProbabilityDistribution);
-	return true;
+std::shared_ptr<tts::prosody_block_reader>
+tts::create_prosody_block_reader(const std::shared_ptr<phoneme_reader> &aPhonemes,
+                                 const std::shared_ptr<duration_model> &aDurationModel,
+                                 const std::shared_ptr<tts::pitch_model> &aPitchModel,
+                                 tts::probability_distribution aProbabilityDistribution)
+{
+	return std::make_shared<phonemes_to_prosody>(aPhonemes, aDurationModel, aPitchModel, aProbabilityDistribution);
 }
 
 std::shared_ptr<tts::prosody_reader>
@@ -131,5 +162,7 @@ tts::createProsodyReader(const std::shared_ptr<phoneme_reader> &aPhonemes,
                          const std::shared_ptr<tts::pitch_model> &aPitchModel,
                          tts::probability_distribution aProbabilityDistribution)
 {
-	return std::make_shared<phonemes_to_prosody>(aPhonemes, aDurationModel, aPitchModel, aProbabilityDistribution);
+	// Read one phone at a time, so any unsupported phoneme messages are
+	// written in order with the output of the caller.
+	return create_prosody_reader(create_prosody_block_reader(aPhonemes, aDurationModel, aPitchModel, aProbabilityDistribution), 1);
 }
@@ -0,0 +1,127 @@
+/* Conversion between prosody readers and prosody block readers.
+ *
+ * Copyright (C) 2015 Reece H. Dunn
+ *
+ * This file is part of cainteoir-engine.
+ *
+ * cainteoir-engine is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * cainteoir-engine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cainteoir-engine.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "i18n.h"
+#include "compatibility.hpp"
+
+#include <cainteoir/synthesizer.hpp>
+
+namespace tts = cainteoir::tts;
+
+struct block_to_prosody : public tts::prosody_reader
+{
+	block_to_prosody(const std::shared_ptr<tts::prosody_block_reader> &aProsody,
+	                 std::size_t aBlockSize)
+		: mProsody(aProsody)
+		, mBlockSize(aBlockSize)
+		, mNext(0)
+		, mStarted(false)
+	{
+	}
+
+	bool read();
+
+	const std::shared_ptr<tts::prosody_block_reader> &blocks() const { return mProsody; }
+
+	bool started() const { return mStarted; }
+private:
+	std::shared_ptr<tts::prosody_block_reader> mProsody;
+	std::size_t mBlockSize;
+	tts::prosody_block mBlock;
+	std::size_t mNext;
+	bool mStarted;
+};
+
+bool block_to_prosody::read()
+{
+	mStarted = true;
+	if (mNext == mBlock.count)
+	{
+		mNext = 0;
+		if (!mProsody->read(mBlock, mBlockSize))
+			return false;
+	}
+
+	first = mBlock.first[mNext];
+	second = mBlock.second[mNext];
+
+	auto points = mBlock.envelope(mNext);
+	envelope.assign(points.begin(), points.end());
+
+	++mNext;
+	return true;
+}
+
+struct prosody_to_block : public tts::prosody_block_reader
+{
+	prosody_to_block(const std::shared_ptr<tts::prosody_reader> &aProsody)
+		: mProsody(aProsody)
+		, mPending(false)
+	{
+	}
+
+	bool read(tts::prosody_block &aBlock, std::size_t aMaxCount);
+private:
+	std::shared_ptr<tts::prosody_reader> mProsody;
+	bool mPending;
+};
+
+bool prosody_to_block::read(tts::prosody_block &aBlock, std::size_t aMaxCount)
+{
+	aBlock.clear();
+	while (aBlock.count < aMaxCount)
+	{
+		if (!mPending && !mProsody->read())
+			break;
+
+		if (!aBlock.can_append(mProsody->envelope.size()))
+		{
+			if (aBlock.count == 0)
+				throw std::runtime_error(i18n("The pitch envelope has too many points."));
+			mPending = true;
+			break;
+		}
+
+		mPending = false;
+		aBlock.append(mProsody->first, mProsody->second);
+		for (const auto &env : mProsody->envelope)
+			aBlock.append(env);
+	}
+	return aBlock.count != 0;
+}
+
+std::shared_ptr<tts::prosody_block_reader>
+tts::create_prosody_block_reader(const std::shared_ptr<prosody_reader> &aProsody)
+{
+	// Avoid converting the blocks to phones and back again if the prosody
+	// reader is a view of a prosody block reader that has not been read.
+	auto blocks = std::dynamic_pointer_cast<block_to_prosody>(aProsody);
+	if (blocks && !blocks->started())
+		return blocks->blocks();
+	return std::make_shared<prosody_to_block>(aProsody);
+}
+
+std::shared_ptr<tts::prosody_reader>
+tts::create_prosody_reader(const std::shared_ptr<prosody_block_reader> &aProsody,
+                           std::size_t aBlockSize)
+{
+	return std::make_shared<block_to_prosody>(aProsody, aBlockSize);
+}
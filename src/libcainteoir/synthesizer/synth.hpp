@@ -39,15 +39,34 @@ namespace cainteoir { namespace tts
 	static constexpr uint16_t DURATION_TABLE_ENTRY_SIZE = 18;
 	static constexpr uint16_t PHONEME_UNIT_TABLE_ENTRY_SIZE = 7;
 	static constexpr uint16_t PHONEME_TABLE_ENTRY_SIZE = 19;
+	static constexpr uint16_t UNIT_AUDIO_TABLE_SIZE = 9;
+	static constexpr uint16_t UNIT_AUDIO_TABLE_ENTRY_SIZE = 20;
 
 	static constexpr uint32_t PITCH_DATA_MAGIC = make_magic32('P', 'T', 'C');
 	static constexpr uint32_t STRING_TABLE_MAGIC = make_magic32('S', 'T', 'R');
 	static constexpr uint32_t DURATION_TABLE_MAGIC = make_magic32('D', 'U', 'R');
 	static constexpr uint32_t PHONEME_UNIT_TABLE_MAGIC = make_magic32('P', 'U', 'T');
 	static constexpr uint32_t PHONEME_TABLE_MAGIC = make_magic32('P', 'H', 'O');
+	static constexpr uint32_t UNIT_AUDIO_TABLE_MAGIC = make_magic32('U', 'A', 'D');
+
+	static constexpr uint32_t PITCH_MARK_VOICED = 0x80000000;
+	static constexpr uint32_t PITCH_MARK_OFFSET = 0x7FFFFFFF;
+
+	#pragma pack(1)
+	struct duration_entry
+	{
+		ipa::phoneme phoneme1;
+		ipa::phoneme phoneme2;
+		uint8_t mean;
+		uint8_t sdev;
+	};
+	#pragma pack(0)
+
+	static_assert(sizeof(duration_entry) == DURATION_TABLE_ENTRY_SIZE,
+	              "duration_entry does not match the Duration Table entry size");
 
 	std::shared_ptr<duration_model>
-	createDurationModel(native_endian_buffer &aData);
+	createDurationModel(native_endian_buffer &aData, const std::shared_ptr<buffer> &aBuffer);
 
 	void read_phoneme_units(cainteoir::native_endian_buffer &data, std::vector<unit_t> &units);
 
@@ -84,6 +103,11 @@ namespace cainteoir { namespace tts
 	create_mbrola_voice(const std::shared_ptr<cainteoir::buffer> &aData,
 	                    const rdf::graph &aMetadata,
 	                    const rdf::uri &aVoice);
+
+	std::shared_ptr<voice>
+	create_psola_voice(const std::shared_ptr<cainteoir::buffer> &aData,
+	                   const rdf::graph &aMetadata,
+	                   const rdf::uri &aVoice);
 }}
 
 #endif
@@ -157,6 +157,8 @@ tts::create_voice(rdf::graph &aMetadata, const rdf::uri *aVoice)
 	if (strcmp(synth_name, "MBROLA") == 0)
 		return create_mbrola_voice(data, aMetadata, *aVoice);
 #endif
+	if (strcmp(synth_name, "PSOLA") == 0)
+		return create_psola_voice(data, aMetadata, *aVoice);
 
 	return {};
 }
@@ -29,14 +29,16 @@ namespace tts = cainteoir::tts;
 namespace ipa = cainteoir::ipa;
 namespace css = cainteoir::css;
 
-struct unit_reader : public tts::prosody_reader
+struct unit_reader : public tts::prosody_block_reader
 {
-	unit_reader(const std::shared_ptr<tts::prosody_reader> &aProsody,
+	unit_reader(const std::shared_ptr<tts::prosody_block_reader> &aProsody,
 	            const std::vector<tts::unit_t> &aUnits,
 	            const cainteoir::range<const tts::phoneme_units *> &aPhonemes)
 		: mProsody(aProsody)
 		, mUnits(aUnits)
 		, mPhonemes(aPhonemes)
+		, mNext(0)
+		, mCurrent(0)
 		, mCurrentUnit(0)
 		, mLastUnit(0)
 		, mRemainingOffset(100)
@@ -44,14 +46,18 @@ struct unit_reader : public tts::prosody_reader
 	{
 	}
 
-	bool read();
+	bool read(tts::prosody_block &aBlock, std::size_t aMaxCount);
 private:
 	bool find_unit(const ipa::phoneme::value_type mask);
 
-	std::shared_ptr<tts::prosody_reader> mProsody;
+	std::shared_ptr<tts::prosody_block_reader> mProsody;
 	const std::vector<tts::unit_t> &mUnits;
 	cainteoir::range<const tts::phoneme_units *> mPhonemes;
 
+	tts::prosody_block mInput;
+	std::size_t mNext;
+	std::size_t mCurrent;
+
 	uint16_t mCurrentUnit;
 	uint16_t mLastUnit;
 	uint8_t  mRemainingOffset;
@@ -66,23 +72,29 @@ private:
 	state_t mState;
 };
 
-bool unit_reader::read()
+bool unit_reader::read(tts::prosody_block &aBlock, std::size_t aMaxCount)
 {
 	constexpr auto mask_normal   = ~(ipa::stress | ipa::tone_start | ipa::tone_middle | ipa::tone_end);
 	constexpr auto mask_nolength = ~(ipa::stress | ipa::tone_start | ipa::tone_middle | ipa::tone_end | ipa::length);
 
-	while (true) switch (mState)
+	aBlock.clear();
+	while (aBlock.count < aMaxCount) switch (mState)
 	{
 	case need_phoneme:
-		if (!mProsody->read())
-			return false;
+		if (mNext == mInput.count)
+		{
+			mNext = 0;
+			if (!mProsody->read(mInput, aMaxCount - aBlock.count))
+				return aBlock.count != 0;
+		}
+		mCurrent = mNext++;
 
 		if (find_unit(mask_normal) || find_unit(mask_nolength))
 		{
 			mState = have_unit;
 			continue;
 		}
-		else if (mProsody->first.phoneme2 == ipa::unspecified) switch (mProsody->first.phoneme1.get(ipa::phoneme_type))
+		else if (mInput.first[mCurrent].phoneme2 == ipa::unspecified) switch (mInput.first[mCurrent].phoneme1.get(ipa::phoneme_type))
 		{
 		case ipa::syllable_break:
 			continue;
@@ -93,44 +105,62 @@ bool unit_reader::read()
 		}
 
 		fprintf(stdout, "Phoneme /");
-		tts::write_explicit_feature(stdout, mProsody->first.phoneme1);
-		if (mProsody->first.phoneme2 != ipa::unspecified)
-			tts::write_explicit_feature(stdout, mProsody->first.phoneme2);
+		tts::write_explicit_feature(stdout, mInput.first[mCurrent].phoneme1);
+		if (mInput.first[mCurrent].phoneme2 != ipa::unspecified)
+			tts::write_explicit_feature(stdout, mInput.first[mCurrent].phoneme2);
 		fprintf(stdout, "/ is not supported.\n");
 		break;
 	case have_phoneme:
-		first.phoneme1 = mProsody->first.phoneme1;
-		first.phoneme2 = mProsody->first.phoneme2;
-		first.duration = mProsody->first.duration;
+		{
+			auto envelope = mInput.envelope(mCurrent);
+			if (!aBlock.can_append(envelope.size()))
+				return true;
+
+			aBlock.append(mInput.first[mCurrent], {});
+			for (const auto &env : envelope)
+				aBlock.append(env);
 
-		mState = need_phoneme;
-		return true;
+			mState = need_phoneme;
+		}
+		break;
 	case have_unit:
-		first.phoneme1 = ipa::unit | (mCurrentUnit << 8);
-		++mCurrentUnit;
+		{
+			auto envelope = mInput.envelope(mCurrent);
+			if (!aBlock.can_append(envelope.size()))
+				return true;
 
-		uint8_t offset = (mCurrentUnit == mLastUnit) ? mRemainingOffset : mUnits[mCurrentUnit].phoneme_start;
-		mRemainingOffset -= offset;
+			tts::phone unit;
+			unit.phoneme1 = ipa::unit | (mCurrentUnit << 8);
+			++mCurrentUnit;
 
-		first.duration = css::time((mProsody->first.duration.value() * offset) / 100.0,
-		                            mProsody->first.duration.units());
+			uint8_t offset = (mCurrentUnit == mLastUnit) ? mRemainingOffset : mUnits[mCurrentUnit].phoneme_start;
+			mRemainingOffset -= offset;
 
-		if (mCurrentUnit == mLastUnit)
-			mState = need_phoneme;
-		return true;
+			const css::time &duration = mInput.first[mCurrent].duration;
+			unit.duration = css::time((duration.value() * offset) / 100.0, duration.units());
+
+			aBlock.append(unit, {});
+			for (const auto &env : envelope)
+				aBlock.append(env);
+
+			if (mCurrentUnit == mLastUnit)
+				mState = need_phoneme;
+		}
+		break;
 	}
+	return true;
 }
 
 bool unit_reader::find_unit(const ipa::phoneme::value_type mask)
 {
+	const tts::phone &phone = mInput.first[mCurrent];
 	for (const auto &entry : mPhonemes)
 	{
-		if (mProsody->first.phoneme1.get(mask) == entry.phoneme1 &&
-		    mProsody->first.phoneme2 == entry.phoneme2)
+		if (phone.phoneme1.get(mask) == entry.phoneme1 &&
+		    phone.phoneme2 == entry.phoneme2)
 		{
 			mCurrentUnit = entry.first_unit;
 			mLastUnit = entry.first_unit + entry.num_units;
-			envelope = mProsody->envelope;
 			mRemainingOffset = 100;
 			return true;
 		}
@@ -139,10 +169,18 @@ bool unit_reader::find_unit(const ipa::phoneme::value_type mask)
 	return false;
 }
 
+std::shared_ptr<tts::prosody_block_reader>
+tts::create_unit_block_reader(const std::shared_ptr<prosody_block_reader> &aProsody,
+                              const std::vector<tts::unit_t> &aUnits,
+                              const cainteoir::range<const tts::phoneme_units *> &aPhonemes)
+{
+	return std::make_shared<unit_reader>(aProsody, aUnits, aPhonemes);
+}
+
 std::shared_ptr<tts::prosody_reader>
 tts::create_unit_reader(const std::shared_ptr<prosody_reader> &aProsody,
                         const std::vector<tts::unit_t> &aUnits,
                         const cainteoir::range<const tts::phoneme_units *> &aPhonemes)
 {
-	return std::make_shared<unit_reader>(aProsody, aUnits, aPhonemes);
+	return create_prosody_reader(create_unit_block_reader(create_prosody_block_reader(aProsody), aUnits, aPhonemes), 1);
 }
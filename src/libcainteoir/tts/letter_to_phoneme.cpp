@@ -23,11 +23,29 @@
 #include "compatibility.hpp"
 
 #include <cainteoir/language.hpp>
+#include <cainteoir/trie.hpp>
 #include "../synthesizer/synth.hpp"
 
 namespace tts = cainteoir::tts;
 namespace ipa = cainteoir::ipa;
 
+// The letter-to-phoneme rules in the language database are compiled when the
+// ruleset is loaded:
+//
+//   1.  The conditional rules (@name and !name) are resolved against the
+//       locale, removing the rules that can never match.
+//
+//   2.  The rules are converted to a sequence of instructions, with the class
+//       definitions, phoneme feature contexts ({...}) and phoneme contexts
+//       (/.../) pre-parsed.
+//
+//   3.  The literal prefixes of the rule contexts are stored in a trie. Each
+//       trie node contains the (ordered) list of the rules that can match
+//       when that node is the longest prefix that matches the text.
+//
+// This means that finding the rules to match against is a walk of the trie,
+// and only the instructions after the literal prefix need to be evaluated.
+
 struct ruleset : public tts::phoneme_reader
 {
 	ruleset(const std::shared_ptr<cainteoir::buffer> &aData,
@@ -37,33 +55,114 @@ struct ruleset : public tts::phoneme_reader
 
 	bool read();
 private:
+	enum class opcode : uint8_t
+	{
+		letter,   // Match the letter `c`.
+		classdef, // Match one of the `count` strings at `value` in mClassEntries.
+		boundary, // Match a word boundary, or the start/end of the text.
+		features, // Match `count` feature groups at `value` in mFeatureGroups.
+		phonemes, // Match the `count` phonemes at `value` in mPhonemes.
+	};
+
+	struct instruction
+	{
+		opcode op;
+		uint8_t c;
+		uint16_t count;
+		uint32_t value;
+	};
+
+	struct feature
+	{
+		char name[4];
+	};
+
+	struct rule
+	{
+		uint32_t prefix;  // The number of letters matched by the context trie.
+		const uint8_t *prefix_letters;
+		uint32_t context; // The remaining context instructions: [context, left).
+		uint32_t left;    // The left context instructions: [left, right).
+		uint32_t right;   // The right context instructions: [right, end).
+		uint32_t end;
+		uint32_t output;  // The phonemes for this rule: [output, output_end).
+		uint32_t output_end;
+		const char *phonemes;
+	};
+
+	struct candidates
+	{
+		uint32_t first;
+		uint32_t count;
+
+		candidates(uint32_t aFirst = 0, uint32_t aCount = 0)
+			: first(aFirst)
+			, count(aCount)
+		{
+		}
+	};
+
+	enum section_t
+	{
+		context_match,
+		left_match,
+		right_match,
+	};
+
 	std::shared_ptr<cainteoir::buffer> mBuffer;
 	const uint8_t *mStart;
 	const uint8_t *mCurrent;
 	const uint8_t *mEnd;
-	const char *mPhonemeCurrent;
-	const char *mPhonemeEnd;
+	const ipa::phoneme *mPhonemeCurrent;
+	const ipa::phoneme *mPhonemeEnd;
 
 	std::shared_ptr<cainteoir::buffer> mData;
 	std::shared_ptr<tts::phoneme_parser> mPhonemeSet;
-	cainteoir::native_endian_buffer mRules;
-	uint32_t mRuleGroups[256];
 	uint32_t mClassDefs[256];
 	uint8_t  mConditionalFlags[256];
+	uint32_t mLastRule[256];
 	uint8_t  mBoundary;
 
+	cainteoir::compiled_trie<candidates, uint8_t> mContexts;
+	std::vector<uint32_t> mCandidates;
+	std::vector<rule> mRules;
+	std::vector<instruction> mInstructions;
+	std::vector<cainteoir::range<const uint8_t *>> mClassEntries;
+	std::vector<feature> mFeatures;
+	std::vector<std::pair<uint32_t, uint32_t>> mFeatureGroups;
+	std::vector<ipa::phoneme> mPhonemes;
+
 	ipa::phoneme mPreviousPhoneme;
 
 	std::shared_ptr<tts::rewriter> mRewriter;
 
-	bool match_features_next(const char *phonemes, const uint8_t *&rules);
-	bool match_features_prev(const uint8_t *&rules);
+	bool compile_rule(cainteoir::native_endian_buffer &aRules,
+	                  const uint8_t *aPattern,
+	                  const char *aPhonemes,
+	                  std::string &aPrefix);
 
-	bool match_phonemes_next(const char *phonemes, const uint8_t *&rules);
+	bool compile_features_next(const uint8_t *&pattern);
 
-	bool match_classdef(uint32_t offset, const uint8_t *&current);
+	bool compile_features_prev(const uint8_t *&pattern);
 
-	bool match_classdef_back(uint32_t offset, const uint8_t *&current);
+	bool compile_phonemes(const uint8_t *&pattern);
+
+	void compile_contexts(const cainteoir::trie_node<std::vector<uint32_t>, uint8_t> &aNode,
+	                      std::vector<uint32_t> &aCandidates,
+	                      std::string &aPath,
+	                      cainteoir::trie<candidates, uint8_t> &aContexts);
+
+	bool match_context(const rule &aRule, const uint8_t *current, const uint8_t *&context);
+
+	bool match_features_next(const instruction &aInstruction, bool aLast, const rule &aRule, const uint8_t *&right);
+
+	bool match_features_prev(const instruction &aInstruction);
+
+	bool match_phonemes_next(const instruction &aInstruction, const rule &aRule, const uint8_t *&right);
+
+	bool match_classdef(const instruction &aInstruction, const uint8_t *&current);
+
+	bool match_classdef_back(const instruction &aInstruction, const uint8_t *&current);
 
 	enum elision_rules_t
 	{
@@ -71,38 +170,43 @@ private:
 		ignore_elision_rules,
 	};
 
-	std::pair<const uint8_t *, const char *>
+	std::pair<const uint8_t *, const rule *>
 	next_match(const uint8_t *current, elision_rules_t elision = match_elision_rules);
+
+	std::pair<const uint8_t *, const rule *>
+	next_context_match(const rule &aRule, const uint8_t *current);
 };
 
 ruleset::ruleset(const std::shared_ptr<cainteoir::buffer> &aData,
                  const cainteoir::language::tag &aLocale)
 	: mData(aData)
-	, mRules((const uint8_t *)aData->begin(), (const uint8_t *)aData->end())
 	, mRewriter(tts::createLexicalRewriteRules(aData))
 {
-	memset(mRuleGroups, 0, sizeof(mRuleGroups));
 	memset(mClassDefs, 0, sizeof(mClassDefs));
 	memset(mConditionalFlags, 0, sizeof(mConditionalFlags));
+	memset(mLastRule, 0, sizeof(mLastRule));
+
+	cainteoir::native_endian_buffer rules((const uint8_t *)aData->begin(), (const uint8_t *)aData->end());
+	std::list<std::pair<uint8_t, uint32_t>> groups;
 
-	mRules.seek(tts::LANGDB_HEADER_ID);
-	const char *locale = mRules.pstr();
-	const char *phonemeset = mRules.pstr();
-	mBoundary = mRules.u8();
+	rules.seek(tts::LANGDB_HEADER_ID);
+	const char *locale = rules.pstr();
+	const char *phonemeset = rules.pstr();
+	mBoundary = rules.u8();
 
 	mPhonemeSet = tts::createPhonemeParser(phonemeset);
 
-	while (!mRules.eof()) switch (mRules.magic())
+	while (!rules.eof()) switch (rules.magic())
 	{
 	case tts::STRING_TABLE_MAGIC:
-		mRules.seek(mRules.u32());
+		rules.seek(rules.u32());
 		break;
 	case tts::CONDRULE_TABLE_MAGIC:
-		for (auto n : cainteoir::range<uint16_t>(0, mRules.u16()))
+		for (auto n : cainteoir::range<uint16_t>(0, rules.u16()))
 		{
-			uint8_t c = mRules.u8();
-			uint8_t type = mRules.u8();
-			const char *value = mRules.pstr();
+			uint8_t c = rules.u8();
+			uint8_t type = rules.u8();
+			const char *value = rules.pstr();
 			uint8_t set = (type & tts::LANGDB_CONDRULE_SET_MASK) == tts::LANGDB_CONDRULE_SET;
 			switch (type & ~tts::LANGDB_CONDRULE_SET_MASK)
 			{
@@ -115,221 +219,555 @@ ruleset::ruleset(const std::shared_ptr<cainteoir::buffer> &aData,
 		break;
 	case tts::CLASSDEF_TABLE_MAGIC:
 		{
-			uint16_t entries = mRules.u16();
-			uint8_t  id = mRules.u8();
-			uint32_t offset = mRules.offset();
-			mRules.seek(offset + (entries * tts::CLASSDEF_TABLE_ENTRY_SIZE));
+			uint16_t entries = rules.u16();
+			uint8_t  id = rules.u8();
+			uint32_t offset = rules.offset();
+			rules.seek(offset + (entries * tts::CLASSDEF_TABLE_ENTRY_SIZE));
 			mClassDefs[id] = offset;
 		}
 		break;
 	case tts::LETTER_TO_PHONEME_TABLE_MAGIC:
 		{
-			uint16_t entries = mRules.u16();
-			uint8_t  id = mRules.u8();
-			uint32_t offset = mRules.offset();
-			mRules.seek(offset + (entries * tts::LETTER_TO_PHONEME_TABLE_ENTRY_SIZE));
-			mRuleGroups[id] = offset;
+			uint16_t entries = rules.u16();
+			uint8_t  id = rules.u8();
+			uint32_t offset = rules.offset();
+			rules.seek(offset + (entries * tts::LETTER_TO_PHONEME_TABLE_ENTRY_SIZE));
+			groups.push_back({ id, offset });
 		}
 		break;
 	case tts::LEXICAL_REWRITE_RULE_TABLE_MAGIC:
 		{
-			uint16_t entries = mRules.u16();
-			uint8_t  id = mRules.u8();
-			uint32_t offset = mRules.offset();
-			mRules.seek(offset + (entries * tts::LEXICAL_REWRITE_RULES_TABLE_ENTRY_SIZE));
+			uint16_t entries = rules.u16();
+			uint8_t  id = rules.u8();
+			uint32_t offset = rules.offset();
+			rules.seek(offset + (entries * tts::LEXICAL_REWRITE_RULES_TABLE_ENTRY_SIZE));
 		}
 		break;
 	case tts::DICTIONARY_TABLE_MAGIC:
 		{
-			uint16_t entries = mRules.u16();
-			uint32_t offset = mRules.offset();
-			mRules.seek(offset + (entries * tts::DICTIONARY_TABLE_ENTRY_SIZE));
+			uint16_t entries = rules.u16();
+			uint32_t offset = rules.offset();
+			rules.seek(offset + (entries * tts::DICTIONARY_TABLE_ENTRY_SIZE));
 		}
 		break;
 	default:
 		throw std::runtime_error("unsupported section in the language file");
 	}
-}
 
-void ruleset::reset(const std::shared_ptr<cainteoir::buffer> &aBuffer)
-{
-	mBuffer = mRewriter->rewrite(aBuffer);
-	if (mBuffer.get())
+	cainteoir::trie<std::vector<uint32_t>, uint8_t> contexts;
+	for (const auto &group : groups)
 	{
-		mStart = mCurrent = (const uint8_t *)mBuffer->begin();
-		mEnd = (const uint8_t *)mBuffer->end();
-	}
-	else
-		mStart = mCurrent = mEnd = nullptr;
-	mPhonemeCurrent = mPhonemeEnd = nullptr;
-	(ipa::phoneme &)*this = ipa::unspecified;
-}
+		std::string prefix(1, (char)group.first);
+		contexts.insert(prefix);
 
-bool ruleset::read()
-{
-	mPreviousPhoneme = *this;
-	while (!mPhonemeSet->parse(mPhonemeCurrent, mPhonemeEnd, *this))
-	{
-		auto match = next_match(mCurrent);
-		if (!match.first)
-			return false;
+		rules.seek(group.second);
+		while (true)
+		{
+			const uint8_t *pattern = (const uint8_t *)rules.pstr();
+			if (*pattern == 0)
+				break;
 
-		mCurrent        = match.first;
-		mPhonemeCurrent = match.second;
-		mPhonemeEnd     = match.second + strlen(match.second);
-		mPhonemeSet->initialize();
+			const char *phonemes = rules.pstr();
+			prefix.resize(1);
+			if (compile_rule(rules, pattern, phonemes, prefix))
+			{
+				contexts.insert(prefix).push_back(mRules.size() - 1);
+				mLastRule[group.first] = mRules.size();
+			}
+			else
+				mLastRule[group.first] = 0;
+		}
 	}
-	return true;
+
+	std::vector<uint32_t> candidates;
+	std::string path;
+	cainteoir::trie<ruleset::candidates, uint8_t> compiled;
+	compile_contexts(*contexts.root(), candidates, path, compiled);
+	mContexts = compiled.compile();
 }
 
-bool ruleset::match_features_next(const char *phonemes, const uint8_t *&rules)
+bool ruleset::compile_rule(cainteoir::native_endian_buffer &aRules,
+                           const uint8_t *aPattern,
+                           const char *aPhonemes,
+                           std::string &aPrefix)
 {
-	const char *phonemes_end = phonemes + strlen(phonemes);
-	ipa::phoneme p;
-	char feature[4] = { 0, 0, 0, 0 };
-	uint8_t feature_pos = 0xFF;
-	while (true) switch (*rules)
+	constexpr uint32_t max_prefix = 64;
+
+	size_t instructions = mInstructions.size();
+	size_t features = mFeatures.size();
+	size_t feature_groups = mFeatureGroups.size();
+	size_t phonemes = mPhonemes.size();
+
+	rule r;
+	r.prefix = 0;
+	r.prefix_letters = aPattern;
+	r.context = r.left = r.right = r.end = instructions;
+	r.phonemes = aPhonemes;
+
+	section_t section = context_match;
+	bool in_prefix = true;
+	bool matches = true;
+	const uint8_t *pattern = aPattern;
+	while (matches && *pattern) switch (*pattern)
 	{
-	case 0:
-		return true;
+	case '@':
+		++pattern;
+		matches = mConditionalFlags[*pattern++];
+		if (r.prefix != 0) in_prefix = false;
+		break;
+	case '!':
+		++pattern;
+		matches = !mConditionalFlags[*pattern++];
+		if (r.prefix != 0) in_prefix = false;
+		break;
+	case '(':
+		if (section == context_match)
+			r.left = mInstructions.size();
+		section = right_match;
+		r.right = mInstructions.size();
+		++pattern;
+		break;
+	case ')':
+		section = left_match;
+		r.left = mInstructions.size();
+		++pattern;
+		break;
+	case '_':
+		matches = section != context_match;
+		mInstructions.push_back({ opcode::boundary, 0, 0, 0 });
+		++pattern;
+		break;
 	case '{':
-		if (!mPhonemeSet->parse(phonemes, phonemes_end, p))
-			return true;
-		feature_pos = 0;
-		++rules;
+		matches = section == right_match && compile_features_next(pattern);
 		break;
 	case '}':
-	case ',':
-		if (feature_pos != 3)
-			return false;
-		if (!p.get(feature))
-			return false;
-		feature_pos = (*rules == '}') ? 0xFF : 0;
-		++rules;
+		matches = section == left_match && compile_features_prev(pattern);
+		break;
+	case '/':
+		matches = section == right_match && compile_phonemes(pattern);
+		break;
+	case 'A': case 'B': case 'C': case 'D': case 'E': case 'F':
+	case 'G': case 'H': case 'I': case 'J': case 'K': case 'L': case 'M':
+	case 'N': case 'O': case 'P': case 'Q': case 'R': case 'S':
+	case 'T': case 'U': case 'V': case 'W': case 'X': case 'Y': case 'Z':
+		if (mClassDefs[*pattern] == 0)
+			matches = false;
+		else
+		{
+			instruction i{ opcode::classdef, *pattern, 0, (uint32_t)mClassEntries.size() };
+			uint32_t offset = aRules.offset();
+			aRules.seek(mClassDefs[*pattern]);
+			while (uint32_t entry = aRules.u32())
+			{
+				const char *value = aRules.pstr(entry);
+				mClassEntries.push_back({ (const uint8_t *)value, (const uint8_t *)value + strlen(value) });
+				++i.count;
+			}
+			aRules.seek(offset);
+			mInstructions.push_back(i);
+			in_prefix = false;
+			++pattern;
+		}
 		break;
 	default:
-		if (feature_pos == 0xFF)
-			return !mPhonemeSet->parse(phonemes, phonemes_end, p);
-		if (feature_pos >= 4)
-			return false;
-		feature[feature_pos++] = *rules++;
+		if (section == context_match && in_prefix && r.prefix < max_prefix)
+		{
+			// The first letter of the context is the rule group, so is already
+			// in the prefix.
+			if (r.prefix == 0)
+				r.prefix_letters = pattern;
+			else
+				aPrefix.push_back(*pattern);
+			++r.prefix;
+		}
+		else
+		{
+			mInstructions.push_back({ opcode::letter, *pattern, 0, 0 });
+			in_prefix = false;
+		}
+		++pattern;
 		break;
 	}
+
+	if (!matches)
+	{
+		mInstructions.resize(instructions);
+		mFeatures.resize(features);
+		mFeatureGroups.resize(feature_groups);
+		mPhonemes.resize(phonemes);
+		return false;
+	}
+
+	r.context = instructions;
+	if (section == context_match)
+		r.left = r.right = mInstructions.size();
+	else if (section == left_match)
+		r.right = mInstructions.size();
+	r.end = mInstructions.size();
+
+	ipa::phoneme p;
+	const char *current = aPhonemes;
+	const char *end = aPhonemes + strlen(aPhonemes);
+	r.output = mPhonemes.size();
+	mPhonemeSet->initialize();
+	while (mPhonemeSet->parse(current, end, p))
+		mPhonemes.push_back(p);
+	r.output_end = mPhonemes.size();
+
+	mRules.push_back(r);
+	return true;
+}
+
+bool ruleset::compile_features_next(const uint8_t *&pattern)
+{
+	instruction i{ opcode::features, 0, 0, (uint32_t)mFeatureGroups.size() };
+	while (*pattern == '{')
+	{
+		++pattern;
+
+		uint32_t first = mFeatures.size();
+		while (true)
+		{
+			feature f = { { 0, 0, 0, 0 } };
+			for (int pos = 0; pos != 3; ++pos) switch (*pattern)
+			{
+			case 0: case '{': case '}': case ',':
+				return false;
+			default:
+				f.name[pos] = *pattern++;
+				break;
+			}
+			mFeatures.push_back(f);
+
+			if (*pattern == '}')
+			{
+				++pattern;
+				break;
+			}
+			else if (*pattern++ != ',')
+				return false;
+		}
+
+		mFeatureGroups.push_back({ first, mFeatures.size() });
+		++i.count;
+	}
+
+	mInstructions.push_back(i);
+	return true;
 }
 
-bool ruleset::match_features_prev(const uint8_t *&rules)
+bool ruleset::compile_features_prev(const uint8_t *&pattern)
 {
-	char feature[4] = { 0, 0, 0, 0 };
+	// NOTE: The left context is stored in reverse order, so the feature
+	// groups are read from '}' to '{', with the feature names reversed.
+
+	instruction i{ opcode::features, 0, 0, (uint32_t)mFeatures.size() };
+	feature f = { { 0, 0, 0, 0 } };
 	uint8_t feature_pos = 0xFF;
-	while (true) switch (*rules)
+	while (true) switch (*pattern)
 	{
 	case 0:
 	case '(':
-		return feature_pos == 0xFF;
+		if (feature_pos != 0xFF)
+			return false;
+		mInstructions.push_back(i);
+		return true;
 	case '}':
 		feature_pos = 0;
-		++rules;
+		++pattern;
 		break;
 	case '{':
 	case ',':
 		if (feature_pos != 3)
 			return false;
-		if (!mPreviousPhoneme.get(feature))
-			return false;
-		feature_pos = (*rules == '{') ? 0xFF : 0;
-		++rules;
+		mFeatures.push_back(f);
+		++i.count;
+		feature_pos = (*pattern == '{') ? 0xFF : 0;
+		++pattern;
 		break;
 	default:
 		if (feature_pos == 0xFF || feature_pos >= 3)
 			return false;
-		feature[2 - feature_pos] = *rules++;
+		f.name[2 - feature_pos] = *pattern++;
 		++feature_pos;
 		break;
 	}
-	return false;
 }
 
-bool ruleset::match_phonemes_next(const char *phonemes, const uint8_t *&rules)
+bool ruleset::compile_phonemes(const uint8_t *&pattern)
 {
 	constexpr auto mask = ipa::main | ipa::diacritics | ipa::length;
 
-	auto *phonemes_end = phonemes + strlen(phonemes);
-
-	++rules;
-	auto *end = rules;
+	++pattern;
+	auto *end = pattern;
 	while (*end && *end != '/')
 		++end;
+	if (*end != '/')
+		return false;
 
-	ipa::phoneme p1;
-	ipa::phoneme p2;
-	while (mPhonemeSet->parse((const char *&)rules, (const char *)end, p1))
+	instruction i{ opcode::phonemes, 0, 0, (uint32_t)mPhonemes.size() };
+	ipa::phoneme p;
+	const char *current = (const char *)pattern;
+	mPhonemeSet->initialize();
+	while (mPhonemeSet->parse(current, (const char *)end, p))
 	{
-		if (!mPhonemeSet->parse(phonemes, phonemes_end, p2))
-			return false;
+		mPhonemes.push_back(p.get(mask));
+		++i.count;
+	}
 
-		if (p1.get(mask) != p2.get(mask))
-			return false;
+	if (current != (const char *)end)
+		return false;
+
+	pattern = end + 1;
+	mInstructions.push_back(i);
+	return true;
+}
+
+void ruleset::compile_contexts(const cainteoir::trie_node<std::vector<uint32_t>, uint8_t> &aNode,
+                               std::vector<uint32_t> &aCandidates,
+                               std::string &aPath,
+                               cainteoir::trie<candidates, uint8_t> &aContexts)
+{
+	// The candidate rules for a node are the rules on that node and all of its
+	// parent nodes. The rule indices are merged so the rules are matched in the
+	// order they are defined in.
+
+	std::vector<uint32_t> merged;
+	std::merge(aCandidates.begin(), aCandidates.end(),
+	           aNode.item.begin(), aNode.item.end(),
+	           std::back_inserter(merged));
+
+	if (!aPath.empty())
+	{
+		aContexts.insert(aPath) = { (uint32_t)mCandidates.size(), (uint32_t)merged.size() };
+		mCandidates.insert(mCandidates.end(), merged.begin(), merged.end());
 	}
 
-	if (rules == end && phonemes == phonemes_end)
+	for (const auto &child : aNode.children)
 	{
-		++rules;
-		return true;
+		aPath.push_back(child.c);
+		compile_contexts(child, merged, aPath, aContexts);
+		aPath.pop_back();
 	}
+}
 
-	return false;
+void ruleset::reset(const std::shared_ptr<cainteoir::buffer> &aBuffer)
+{
+	mBuffer = mRewriter->rewrite(aBuffer);
+	if (mBuffer.get())
+	{
+		mStart = mCurrent = (const uint8_t *)mBuffer->begin();
+		mEnd = (const uint8_t *)mBuffer->end();
+	}
+	else
+		mStart = mCurrent = mEnd = nullptr;
+	mPhonemeCurrent = mPhonemeEnd = nullptr;
+	(ipa::phoneme &)*this = ipa::unspecified;
 }
 
-bool ruleset::match_classdef(uint32_t offset, const uint8_t *&current)
+bool ruleset::read()
 {
-	uint32_t prev_offset = mRules.offset();
-	mRules.seek(offset);
+	mPreviousPhoneme = *this;
+	while (mPhonemeCurrent == mPhonemeEnd)
+	{
+		auto match = next_match(mCurrent);
+		if (!match.first)
+			return false;
 
-	while (true)
+		mCurrent        = match.first;
+		mPhonemeCurrent = mPhonemes.data() + match.second->output;
+		mPhonemeEnd     = mPhonemes.data() + match.second->output_end;
+	}
+	(ipa::phoneme &)*this = *mPhonemeCurrent++;
+	return true;
+}
+
+bool ruleset::match_context(const rule &aRule, const uint8_t *current, const uint8_t *&context)
+{
+	for (auto i = aRule.context; i != aRule.left; ++i)
 	{
-		offset = mRules.u32();
-		if (offset == 0)
+		const instruction &op = mInstructions[i];
+		switch (op.op)
 		{
-			mRules.seek(prev_offset);
+		case opcode::letter:
+			if (context < mEnd && *context == op.c)
+				++context;
+			else
+				return false;
+			break;
+		case opcode::classdef:
+			if (!match_classdef(op, context))
+				return false;
+			break;
+		default:
 			return false;
 		}
+	}
 
-		const uint8_t *match = (const uint8_t *)mRules.pstr(offset);
-		const uint8_t *check = current;
-		while (*match && check < mEnd && *check == *match)
+	const uint8_t *left = current - 1;
+	for (auto i = aRule.left; i != aRule.right; ++i)
+	{
+		const instruction &op = mInstructions[i];
+		switch (op.op)
 		{
-			++match;
-			++check;
+		case opcode::letter:
+			if (left >= mStart && *left == op.c)
+				--left;
+			else
+				return false;
+			break;
+		case opcode::classdef:
+			if (!match_classdef_back(op, left))
+				return false;
+			break;
+		case opcode::boundary:
+			if (left == mStart - 1)
+				break;
+			else if (*left == mBoundary)
+				--left;
+			else
+				return false;
+			break;
+		case opcode::features:
+			if (!match_features_prev(op))
+				return false;
+			break;
+		default:
+			return false;
 		}
+	}
 
-		if (!*match)
+	const uint8_t *right = context;
+	for (auto i = aRule.right; i != aRule.end; ++i)
+	{
+		const instruction &op = mInstructions[i];
+		switch (op.op)
 		{
-			current = check;
-			mRules.seek(prev_offset);
-			return true;
+		case opcode::letter:
+			if (right < mEnd && *right == op.c)
+				++right;
+			else
+				return false;
+			break;
+		case opcode::classdef:
+			if (!match_classdef(op, right))
+				return false;
+			break;
+		case opcode::boundary:
+			if (right == mEnd)
+				break;
+			else if (*right == mBoundary)
+				++right;
+			else
+				return false;
+			break;
+		case opcode::features:
+			if (!match_features_next(op, i + 1 == aRule.end, aRule, right))
+				return false;
+			break;
+		case opcode::phonemes:
+			if (!match_phonemes_next(op, aRule, right))
+				return false;
+			break;
 		}
 	}
+
+	return true;
 }
 
-bool ruleset::match_classdef_back(uint32_t offset, const uint8_t *&current)
+bool ruleset::match_features_next(const instruction &aInstruction, bool aLast, const rule &aRule, const uint8_t *&right)
 {
-	uint32_t prev_offset = mRules.offset();
-	mRules.seek(offset);
-
+	auto group = mFeatureGroups.begin() + aInstruction.value;
+	auto end   = group + aInstruction.count;
 	while (true)
 	{
-		offset = mRules.u32();
-		if (offset == 0)
+		auto ctx = next_context_match(aRule, right);
+		if (!ctx.first)
+			return false;
+
+		const ipa::phoneme *current = mPhonemes.data() + ctx.second->output;
+		const ipa::phoneme *last    = mPhonemes.data() + ctx.second->output_end;
+		for (; group != end && current != last; ++group, ++current)
 		{
-			mRules.seek(prev_offset);
+			for (auto f = group->first; f != group->second; ++f)
+			{
+				if (!current->get(mFeatures[f].name))
+					return false;
+			}
+		}
+
+		right = ctx.first;
+
+		// If there are more feature groups than phonemes in the matched rule,
+		// the remaining groups are matched against the next rule.
+		if (group != end)
+			continue;
+
+		return aLast || current == last;
+	}
+}
+
+bool ruleset::match_features_prev(const instruction &aInstruction)
+{
+	for (auto f = aInstruction.value; f != aInstruction.value + aInstruction.count; ++f)
+	{
+		if (!mPreviousPhoneme.get(mFeatures[f].name))
 			return false;
+	}
+	return true;
+}
+
+bool ruleset::match_phonemes_next(const instruction &aInstruction, const rule &aRule, const uint8_t *&right)
+{
+	constexpr auto mask = ipa::main | ipa::diacritics | ipa::length;
+
+	auto ctx = next_context_match(aRule, right);
+	if (!ctx.first)
+		return false;
+
+	if (ctx.second->output_end - ctx.second->output != aInstruction.count)
+		return false;
+
+	const ipa::phoneme *expected = mPhonemes.data() + aInstruction.value;
+	const ipa::phoneme *actual   = mPhonemes.data() + ctx.second->output;
+	for (uint16_t i = 0; i != aInstruction.count; ++i)
+	{
+		if (actual[i].get(mask) != expected[i])
+			return false;
+	}
+
+	right = ctx.first;
+	return true;
+}
+
+bool ruleset::match_classdef(const instruction &aInstruction, const uint8_t *&current)
+{
+	for (uint32_t i = aInstruction.value; i != aInstruction.value + aInstruction.count; ++i)
+	{
+		const uint8_t *match = mClassEntries[i].begin();
+		const uint8_t *end   = mClassEntries[i].end();
+		const uint8_t *check = current;
+		while (match != end && check < mEnd && *check == *match)
+		{
+			++match;
+			++check;
 		}
 
-		const uint8_t *start = (const uint8_t *)mRules.pstr(offset);
-		const uint8_t *match = start;
-		while (*match) ++match;
-		--match;
+		if (match == end)
+		{
+			current = check;
+			return true;
+		}
+	}
+	return false;
+}
 
+bool ruleset::match_classdef_back(const instruction &aInstruction, const uint8_t *&current)
+{
+	for (uint32_t i = aInstruction.value; i != aInstruction.value + aInstruction.count; ++i)
+	{
+		const uint8_t *start = mClassEntries[i].begin();
+		const uint8_t *match = mClassEntries[i].end() - 1;
 		const uint8_t *check = current;
 		while (match >= start && check >= mStart && *check == *match)
 		{
@@ -340,13 +778,28 @@ bool ruleset::match_classdef_back(uint32_t offset, const uint8_t *&current)
 		if (match < start)
 		{
 			current = check;
-			mRules.seek(prev_offset);
 			return true;
 		}
 	}
+	return false;
 }
 
-std::pair<const uint8_t *, const char *>
+std::pair<const uint8_t *, const ruleset::rule *>
+ruleset::next_context_match(const rule &aRule, const uint8_t *current)
+{
+	// The phoneme and feature contexts match against the phonemes of the
+	// next rule, with the previous phoneme being the first phoneme of the
+	// rule being matched.
+
+	ipa::phoneme prev_phoneme = mPreviousPhoneme;
+	if (aRule.output != aRule.output_end)
+		mPreviousPhoneme = mPhonemes[aRule.output];
+	auto ctx = next_match(current, ignore_elision_rules);
+	mPreviousPhoneme = prev_phoneme;
+	return ctx;
+}
+
+std::pair<const uint8_t *, const ruleset::rule *>
 ruleset::next_match(const uint8_t *current, elision_rules_t elision)
 {
 	while (current != mEnd && *current == mBoundary)
@@ -354,285 +807,59 @@ ruleset::next_match(const uint8_t *current, elision_rules_t elision)
 
 	if (current == mEnd) return { nullptr, nullptr };
 
-	uint32_t offset = mRuleGroups[*current];
-	if (offset == 0)
-	{
-		++current;
+	auto node = mContexts.root()->get(*current);
+	if (node == nullptr)
 		throw tts::phoneme_error(i18n("unable to pronounce the text"));
-	}
 
-	mRules.seek(offset);
-
-	static const uint8_t null_rule[] = { 0 };
-
-	enum state_t
+	const uint8_t *context = current + 1;
+	while (context != mEnd)
 	{
-		in_rule_group,
-		context_match,
-		left_match,
-		right_match,
-	};
+		auto next = node->get(*context);
+		if (next == nullptr) break;
+		node = next;
+		++context;
+	}
 
-	ipa::phoneme prev_phoneme;
-	state_t state = in_rule_group;
-	const uint8_t *rule     = null_rule;
-	const uint8_t *context  = nullptr;
-	const uint8_t *left     = nullptr;
-	const uint8_t *right    = nullptr;
-	const char    *phonemes = nullptr;
-	const char    *phonemes_ctx = nullptr;
-	const char    *phonemes_end = nullptr;
-	std::pair<const uint8_t *, const char *> ctx;
-	while (true) switch (*rule)
+	auto first = mCandidates.begin() + node->item.first;
+	auto last  = first + node->item.count;
+	for (; first != last; ++first)
 	{
-	case 0:
-		switch (state)
+		const rule &r = mRules[*first];
+		context = current + r.prefix;
+		if (match_context(r, current, context))
 		{
-		case in_rule_group:
-			rule = (const uint8_t *)mRules.pstr();
-			if (*rule == 0)
-			{
-				if (elision == ignore_elision_rules)
-					return next_match(context, elision);
-				++current;
-				throw tts::phoneme_error(i18n("unable to pronounce the text"));
-			}
-
-			phonemes = mRules.pstr();
-			phonemes_end = phonemes + strlen(phonemes);
-			context = left = right = current;
-			state = context_match;
-			break;
-		default:
-			if (elision == ignore_elision_rules && *phonemes == 0)
+			if (elision == ignore_elision_rules && *r.phonemes == 0)
 				return next_match(context, elision);
-			else
-				return { context, phonemes };
-			break;
-		}
-		break;
-	case '@':
-		++rule;
-		if (!mConditionalFlags[*rule++])
-		{
-			state = in_rule_group;
-			rule = null_rule;
+			return { context, &r };
 		}
-		break;
-	case '!':
-		++rule;
-		if (mConditionalFlags[*rule++])
-		{
-			state = in_rule_group;
-			rule = null_rule;
-		}
-		break;
-	case '(':
-		right = context;
-		state = right_match;
-		++rule;
-		break;
-	case ')':
-		state = left_match;
-		++rule;
-		--left;
-		break;
-	case '_':
-		switch (state)
-		{
-		case left_match:
-			if (left == mStart - 1)
-				++rule;
-			else if (*left == mBoundary)
-			{
-				++rule;
-				--left;
-			}
-			else
-			{
-				state = in_rule_group;
-				rule = null_rule;
-			}
-			break;
-		case right_match:
-			if (right == mEnd)
-				++rule;
-			else if (*right == mBoundary)
-			{
-				++rule;
-				++right;
-			}
-			else
-			{
-				state = in_rule_group;
-				rule = null_rule;
-			}
-			break;
-		default:
-			state = in_rule_group;
-			rule = null_rule;
-			break;
-		}
-		break;
-	case '{':
-		switch (state)
-		{
-		case right_match:
-			prev_phoneme = mPreviousPhoneme;
-			phonemes_ctx = phonemes;
-			mPhonemeSet->parse(phonemes_ctx, phonemes_end, mPreviousPhoneme);
-			offset = mRules.offset();
-			ctx = next_match(right, ignore_elision_rules);
-			mRules.seek(offset);
-			mPreviousPhoneme = prev_phoneme;
-			if (ctx.first != nullptr && match_features_next(ctx.second, rule))
-			{
-				right = ctx.first;
-			}
-			else
-			{
-				state = in_rule_group;
-				rule = null_rule;
-			}
-			break;
-		default:
-			state = in_rule_group;
-			rule = null_rule;
-			break;
-		}
-		break;
-	case '}':
-		switch (state)
-		{
-		case left_match:
-			if (!match_features_prev(rule))
-			{
-				state = in_rule_group;
-				rule = null_rule;
-			}
-			break;
-		default:
-			state = in_rule_group;
-			rule = null_rule;
-			break;
-		}
-		break;
-	case '/':
-		switch (state)
-		{
-		case right_match:
-			prev_phoneme = mPreviousPhoneme;
-			phonemes_ctx = phonemes;
-			mPhonemeSet->parse(phonemes_ctx, phonemes_end, mPreviousPhoneme);
-			offset = mRules.offset();
-			ctx = next_match(right, ignore_elision_rules);
-			mRules.seek(offset);
-			mPreviousPhoneme = prev_phoneme;
-			if (ctx.first != nullptr && match_phonemes_next(ctx.second, rule))
-			{
-				right = ctx.first;
-			}
-			else
-			{
-				state = in_rule_group;
-				rule = null_rule;
-			}
-			break;
-		default:
-			state = in_rule_group;
-			rule = null_rule;
-			break;
-		}
-		break;
-	case 'A': case 'B': case 'C': case 'D': case 'E': case 'F':
-	case 'G': case 'H': case 'I': case 'J': case 'K': case 'L': case 'M':
-	case 'N': case 'O': case 'P': case 'Q': case 'R': case 'S':
-	case 'T': case 'U': case 'V': case 'W': case 'X': case 'Y': case 'Z':
-		offset = mClassDefs[*rule];
-		if (offset == 0)
-		{
-			state = in_rule_group;
-			rule = null_rule;
-		}
-		else switch (state)
-		{
-		case context_match:
-			if (match_classdef(offset, context))
-			{
-				++rule;
-			}
-			else
-			{
-				state = in_rule_group;
-				rule = null_rule;
-			}
-			break;
-		case left_match:
-			if (match_classdef_back(offset, left))
-			{
-				++rule;
-			}
-			else
-			{
-				state = in_rule_group;
-				rule = null_rule;
-			}
-			break;
-		case right_match:
-			if (match_classdef(offset, right))
-			{
-				++rule;
-			}
-			else
-			{
-				state = in_rule_group;
-				rule = null_rule;
-			}
-			break;
-		}
-		break;
-	default:
-		switch (state)
+	}
+
+	if (elision == ignore_elision_rules)
+	{
+		// Continue matching from the position the context of the last rule in
+		// the rule group matched up to.
+		uint32_t last_rule = mLastRule[*current];
+		if (last_rule != 0)
 		{
-		case context_match:
-			if (context < mEnd && *context == *rule)
-			{
-				++rule;
+			const rule &r = mRules[last_rule - 1];
+			context = current;
+			while (context < mEnd && (uint32_t)(context - current) < r.prefix && *context == r.prefix_letters[context - current])
 				++context;
-			}
-			else
+			for (auto i = r.context; i != r.left; ++i)
 			{
-				state = in_rule_group;
-				rule = null_rule;
+				const instruction &op = mInstructions[i];
+				if (op.op == opcode::letter && context < mEnd && *context == op.c)
+					++context;
+				else if (op.op != opcode::classdef || !match_classdef(op, context))
+					break;
 			}
-			break;
-		case left_match:
-			if (left >= mStart && *left == *rule)
-			{
-				++rule;
-				--left;
-			}
-			else
-			{
-				state = in_rule_group;
-				rule = null_rule;
-			}
-			break;
-		case right_match:
-			if (right < mEnd && *right == *rule)
-			{
-				++rule;
-				++right;
-			}
-			else
-			{
-				state = in_rule_group;
-				rule = null_rule;
-			}
-			break;
+			if (context != current)
+				return next_match(context, elision);
 		}
-		break;
+		return { nullptr, nullptr };
 	}
+
+	throw tts::phoneme_error(i18n("unable to pronounce the text"));
 }
 
 std::shared_ptr<tts::phoneme_reader>
@@ -36,7 +36,7 @@ struct text_reader_t : public tts::text_reader
 
 	void reset(const std::shared_ptr<cainteoir::document_reader> &aReader);
 
-	bool read();
+	bool next();
 private:
 	bool matched();
 
@@ -92,7 +92,7 @@ void text_reader_t::reset(const std::shared_ptr<cainteoir::document_reader> &aRe
 	mReaderState = mReader ? reader_state::need_text : reader_state::end_paragraph;
 }
 
-bool text_reader_t::read()
+bool text_reader_t::next()
 {
 	while (mReaderState == reader_state::need_text && mReader->read())
 	{
@@ -136,10 +136,9 @@ bool text_reader_t::read()
 		if (mState != (int)fsm::state::start)
 			return matched();
 
-		token = cainteoir::object(cainteoir::object_type::dictionary);
-		token.put("Token:type", tts::paragraph);
-		token.put("Token:text", cainteoir::object{});
-		token.put("Token:range", cainteoir::range<uint32_t>{ mMatchNext, mMatchLast });
+		type  = tts::paragraph;
+		text  = { nullptr, nullptr };
+		range = { mMatchNext, mMatchLast };
 
 		mReaderState = reader_state::need_text;
 		mNeedEndPara = false;
@@ -240,15 +239,16 @@ bool text_reader_t::read()
 	}
 
 	mReaderState = reader_state::need_text;
-	return read();
+	return this->next();
 }
 
 bool text_reader_t::matched()
 {
-	token = cainteoir::object(cainteoir::object_type::dictionary);
-	token.put("Token:type", fsm::data[mState].value);
-	token.put("Token:text", cainteoir::make_buffer(mMatchBuffer, mMatchCurrent - mMatchBuffer));
-	token.put("Token:range", cainteoir::range<uint32_t>{ mMatchNext, mMatchLast });
+	// NOTE: The text references the match buffer, so is only valid until the
+	// next call to next().
+	type  = fsm::data[mState].value;
+	text  = { mMatchBuffer, mMatchCurrent };
+	range = { mMatchNext, mMatchLast };
 
 	mMatchCurrent = mMatchBuffer;
 	mMatchNext = mMatchLast;
@@ -257,6 +257,21 @@ bool text_reader_t::matched()
 	return true;
 }
 
+bool tts::text_reader::read()
+{
+	if (!next())
+		return false;
+
+	token = cainteoir::object(cainteoir::object_type::dictionary);
+	token.put("Token:type", type);
+	if (text.begin() == nullptr)
+		token.put("Token:text", cainteoir::object{});
+	else
+		token.put("Token:text", cainteoir::make_buffer(text.begin(), text.size()));
+	token.put("Token:range", range);
+	return true;
+}
+
 std::shared_ptr<tts::text_reader>
 tts::create_text_reader(tts::text_callback *aCallback)
 {
@@ -40,7 +40,7 @@ template <typename T>
 struct bind_value_t
 {
 	T &data;
-	const T &value;
+	T value;
 
 	bind_value_t(T &aData, const T &aValue)
 		: data(aData)
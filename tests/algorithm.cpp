@@ -49,6 +49,8 @@ int main(int argc, char ** argv)
 				f = cainteoir::fft;
 			else if (strcmp(argv[1], "ifft") == 0)
 				f = cainteoir::ifft;
+			else if (strcmp(argv[1], "rfft") == 0)
+				f = cainteoir::rfft;
 
 			n = strtol(argv[2], nullptr, 10);
 		}
@@ -60,6 +62,7 @@ int main(int argc, char ** argv)
 			fprintf(stdout, "usage: algorithm logr NUM_ELEMENTS\n");
 			fprintf(stdout, "usage: algorithm fft  NUM_ELEMENTS\n");
 			fprintf(stdout, "usage: algorithm ifft NUM_ELEMENTS\n");
+			fprintf(stdout, "usage: algorithm rfft NUM_ELEMENTS\n");
 			return EXIT_FAILURE;
 		}
 
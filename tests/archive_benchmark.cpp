@@ -0,0 +1,80 @@
+/* Archive benchmarks.
+ *
+ * Copyright (C) 2015 Reece H. Dunn
+ *
+ * This file is part of cainteoir-engine.
+ *
+ * cainteoir-engine is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * cainteoir-engine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cainteoir-engine.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "compatibility.hpp"
+
+#include <cainteoir/archive.hpp>
+
+#include "benchmark.hpp"
+#include "corpus.hpp"
+
+REGISTER_BENCHMARKSUITE("archive");
+
+static volatile size_t matches;
+
+static std::shared_ptr<cainteoir::buffer> generate_zip(std::size_t aEntries, std::size_t aWords)
+{
+	corpus_zip_writer zip;
+	for (std::size_t i = 0; i < aEntries; ++i)
+		zip.add("OEBPS/chapter" + std::to_string(i + 1) + ".xhtml", generate_text(aWords));
+	return zip.finish();
+}
+
+BENCHMARK("opening an archive")
+{
+	auto data = generate_zip(5000, 10);
+	cainteoir::rdf::uri subject("file.zip", std::string());
+	printf("  %d bytes\n", (int)data->size());
+
+	measure("open", "entries", 5000, [&]() {
+		matches = cainteoir::create_zip_archive(data, subject)->files().size();
+	});
+}
+
+BENCHMARK("reading archive entries")
+{
+	auto data = generate_zip(50, 50000);
+	cainteoir::rdf::uri subject("file.zip", std::string());
+	printf("  %d bytes\n", (int)data->size());
+
+	measure("read", "MB", data->size() / 1000000.0, [&]() {
+		auto archive = cainteoir::create_zip_archive(data, subject);
+		for (auto &file : archive->files())
+			matches = archive->read(file.c_str())->size();
+	});
+
+	measure("read (prefetch)", "MB", data->size() / 1000000.0, [&]() {
+		auto archive = cainteoir::create_zip_archive(data, subject);
+		archive->prefetch(archive->files(), 4);
+		for (auto &file : archive->files())
+			matches = archive->read(file.c_str())->size();
+	});
+
+	measure("read_stream", "MB", data->size() / 1000000.0, [&]() {
+		auto archive = cainteoir::create_zip_archive(data, subject);
+		for (auto &file : archive->files())
+		{
+			auto reader = archive->read_stream(file.c_str());
+			while (reader->read())
+				matches = reader->size();
+		}
+	});
+}
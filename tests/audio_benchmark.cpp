@@ -0,0 +1,103 @@
+/* Audio encoding benchmarks.
+ *
+ * Copyright (C) 2015 Reece H. Dunn
+ *
+ * This file is part of cainteoir-engine.
+ *
+ * cainteoir-engine is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * cainteoir-engine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cainteoir-engine.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "compatibility.hpp"
+
+#include <cainteoir/audio.hpp>
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+#include <cmath>
+
+#include "benchmark.hpp"
+#include "corpus.hpp"
+
+namespace rdf = cainteoir::rdf;
+
+REGISTER_BENCHMARKSUITE("audio");
+
+#define FREQUENCY 22050
+#define SECONDS   60
+
+// The number of samples passed to each audio::write call. This matches the
+// size of the blocks written by the synthesizers.
+#define BLOCK_SIZE 4096
+
+// Generate aSeconds of speech-like audio: a varying tone with a little noise.
+static std::vector<short> generate_samples(std::size_t aSeconds)
+{
+	corpus_random random;
+	std::vector<short> samples(aSeconds * FREQUENCY);
+	double phase = 0.0;
+	for (std::size_t i = 0; i < samples.size(); ++i)
+	{
+		double pitch = 100.0 + 20.0 * sin(2.0 * M_PI * i / FREQUENCY);
+		phase += 2.0 * M_PI * pitch / FREQUENCY;
+		samples[i] = (short)(8000.0 * sin(phase)) + (short)random(1000) - 500;
+	}
+	return samples;
+}
+
+static void write_samples(const std::shared_ptr<cainteoir::audio> &aOut, const std::vector<short> &aSamples)
+{
+	aOut->open();
+	for (std::size_t pos = 0; pos < aSamples.size(); pos += BLOCK_SIZE)
+	{
+		std::size_t count = std::min((std::size_t)BLOCK_SIZE, aSamples.size() - pos);
+		aOut->write((const char *)&aSamples[pos], count * sizeof(short));
+	}
+	aOut->close();
+}
+
+// The rate is reported in seconds of audio encoded per second, so the
+// real-time factor is the inverse of the measured value.
+BENCHMARK("audio encoding (generated 22050Hz s16le mono)")
+{
+	char path[] = "/tmp/cainteoir-audio-XXXXXX";
+	close(mkstemp(path));
+
+	auto samples = generate_samples(SECONDS);
+	printf("  %d seconds, %d samples\n", SECONDS, (int)samples.size());
+
+	measure("wav", "audio seconds", SECONDS, [&]() {
+		write_samples(cainteoir::create_wav_file(path, rdf::tts("s16le"), 1, FREQUENCY), samples);
+	});
+
+	std::list<cainteoir::vorbis_comment> comments;
+	for (float quality : { 0.3f, 0.6f })
+	{
+		auto ogg = cainteoir::create_ogg_file(path, comments, quality, rdf::tts("s16le"), 1, FREQUENCY);
+		if (!ogg)
+		{
+			printf("  ogg/vorbis encoding not available ... skipping\n");
+			break;
+		}
+		write_samples(ogg, samples);
+
+		char name[64];
+		snprintf(name, sizeof(name), "ogg (quality %.1f)", quality);
+		measure(name, "audio seconds", SECONDS, [&]() {
+			write_samples(cainteoir::create_ogg_file(path, comments, quality, rdf::tts("s16le"), 1, FREQUENCY), samples);
+		});
+	}
+
+	unlink(path);
+}
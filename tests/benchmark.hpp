@@ -0,0 +1,197 @@
+/* Benchmark -- C++ Performance Measurement Logic
+ *
+ * Copyright (C) 2015 Reece H. Dunn
+ *
+ * This file is part of cainteoir-engine.
+ *
+ * cainteoir-engine is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * cainteoir-engine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cainteoir-engine.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BENCHMARK_HPP
+#define BENCHMARK_HPP
+
+#include <cainteoir/stopwatch.hpp>
+
+#include <typeinfo>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// measurements ////////////////////////////////////////////////////////////////
+
+// The minimum amount of time (in seconds) to run each measurement for.
+double min_measure_time = 1.0;
+
+struct measurement
+{
+	std::string benchmark;
+	std::string name;
+	std::string units;
+	double rate;
+	double ms_per_iteration;
+	size_t iterations;
+};
+
+// The measurements made by the benchmark suite, written out by the --json
+// command-line option.
+std::vector<measurement> measurements;
+
+const char *current_benchmark = "";
+
+template <typename Function>
+double measure(const char *name, const char *units, double items, Function fn)
+{
+	size_t iterations = 0;
+	double elapsed = 0.0;
+	cainteoir::stopwatch timer;
+	do
+	{
+		fn();
+		++iterations;
+	} while ((elapsed = timer.elapsed()) < min_measure_time);
+
+	double rate = (items * iterations) / elapsed;
+	double ms_per_iteration = (elapsed / iterations) * 1000.0;
+	printf("    %-48s %14.2f %s/s (%.3f ms/iteration)\n",
+	       name, rate, units, ms_per_iteration);
+	measurements.push_back({ current_benchmark, name, units, rate, ms_per_iteration, iterations });
+	return rate;
+}
+
+// benchmarks //////////////////////////////////////////////////////////////////
+
+typedef void (*benchmark_function)();
+
+struct benchmark_case;
+
+benchmark_case *benchmark_case_first = NULL;
+benchmark_case *benchmark_case_last = NULL;
+
+struct benchmark_case
+{
+	const char *name;
+	benchmark_function benchmark;
+	benchmark_case *next;
+
+	benchmark_case(const char *aName, benchmark_function aBenchmark) : name(aName), benchmark(aBenchmark)
+	{
+		if (!benchmark_case_first)
+			benchmark_case_first = benchmark_case_last = this;
+
+		benchmark_case_last->next = this;
+		benchmark_case_last = this;
+
+		next = NULL;
+	}
+};
+
+#define BENCHMARK_IMPL(name, line) \
+	void benchmark_fn##line(); \
+	static const benchmark_case benchmark_data##line (name, benchmark_fn##line); \
+	void benchmark_fn##line()
+#define BENCHMARK_(name, line) BENCHMARK_IMPL(name, line)
+
+#define BENCHMARK(name) BENCHMARK_(name, __LINE__)
+
+extern const char *benchmark_suite_name;
+
+#define REGISTER_BENCHMARKSUITE(name) \
+	const char *benchmark_suite_name = name;
+
+// json output /////////////////////////////////////////////////////////////////
+
+static void write_json_string(FILE *out, const std::string &s)
+{
+	fputc('"', out);
+	for (unsigned char c : s)
+	{
+		if (c == '"' || c == '\\')
+			fprintf(out, "\\%c", c);
+		else if (c < 0x20)
+			fprintf(out, "\\u%04x", c);
+		else
+			fputc(c, out);
+	}
+	fputc('"', out);
+}
+
+static bool write_json(const char *filename, int failed)
+{
+	FILE *out = fopen(filename, "wb");
+	if (!out)
+		return false;
+
+	fprintf(out, "{\n\t\"suite\": ");
+	write_json_string(out, benchmark_suite_name);
+	fprintf(out, ",\n\t\"min_measure_time\": %g,\n", min_measure_time);
+	fprintf(out, "\t\"failed\": %d,\n", failed);
+	fprintf(out, "\t\"results\": [");
+	for (auto m = measurements.begin(); m != measurements.end(); ++m)
+	{
+		fprintf(out, m == measurements.begin() ? "\n\t\t{ \"benchmark\": " : ",\n\t\t{ \"benchmark\": ");
+		write_json_string(out, m->benchmark);
+		fprintf(out, ", \"name\": ");
+		write_json_string(out, m->name);
+		fprintf(out, ", \"units\": ");
+		write_json_string(out, m->units);
+		fprintf(out, ", \"rate\": %.6g, \"ms_per_iteration\": %.6g, \"iterations\": %zu }",
+		        m->rate, m->ms_per_iteration, m->iterations);
+	}
+	fprintf(out, "\n\t]\n}\n");
+	return fclose(out) == 0;
+}
+
+// Usage: <suite>.bench [--json FILE] [MIN_MEASURE_TIME]
+int main(int argc, const char ** argv)
+{
+	int failed = 0;
+	const char *json = nullptr;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (!strcmp(argv[i], "--json") && i + 1 < argc)
+			json = argv[++i];
+		else
+			min_measure_time = strtod(argv[i], nullptr);
+	}
+
+	printf("========== %s benchmarks ==========\n\n", benchmark_suite_name);
+	for (benchmark_case *benchmark = benchmark_case_first; benchmark; benchmark = benchmark->next)
+	{
+		printf("... benchmarking %s\n", benchmark->name);
+		current_benchmark = benchmark->name;
+		try
+		{
+			(*benchmark->benchmark)();
+		}
+		catch (const std::exception &e)
+		{
+			printf("error: a %s exception was thrown: %s\n", typeid(e).name(), e.what());
+			++failed;
+		}
+	}
+	printf("\n");
+
+	if (json && !write_json(json, failed))
+	{
+		fprintf(stderr, "error: unable to write the results to %s\n", json);
+		++failed;
+	}
+
+	return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+#endif
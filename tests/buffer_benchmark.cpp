@@ -0,0 +1,130 @@
+/* File buffer benchmarks.
+ *
+ * Copyright (C) 2015 Reece H. Dunn
+ *
+ * This file is part of cainteoir-engine.
+ *
+ * cainteoir-engine is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * cainteoir-engine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cainteoir-engine.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "compatibility.hpp"
+
+#include <cainteoir/buffer.hpp>
+
+#include "benchmark.hpp"
+#include "corpus.hpp"
+
+#include <pthread.h>
+#include <unistd.h>
+
+REGISTER_BENCHMARKSUITE("buffer");
+
+static volatile size_t matches;
+
+struct pipe_writer
+{
+	const std::string *data;
+	int fd;
+};
+
+static void *write_pipe(void *aData)
+{
+	pipe_writer *writer = (pipe_writer *)aData;
+	const char *begin = writer->data->c_str();
+	const char *end   = begin + writer->data->size();
+	while (begin < end)
+	{
+		ssize_t written = write(writer->fd, begin, end - begin);
+		if (written <= 0)
+			break;
+		begin += written;
+	}
+	close(writer->fd);
+	return nullptr;
+}
+
+// Read the data from a pipe that is being written to by another thread.
+template <typename Reader>
+static size_t read_pipe(const std::string &aData, Reader reader)
+{
+	int fds[2];
+	if (pipe(fds) == -1)
+		throw std::runtime_error("unable to create the pipe");
+
+	pipe_writer writer = { &aData, fds[1] };
+	pthread_t thread;
+	pthread_create(&thread, nullptr, write_pipe, &writer);
+
+	size_t size = reader(fds[0]);
+
+	pthread_join(thread, nullptr);
+	close(fds[0]);
+	return size;
+}
+
+// Read the file into a rope 1 KB at a time, for comparison.
+static std::shared_ptr<cainteoir::buffer> read_rope(int fd)
+{
+	cainteoir::rope data;
+	char buffer[1024];
+
+	ssize_t read = 0;
+	while ((read = ::read(fd, buffer, sizeof(buffer))) > 0)
+		data += cainteoir::make_buffer(buffer, read);
+
+	return data.buffer();
+}
+
+BENCHMARK("reading files")
+{
+	std::string text = generate_text(2000000);
+	printf("  %d bytes\n", (int)text.size());
+
+	measure("pipe (rope)", "MB", text.size() / 1000000.0, [&]() {
+		matches = read_pipe(text, [](int fd) { return read_rope(fd)->size(); });
+	});
+
+	measure("pipe (fd)", "MB", text.size() / 1000000.0, [&]() {
+		matches = read_pipe(text, [](int fd) { return cainteoir::make_file_buffer(fd)->size(); });
+	});
+
+	measure("pipe (FILE)", "MB", text.size() / 1000000.0, [&]() {
+		matches = read_pipe(text, [](int fd) {
+			FILE *f = fdopen(dup(fd), "rb");
+			size_t size = cainteoir::make_file_buffer(f)->size();
+			fclose(f);
+			return size;
+		});
+	});
+
+	char filename[] = "/tmp/cainteoir-buffer-XXXXXX";
+	int fd = mkstemp(filename);
+	if (fd == -1)
+		throw std::runtime_error("unable to create the temporary file");
+	write(fd, text.c_str(), text.size());
+
+	measure("file (rope)", "MB", text.size() / 1000000.0, [&]() {
+		lseek(fd, 0, SEEK_SET);
+		matches = read_rope(fd)->size();
+	});
+
+	measure("file (fd)", "MB", text.size() / 1000000.0, [&]() {
+		lseek(fd, 0, SEEK_SET);
+		matches = cainteoir::make_file_buffer(fd)->size();
+	});
+
+	close(fd);
+	unlink(filename);
+}
@@ -0,0 +1,252 @@
+/* Test for the compiled dictionary format.
+ *
+ * Copyright (C) 2015 Reece H. Dunn
+ *
+ * This file is part of cainteoir-engine.
+ *
+ * cainteoir-engine is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * cainteoir-engine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cainteoir-engine.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "compatibility.hpp"
+
+#include <cainteoir/dictionary.hpp>
+#include <cstdio>
+#include <unistd.h>
+
+#include "tester.hpp"
+
+namespace tts = cainteoir::tts;
+namespace ipa = cainteoir::ipa;
+
+REGISTER_TESTSUITE("compiled_dictionary");
+
+static std::shared_ptr<cainteoir::buffer>
+compile(const char *aDictionaryPath)
+{
+	std::shared_ptr<FILE> out(tmpfile(), fclose);
+	tts::compile_dictionary(aDictionaryPath, out.get());
+	rewind(out.get());
+	return cainteoir::make_file_buffer(out.get());
+}
+
+static void
+load(const char *aDictionaryPath, tts::dictionary &aDictionary)
+{
+	auto reader = tts::createDictionaryReader(aDictionaryPath);
+	assert(reader.get());
+	while (reader->read())
+		aDictionary.add_entry(reader->word, reader->entry);
+}
+
+static void
+match_(tts::dictionary &dict,
+       const tts::compiled_dictionary &compiled,
+       const char *word,
+       const char *file,
+       int line)
+{
+	auto key = cainteoir::make_buffer(word, strlen(word));
+
+	ipa::phonemes expected;
+	bool expected_result = dict.pronounce(key, {}, expected);
+
+	ipa::phonemes got;
+	bool got_result = compiled.pronounce(key, {}, got);
+
+	assert_location(got_result == expected_result, file, line);
+	assert_location(got.size() == expected.size(), file, line);
+	if (got.size() == expected.size())
+		assert_location(std::equal(got.begin(), got.end(), expected.begin()), file, line);
+}
+
+#define match(dict, compiled, word) match_(dict, compiled, word, __FILE__, __LINE__)
+
+// Create a compiled dictionary with a single "a" => "b" say-as entry in a
+// single bucket, so none of the buckets are empty.
+static std::shared_ptr<cainteoir::buffer>
+make_dictdb(uint32_t aBucket, uint32_t aWord, uint32_t aCount)
+{
+	std::string data = "DICTDB";
+	auto put = [&data](uint32_t aValue, std::size_t aSize)
+	{
+		data.append((const char *)&aValue, aSize); // assumes a little endian host
+	};
+
+	put(0x3031, 2); // endianness
+	put(1, 4);      // number of entries
+	put(44, 4);     // phonemes offset
+	put(44, 4);     // strings offset
+	put(1, 4);      // number of buckets
+	put(aBucket, 4);
+	put(aWord, 4);  // word
+	put(1, 2);      // length
+	put(2, 1);      // type (say-as)
+	put(0, 1);      // reserved
+	put(46, 4);     // value
+	put(aCount, 4); // count
+	data.append("a\0b\0", 4);
+	return cainteoir::make_buffer(data.c_str(), data.size());
+}
+
+TEST_CASE("invalid data")
+{
+	bool thrown = false;
+	try
+	{
+		tts::compiled_dictionary dict(std::make_shared<cainteoir::buffer>("LANGDB"));
+	}
+	catch (const std::runtime_error &e)
+	{
+		thrown = true;
+	}
+	assert(thrown);
+}
+
+TEST_CASE("corrupt data")
+{
+	tts::compiled_dictionary compiled{ make_dictdb(1, 44, 1) };
+	assert(compiled.size() == 1);
+	assert(compiled.lookup(cainteoir::buffer("a")).say_as.compare("b") == 0);
+	assert(compiled.lookup(cainteoir::buffer("c")).type == tts::compiled_dictionary::entry_type::no_match);
+	assert(compiled[1].type == tts::compiled_dictionary::entry_type::no_match);
+	assert(compiled.word(1).empty());
+
+	assert_throws(tts::compiled_dictionary(make_dictdb(2, 44, 1)),
+	              std::runtime_error, "compiled dictionary entry is outside of the data");
+	assert_throws(tts::compiled_dictionary(make_dictdb(1, 48, 1)),
+	              std::runtime_error, "compiled dictionary entry is outside of the data");
+	assert_throws(tts::compiled_dictionary(make_dictdb(1, 44, 0xFFFFFFFF)),
+	              std::runtime_error, "compiled dictionary entry is outside of the data");
+}
+
+TEST_CASE("phoneme entries")
+{
+	tts::compiled_dictionary compiled{ compile("tests/dict/cainteoir/ipa-phonemes.dict") };
+	tts::dictionary dict;
+	load("tests/dict/cainteoir/ipa-phonemes.dict", dict);
+
+	assert(compiled.size() == dict.size());
+	assert(!compiled.empty());
+
+	for (const auto &entry : dict)
+		match(dict, compiled, entry.first->str().c_str());
+
+	auto entry = compiled.lookup(cainteoir::buffer("marry"));
+	assert(entry.type == tts::compiled_dictionary::entry_type::phonemes);
+	assert(!entry.phonemes.empty());
+
+	assert(compiled.lookup(cainteoir::buffer("mar")).type == tts::compiled_dictionary::entry_type::no_match);
+	assert(compiled.lookup(cainteoir::buffer("marryx")).type == tts::compiled_dictionary::entry_type::no_match);
+	assert(compiled.lookup(cainteoir::buffer("zzz")).type == tts::compiled_dictionary::entry_type::no_match);
+	assert(compiled.lookup("", 0).type == tts::compiled_dictionary::entry_type::no_match);
+}
+
+TEST_CASE("entries are sorted")
+{
+	tts::compiled_dictionary compiled{ compile("tests/dict/cainteoir/words.dict") };
+	assert(!compiled.empty());
+
+	for (std::size_t i = 1; i < compiled.size(); ++i)
+		assert(compiled.word(i - 1).str() < compiled.word(i).str());
+
+	for (std::size_t i = 0; i < compiled.size(); ++i)
+	{
+		auto word = compiled.word(i);
+		assert(compiled.lookup(word).type != tts::compiled_dictionary::entry_type::no_match);
+	}
+}
+
+TEST_CASE("say-as entries")
+{
+	tts::compiled_dictionary compiled{ compile("tests/dict/cainteoir/say-as-nested.dict") };
+	tts::dictionary dict;
+	load("tests/dict/cainteoir/say-as-nested.dict", dict);
+
+	auto entry = compiled.lookup(cainteoir::buffer("salli"));
+	assert(entry.type == tts::compiled_dictionary::entry_type::say_as);
+	assert(entry.say_as.compare("sallie") == 0);
+
+	match(dict, compiled, "sally");
+	match(dict, compiled, "sallie");
+	match(dict, compiled, "salli");
+	match(dict, compiled, "sal");
+}
+
+TEST_CASE("say-as recursion")
+{
+	tts::compiled_dictionary compiled{ compile("tests/dict/cainteoir/say-as-infinite-recursion.dict") };
+	tts::dictionary dict;
+	load("tests/dict/cainteoir/say-as-infinite-recursion.dict", dict);
+
+	for (const auto &entry : dict)
+		match(dict, compiled, entry.first->str().c_str());
+}
+
+TEST_CASE("multi-word entries")
+{
+	tts::compiled_dictionary compiled{ compile("tests/dict/cainteoir/say-as-compound.dict") };
+	tts::dictionary dict;
+	load("tests/dict/cainteoir/say-as-compound.dict", dict);
+
+	for (const auto &entry : dict)
+		match(dict, compiled, entry.first->str().c_str());
+
+	match(dict, compiled, "bed-room");
+	match(dict, compiled, "what-so-ever");
+	match(dict, compiled, "bed-rom");
+}
+
+TEST_CASE("dictionary reader")
+{
+	char path[] = "/tmp/cainteoir-dictdb-XXXXXX";
+	int fd = mkstemp(path);
+	assert(fd != -1);
+	if (fd == -1) return;
+	{
+		std::shared_ptr<FILE> out(fdopen(fd, "wb"), fclose);
+		tts::compile_dictionary("tests/dict/cainteoir/say-as-compound.dict", out.get());
+	}
+
+	auto reader = tts::createDictionaryReader(path);
+	assert(reader.get());
+	if (reader)
+	{
+		tts::dictionary dict;
+		load("tests/dict/cainteoir/say-as-compound.dict", dict);
+
+		std::size_t entries = 0;
+		while (reader->read())
+		{
+			++entries;
+
+			const auto &expected = dict.lookup(reader->word).get(0).get("Entry::pronunciation");
+			const auto &got = reader->entry.get("Entry::pronunciation");
+			if (expected.is_buffer())
+			{
+				assert(got.is_buffer());
+				if (got.is_buffer())
+					assert(got.buffer()->compare(*expected.buffer()) == 0);
+			}
+			else
+			{
+				assert(got.is_phonemes());
+				if (got.is_phonemes())
+					assert(*got.phonemes() == *expected.phonemes());
+			}
+		}
+		assert(entries == dict.size());
+	}
+	unlink(path);
+}
@@ -20,6 +20,7 @@
 
 #include <cainteoir/sigproc.hpp>
 #include <cstdio>
+#include <cmath>
 
 #include "tester.hpp"
 
@@ -164,3 +165,48 @@ TEST_CASE("ifft")
 	cainteoir::ifft(a);
 	match(a, b);
 }
+
+TEST_CASE("rfft")
+{
+	cainteoir::complex_array a = {
+		{  0.0f,  0.0f },
+		{  1.0f,  0.0f },
+		{  2.0f,  0.0f },
+		{  3.0f,  0.0f },
+		{  4.0f,  0.0f },
+		{  5.0f,  0.0f },
+		{  6.0f,  0.0f },
+		{  7.0f,  0.0f },
+	};
+
+	cainteoir::complex_array b = {
+		{  28.0f,  0.0f },
+		{  -4.0f,  9.6569f },
+		{  -4.0f,  4.0f },
+		{  -4.0f,  1.6569f },
+		{  -4.0f,  0.0f },
+		{  -4.0f, -1.6569f },
+		{  -4.0f, -4.0f },
+		{  -4.0f, -9.6569f },
+	};
+
+	cainteoir::rfft(a);
+	match(a, b);
+}
+
+TEST_CASE("fft and rfft -- 256 samples")
+{
+	cainteoir::complex_array a;
+	for (int i = 0; i < 256; ++i)
+		a.push_back({ sinf(i * 0.3f) + 0.5f * cosf(i * 1.7f), 0.0f });
+
+	cainteoir::complex_array b = a;
+	cainteoir::complex_array c = a;
+
+	cainteoir::fft(b);
+	cainteoir::rfft(c);
+	match(c, b);
+
+	cainteoir::ifft(b);
+	match(b, a);
+}
@@ -0,0 +1,353 @@
+/* Generated test corpora for the benchmarks.
+ *
+ * Copyright (C) 2015 Reece H. Dunn
+ *
+ * This file is part of cainteoir-engine.
+ *
+ * cainteoir-engine is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * cainteoir-engine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cainteoir-engine.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CORPUS_HPP
+#define CORPUS_HPP
+
+#include <cainteoir/buffer.hpp>
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// The corpora are generated from a fixed seed so that the benchmark results
+// are comparable between runs without needing to ship large test files.
+
+struct corpus_random
+{
+	corpus_random(uint32_t aSeed = 1) : mState(aSeed) {}
+
+	uint32_t operator()(uint32_t aMax)
+	{
+		mState = mState * 1103515245 + 12345;
+		return (mState >> 16) % aMax;
+	}
+private:
+	uint32_t mState;
+};
+
+static const char *corpus_words[] =
+{
+	"the", "of", "and", "to", "in", "was", "he", "that", "it", "his",
+	"her", "with", "as", "had", "for", "she", "not", "at", "but", "be",
+	"on", "they", "him", "said", "from", "which", "have", "all", "were", "by",
+	"little", "house", "garden", "window", "morning", "evening", "river", "mountain", "letter", "journey",
+	"thought", "remembered", "answered", "whispered", "carriage", "gentleman", "beautiful", "quietly", "suddenly", "together",
+	"don't", "it's", "twenty-one", "well-known", "café", "naïve", "Dublin", "London", "Mr", "BBC",
+};
+
+// Generate plain text containing aWords words, split into paragraphs.
+inline std::string generate_text(std::size_t aWords, uint32_t aSeed = 1)
+{
+	static const std::size_t num_words = sizeof(corpus_words) / sizeof(corpus_words[0]);
+
+	corpus_random random(aSeed);
+	std::string text;
+	text.reserve(aWords * 7);
+
+	bool start_of_sentence = true;
+	for (std::size_t i = 0; i < aWords; ++i)
+	{
+		if (random(16) == 0)
+		{
+			text += std::to_string(random(2000));
+			if (random(4) == 0) text += "th";
+		}
+		else
+		{
+			std::string word = corpus_words[random(num_words)];
+			if (start_of_sentence && word[0] >= 'a' && word[0] <= 'z')
+				word[0] = word[0] - 'a' + 'A';
+			text += word;
+		}
+		start_of_sentence = false;
+
+		switch (random(24))
+		{
+		case 0: case 1: case 2:
+			text += ". ";
+			start_of_sentence = true;
+			break;
+		case 3:
+			text += ", ";
+			break;
+		case 4:
+			text += "; ";
+			break;
+		case 5:
+			text += "? ";
+			start_of_sentence = true;
+			break;
+		default:
+			text += ' ';
+			break;
+		}
+
+		if (start_of_sentence && random(6) == 0)
+			text += "\n\n";
+	}
+	text += ".\n";
+	return text;
+}
+
+// Generate an XHTML document containing aWords words.
+inline std::string generate_xhtml(std::size_t aWords, uint32_t aSeed = 1)
+{
+	std::string html =
+		"<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+		"<html xmlns=\"http://www.w3.org/1999/xhtml\">\n"
+		"<head><title>Chapter</title></head>\n"
+		"<body>\n"
+		"<h1>Chapter</h1>\n"
+		"<p>";
+
+	std::string text = generate_text(aWords, aSeed);
+	for (std::size_t pos = 0; pos < text.size(); ++pos)
+	{
+		if (text[pos] == '\n' && pos + 1 < text.size() && text[pos + 1] == '\n')
+		{
+			html += "</p>\n<p>";
+			++pos;
+		}
+		else if (text[pos] == '&')
+			html += "&amp;";
+		else
+			html += text[pos];
+	}
+
+	html += "</p>\n</body>\n</html>\n";
+	return html;
+}
+
+// Generate an RTF document containing aWords words. The Latin-1 characters in
+// the text are written as \'xx escapes.
+inline std::string generate_rtf(std::size_t aWords, uint32_t aSeed = 1)
+{
+	static const char *hex = "0123456789abcdef";
+
+	std::string rtf =
+		"{\\rtf1\\ansi\\deff0{\\fonttbl{\\f0\\froman Times New Roman;}}\n"
+		"{\\info{\\title Chapter}}\n"
+		"\\f0\\pard ";
+
+	std::string text = generate_text(aWords, aSeed);
+	for (std::size_t pos = 0; pos < text.size(); ++pos)
+	{
+		unsigned char c = text[pos];
+		if (c == '\n' && pos + 1 < text.size() && text[pos + 1] == '\n')
+		{
+			rtf += "\\par\n";
+			++pos;
+		}
+		else if (c == 0xC3 && pos + 1 < text.size())
+		{
+			unsigned char latin1 = 0xC0 | (text[++pos] & 0x3F);
+			rtf += "\\'";
+			rtf += hex[latin1 >> 4];
+			rtf += hex[latin1 & 0x0F];
+		}
+		else
+			rtf += c;
+	}
+
+	rtf += "\\par\n}\n";
+	return rtf;
+}
+
+// ZIP archive writer (stored entries only) ////////////////////////////////////
+
+inline uint32_t corpus_crc32(const std::string &aData)
+{
+	static uint32_t table[256] = { 0 };
+	if (table[1] == 0) for (uint32_t n = 0; n < 256; ++n)
+	{
+		uint32_t c = n;
+		for (int k = 0; k < 8; ++k)
+			c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+		table[n] = c;
+	}
+
+	uint32_t crc = 0xFFFFFFFF;
+	for (auto c : aData)
+		crc = table[(crc ^ (uint8_t)c) & 0xFF] ^ (crc >> 8);
+	return crc ^ 0xFFFFFFFF;
+}
+
+struct corpus_zip_writer
+{
+	void add(const std::string &aFileName, const std::string &aData)
+	{
+		uint32_t offset = mData.size();
+		uint32_t crc = corpus_crc32(aData);
+
+		u32(mData, 0x04034b50); // local file header
+		u16(mData, 10);         // version needed to extract
+		u16(mData, 0);          // flags
+		u16(mData, 0);          // compression (stored)
+		u16(mData, 0);          // modification time
+		u16(mData, 0);          // modification date
+		u32(mData, crc);
+		u32(mData, aData.size());
+		u32(mData, aData.size());
+		u16(mData, aFileName.size());
+		u16(mData, 0);          // extra field length
+		mData += aFileName;
+		mData += aData;
+
+		u32(mCentral, 0x02014b50); // central directory header
+		u16(mCentral, 20);         // version made by
+		u16(mCentral, 10);         // version needed to extract
+		u16(mCentral, 0);          // flags
+		u16(mCentral, 0);          // compression (stored)
+		u16(mCentral, 0);          // modification time
+		u16(mCentral, 0);          // modification date
+		u32(mCentral, crc);
+		u32(mCentral, aData.size());
+		u32(mCentral, aData.size());
+		u16(mCentral, aFileName.size());
+		u16(mCentral, 0);          // extra field length
+		u16(mCentral, 0);          // comment length
+		u16(mCentral, 0);          // disk number
+		u16(mCentral, 0);          // internal attributes
+		u32(mCentral, 0);          // external attributes
+		u32(mCentral, offset);
+		mCentral += aFileName;
+
+		++mEntries;
+	}
+
+	std::shared_ptr<cainteoir::buffer> finish()
+	{
+		uint32_t offset = mData.size();
+		mData += mCentral;
+
+		u32(mData, 0x06054b50); // end of central directory
+		u16(mData, 0);          // disk number
+		u16(mData, 0);          // disk with the central directory
+		u16(mData, mEntries);
+		u16(mData, mEntries);
+		u32(mData, mCentral.size());
+		u32(mData, offset);
+		u16(mData, 0);          // comment length
+
+		return cainteoir::make_buffer(mData.c_str(), mData.size());
+	}
+private:
+	static void u16(std::string &s, uint16_t value)
+	{
+		s += (char)(value & 0xFF);
+		s += (char)(value >> 8);
+	}
+
+	static void u32(std::string &s, uint32_t value)
+	{
+		u16(s, value & 0xFFFF);
+		u16(s, value >> 16);
+	}
+
+	std::string mData;
+	std::string mCentral;
+	uint16_t mEntries = 0;
+};
+
+// Generate an EPUB 2 document with aChapters chapters of aWords words. If aToc
+// is set, the document has an NCX table of contents with an entry for each
+// chapter.
+inline std::shared_ptr<cainteoir::buffer>
+generate_epub(std::size_t aChapters, std::size_t aWords, bool aToc = false)
+{
+	corpus_zip_writer zip;
+	zip.add("mimetype", "application/epub+zip");
+	zip.add("META-INF/container.xml",
+		"<?xml version=\"1.0\"?>\n"
+		"<container version=\"1.0\" xmlns=\"urn:oasis:names:tc:opendocument:xmlns:container\">\n"
+		"<rootfiles>\n"
+		"<rootfile full-path=\"OEBPS/content.opf\" media-type=\"application/oebps-package+xml\"/>\n"
+		"</rootfiles>\n"
+		"</container>\n");
+
+	std::string manifest;
+	std::string spine;
+	std::string navmap;
+	for (std::size_t i = 0; i < aChapters; ++i)
+	{
+		std::string id = "chapter" + std::to_string(i + 1);
+		manifest += "<item id=\"" + id + "\" href=\"" + id + ".xhtml\" media-type=\"application/xhtml+xml\"/>\n";
+		spine += "<itemref idref=\"" + id + "\"/>\n";
+		navmap += "<navPoint id=\"np" + std::to_string(i + 1) + "\" playOrder=\"" + std::to_string(i + 1) + "\">"
+		          "<navLabel><text>Chapter " + std::to_string(i + 1) + "</text></navLabel>"
+		          "<content src=\"" + id + ".xhtml\"/></navPoint>\n";
+	}
+
+	if (aToc)
+	{
+		manifest += "<item id=\"ncx\" href=\"toc.ncx\" media-type=\"application/x-dtbncx+xml\"/>\n";
+		zip.add("OEBPS/toc.ncx",
+			"<?xml version=\"1.0\"?>\n"
+			"<ncx xmlns=\"http://www.daisy.org/z3986/2005/ncx/\" version=\"2005-1\">\n"
+			"<head/>\n"
+			"<docTitle><text>Benchmark Corpus</text></docTitle>\n"
+			"<navMap>\n" + navmap + "</navMap>\n"
+			"</ncx>\n");
+	}
+
+	zip.add("OEBPS/content.opf",
+		"<?xml version=\"1.0\"?>\n"
+		"<package xmlns=\"http://www.idpf.org/2007/opf\" version=\"2.0\" unique-identifier=\"id\">\n"
+		"<metadata xmlns:dc=\"http://purl.org/dc/elements/1.1/\">\n"
+		"<dc:title>Benchmark Corpus</dc:title>\n"
+		"<dc:identifier id=\"id\">benchmark-corpus</dc:identifier>\n"
+		"<dc:language>en</dc:language>\n"
+		"</metadata>\n"
+		"<manifest>\n" + manifest + "</manifest>\n"
+		"<spine" + std::string(aToc ? " toc=\"ncx\"" : "") + ">\n" + spine + "</spine>\n"
+		"</package>\n");
+
+	for (std::size_t i = 0; i < aChapters; ++i)
+		zip.add("OEBPS/chapter" + std::to_string(i + 1) + ".xhtml", generate_xhtml(aWords, i + 1));
+
+	return zip.finish();
+}
+
+// Create a 16-bit mono PCM WAV file containing aSamples.
+inline std::string make_wav(const std::vector<int16_t> &aSamples, uint32_t aFrequency = 16000)
+{
+	uint32_t size = aSamples.size() * 2;
+
+	std::string wav;
+	wav.reserve(44 + size);
+	auto u16 = [&wav](uint16_t value) { wav += (char)(value & 0xFF); wav += (char)(value >> 8); };
+	auto u32 = [&u16](uint32_t value) { u16(value & 0xFFFF); u16(value >> 16); };
+
+	wav += "RIFF"; u32(36 + size); wav += "WAVE";
+	wav += "fmt "; u32(16);
+	u16(1);              // PCM
+	u16(1);              // channels
+	u32(aFrequency);
+	u32(aFrequency * 2); // bytes per second
+	u16(2);              // bytes per sample
+	u16(16);             // bits per sample
+	wav += "data"; u32(size);
+	for (int16_t sample : aSamples)
+		u16(sample);
+	return wav;
+}
+
+#endif
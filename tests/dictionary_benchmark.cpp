@@ -0,0 +1,157 @@
+/* Pronunciation dictionary benchmarks.
+ *
+ * Copyright (C) 2015 Reece H. Dunn
+ *
+ * This file is part of cainteoir-engine.
+ *
+ * cainteoir-engine is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * cainteoir-engine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cainteoir-engine.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "compatibility.hpp"
+
+#include <cainteoir/dictionary.hpp>
+#include <unistd.h>
+#include <vector>
+
+#include "benchmark.hpp"
+
+namespace tts = cainteoir::tts;
+namespace ipa = cainteoir::ipa;
+
+REGISTER_BENCHMARKSUITE("dictionary");
+
+static volatile size_t matches;
+
+// Generate a dictionary containing aCount words with IPA pronunciations.
+static std::vector<std::string>
+generate_dictionary(const char *aPath, int aCount)
+{
+	static const char letters[] = "abdefhijklmnopstuvwz";
+
+	std::vector<std::string> words;
+	FILE *f = fopen(aPath, "wb");
+	if (!f) throw std::runtime_error("unable to create the dictionary");
+
+	fprintf(f, ".phonemeset\tipa\n\n");
+	srand(0);
+	for (int i = 0; i < aCount; ++i)
+	{
+		std::string word;
+		int length = 3 + (rand() % 8);
+		for (int j = 0; j < length; ++j)
+			word.push_back(letters[rand() % (sizeof(letters) - 1)]);
+		word += std::to_string(i); // make the word unique
+		fprintf(f, "%s\t/ˈ%s/\n", word.c_str(), word.substr(0, length).c_str());
+		words.push_back(word);
+	}
+
+	fclose(f);
+	return words;
+}
+
+BENCHMARK("dictionary lookup")
+{
+	char dict_path[] = "/tmp/cainteoir-dict-XXXXXX";
+	char ddb_path[] = "/tmp/cainteoir-ddb-XXXXXX";
+	close(mkstemp(dict_path));
+	close(mkstemp(ddb_path));
+
+	for (int count : { 1000, 10000, 100000 })
+	{
+		auto words = generate_dictionary(dict_path, count);
+
+		std::vector<std::shared_ptr<cainteoir::buffer>> keys;
+		for (const auto &word : words)
+		{
+			keys.push_back(cainteoir::make_buffer(word.c_str(), word.size()));
+			keys.push_back(cainteoir::make_buffer((word + "x").c_str(), word.size() + 1)); // miss
+		}
+
+		tts::dictionary dict;
+		auto reader = tts::createDictionaryReader(dict_path);
+		while (reader->read())
+			dict.add_entry(reader->word, reader->entry);
+
+		FILE *out = fopen(ddb_path, "wb");
+		tts::compile_dictionary(dict_path, out);
+		fclose(out);
+
+		tts::compiled_dictionary compiled{ cainteoir::make_file_buffer(ddb_path) };
+
+		size_t hits = 0;
+		for (const auto &key : keys)
+		{
+			bool dict_match = dict.lookup(key).type() != cainteoir::object_type::null;
+			bool compiled_match = compiled.lookup(*key).type != tts::compiled_dictionary::entry_type::no_match;
+			if (dict_match != compiled_match)
+				throw std::runtime_error("dictionary and compiled_dictionary lookups do not match");
+			hits += dict_match;
+		}
+		if (hits != words.size())
+			throw std::runtime_error("dictionary lookups do not match the generated words");
+
+		printf("  %d words\n", count);
+
+		measure("dictionary::lookup", "lookups", keys.size(), [&]() {
+			size_t matched = 0;
+			for (const auto &key : keys)
+				matched += dict.lookup(key).type() != cainteoir::object_type::null;
+			matches = matched;
+		});
+
+		measure("compiled_dictionary::lookup", "lookups", keys.size(), [&]() {
+			size_t matched = 0;
+			for (const auto &key : keys)
+				matched += compiled.lookup(*key).type != tts::compiled_dictionary::entry_type::no_match;
+			matches = matched;
+		});
+
+		measure("dictionary::pronounce", "words", keys.size() / 2, [&]() {
+			ipa::phonemes phonemes;
+			for (size_t i = 0; i < keys.size(); i += 2)
+			{
+				phonemes.clear();
+				dict.pronounce(keys[i], {}, phonemes);
+			}
+			matches = phonemes.size();
+		});
+
+		measure("compiled_dictionary::pronounce", "words", keys.size() / 2, [&]() {
+			ipa::phonemes phonemes;
+			for (size_t i = 0; i < keys.size(); i += 2)
+			{
+				phonemes.clear();
+				compiled.pronounce(keys[i], {}, phonemes);
+			}
+			matches = phonemes.size();
+		});
+
+		measure("createDictionaryReader (dict)", "words", count, [&]() {
+			tts::dictionary d;
+			auto reader = tts::createDictionaryReader(dict_path);
+			while (reader->read())
+				d.add_entry(reader->word, reader->entry);
+			matches = d.size();
+		});
+
+		measure("compiled_dictionary (load)", "words", count, [&]() {
+			tts::compiled_dictionary d{ cainteoir::make_file_buffer(ddb_path) };
+			matches = d.size();
+		});
+	}
+
+	unlink(dict_path);
+	unlink(ddb_path);
+}
@@ -0,0 +1,183 @@
+/* Document model benchmarks.
+ *
+ * Copyright (C) 2015 Reece H. Dunn
+ *
+ * This file is part of cainteoir-engine.
+ *
+ * cainteoir-engine is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * cainteoir-engine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cainteoir-engine.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "compatibility.hpp"
+
+#include <cainteoir/document.hpp>
+#include <vector>
+
+#include "benchmark.hpp"
+#include "corpus.hpp"
+
+namespace rdf = cainteoir::rdf;
+
+REGISTER_BENCHMARKSUITE("document");
+
+static volatile size_t matches;
+
+static std::shared_ptr<cainteoir::document>
+load_document(std::shared_ptr<cainteoir::buffer> aData, rdf::graph &aMetadata)
+{
+	rdf::uri subject{ "benchmark.epub", std::string() };
+	auto reader = cainteoir::createDocumentReader(aData, subject, aMetadata);
+	if (!reader)
+		throw std::runtime_error("unable to read the generated epub document");
+	return std::make_shared<cainteoir::document>(reader, aMetadata);
+}
+
+BENCHMARK("document (generated epub)")
+{
+	auto data = generate_epub(50, 5000);
+
+	rdf::graph metadata;
+	auto doc = load_document(data, metadata);
+	size_t items = doc->size();
+
+	std::vector<rdf::uri> anchors;
+	for (auto &item : doc->children())
+	{
+		if (item.type & cainteoir::events::anchor)
+			anchors.push_back(item.anchor);
+	}
+	printf("  50 chapters, %d items, %d anchors\n", (int)items, (int)anchors.size());
+
+	measure("document (first item)", "documents", 1, [&]() {
+		rdf::graph m;
+		auto d = load_document(data, m);
+		matches = d->children().begin()->type;
+	});
+
+	measure("document (all items)", "items", items, [&]() {
+		rdf::graph m;
+		auto d = load_document(data, m);
+		matches = d->size();
+	});
+
+	for (unsigned int threads : { 2, 4 })
+	{
+		cainteoir::setDocumentParserThreads(threads);
+		char name[64];
+		snprintf(name, sizeof(name), "document (all items, %d parser threads)", threads);
+		measure(name, "items", items, [&]() {
+			rdf::graph m;
+			auto d = load_document(data, m);
+			matches = d->size();
+		});
+	}
+	cainteoir::setDocumentParserThreads(1);
+
+	// Short chapters, where the per-document setup of the HTML reader
+	// dominates the time spent parsing the document.
+	auto short_data = generate_epub(300, 50);
+	rdf::graph short_metadata;
+	size_t short_items = load_document(short_data, short_metadata)->size();
+	printf("  300 chapters, %d items\n", (int)short_items);
+
+	measure("document (all items, 300 short chapters)", "items", short_items, [&]() {
+		rdf::graph m;
+		auto d = load_document(short_data, m);
+		matches = d->size();
+	});
+
+	measure("document::children (anchors)", "lookups", anchors.size(), [&]() {
+		size_t n = 0;
+		for (size_t i = 0; i != anchors.size(); ++i)
+		{
+			auto range = doc->children({ anchors[i], anchors[anchors.size() - i - 1] });
+			n += range.begin().index();
+		}
+		matches = n;
+	});
+
+	measure("document::at", "items", items, [&]() {
+		size_t n = 0;
+		corpus_random random;
+		for (size_t i = 0; i != items; ++i)
+			n += doc->at(random(items))->type;
+		matches = n;
+	});
+}
+
+BENCHMARK("document reader (generated text)")
+{
+	std::string text = generate_text(5000000);
+	auto data = cainteoir::make_buffer(text.c_str(), text.size());
+	rdf::uri subject{ "benchmark.txt", std::string() };
+	printf("  %d bytes\n", (int)text.size());
+
+	measure("reader (first text event)", "documents", 1, [&]() {
+		rdf::graph m;
+		auto reader = cainteoir::createDocumentReader(data, subject, m);
+		while (reader->read() && !(reader->type & cainteoir::events::text))
+			;
+		matches = reader->content->size();
+	});
+
+	measure("reader (all text events)", "MB", text.size() / 1000000.0, [&]() {
+		rdf::graph m;
+		auto reader = cainteoir::createDocumentReader(data, subject, m);
+		size_t n = 0;
+		while (reader->read())
+			++n;
+		matches = n;
+	});
+}
+
+BENCHMARK("document reader (per format)")
+{
+	struct format_data
+	{
+		const char *name;
+		const char *filename;
+		std::shared_ptr<cainteoir::buffer> data;
+	};
+
+	std::string text = generate_text(500000);
+	std::string xhtml = generate_xhtml(500000);
+	std::string rtf = generate_rtf(500000);
+	format_data formats[] =
+	{
+		{ "reader (plain text)", "benchmark.txt",   cainteoir::make_buffer(text.c_str(), text.size()) },
+		{ "reader (xhtml)",      "benchmark.xhtml", cainteoir::make_buffer(xhtml.c_str(), xhtml.size()) },
+		{ "reader (rtf)",        "benchmark.rtf",   cainteoir::make_buffer(rtf.c_str(), rtf.size()) },
+		{ "reader (epub)",       "benchmark.epub",  generate_epub(50, 10000) },
+	};
+
+	for (auto &format : formats)
+	{
+		rdf::uri subject{ format.filename, std::string() };
+		{
+			rdf::graph m;
+			if (!cainteoir::createDocumentReader(format.data, subject, m))
+				throw std::runtime_error(std::string("unable to read the generated ") + format.filename + " document");
+		}
+
+		printf("  %s (%d bytes)\n", format.filename, (int)format.data->size());
+		measure(format.name, "MB", format.data->size() / 1000000.0, [&]() {
+			rdf::graph m;
+			auto reader = cainteoir::createDocumentReader(format.data, subject, m);
+			size_t n = 0;
+			while (reader->read())
+				++n;
+			matches = n;
+		});
+	}
+}
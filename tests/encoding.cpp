@@ -244,3 +244,34 @@ TEST_CASE("decoding a US-ASCII buffer (no conversion)")
 	e.decode(data, ret);
 	match(ret.buffer(), "This is a test string!");
 }
+
+TEST_CASE("decoding a buffer to a string")
+{
+	cainteoir::encoding e(1252);
+	std::string ret = "> ";
+	e.decode(cainteoir::buffer("\x93x, y, \x85\x94"), ret);
+	assert(ret == "> \xE2\x80\x9Cx, y, \xE2\x80\xA6\xE2\x80\x9D");
+}
+
+TEST_CASE("decoding a buffer with undefined characters")
+{
+	cainteoir::encoding e(1252);
+	auto data = std::make_shared<cainteoir::buffer>("a\x81z");
+	match(e.decode(data), "az");
+
+	std::string ret;
+	e.decode(*data, ret);
+	assert(ret == "az");
+}
+
+TEST_CASE("decoding a utf-16le buffer")
+{
+	static const char utf16[] = "\x1C\x20x\0,\0 \0\xC1\x00";
+	cainteoir::encoding e("utf-16le");
+	auto data = std::make_shared<cainteoir::buffer>(utf16, utf16 + sizeof(utf16) - 1);
+	match(e.decode(data), "\xE2\x80\x9Cx, \xC3\x81");
+
+	std::string ret;
+	e.decode(*data, ret);
+	assert(ret == "\xE2\x80\x9Cx, \xC3\x81");
+}
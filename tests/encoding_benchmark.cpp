@@ -0,0 +1,103 @@
+/* Character encoding benchmarks.
+ *
+ * Copyright (C) 2015 Reece H. Dunn
+ *
+ * This file is part of cainteoir-engine.
+ *
+ * cainteoir-engine is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * cainteoir-engine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cainteoir-engine.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "compatibility.hpp"
+
+#include <cainteoir/encoding.hpp>
+
+#include "benchmark.hpp"
+#include "corpus.hpp"
+
+REGISTER_BENCHMARKSUITE("encoding");
+
+static volatile size_t matches;
+
+// The generated text with the non-ASCII characters replaced by bytes in the
+// upper half of a single-byte character set.
+static std::string generate_single_byte_text(std::size_t aWords)
+{
+	corpus_random random;
+	std::string text = generate_text(aWords);
+	for (auto &c : text)
+	{
+		if ((uint8_t)c >= 0x80)
+			c = 0xA0 + random(0x60);
+	}
+	return text;
+}
+
+static std::string generate_utf16_text(std::size_t aWords)
+{
+	std::string text = generate_single_byte_text(aWords);
+	std::string utf16;
+	utf16.reserve(text.size() * 2);
+	for (auto c : text)
+	{
+		utf16 += c;
+		utf16 += '\0';
+	}
+	return utf16;
+}
+
+static void measure_decode(const char *aEncoding, const std::string &aText)
+{
+	cainteoir::encoding encoding(aEncoding);
+	auto data = std::make_shared<cainteoir::buffer>(aText.c_str(), aText.c_str() + aText.size());
+	char name[64];
+
+	snprintf(name, sizeof(name), "decode (%s)", aEncoding);
+	measure(name, "MB", aText.size() / 1000000.0, [&]() {
+		matches = encoding.decode(data)->size();
+	});
+}
+
+BENCHMARK("decoding single-byte character sets")
+{
+	std::string text = generate_single_byte_text(500000);
+	printf("  %d bytes\n", (int)text.size());
+
+	measure_decode("windows-1252", text);
+	measure_decode("windows-1251", text);
+	measure_decode("iso-8859-2", text);
+	measure_decode("cp437", text);
+}
+
+BENCHMARK("decoding multi-byte character sets")
+{
+	std::string text = generate_utf16_text(500000);
+	printf("  %d bytes\n", (int)text.size());
+
+	measure_decode("utf-16le", text);
+}
+
+BENCHMARK("looking up single-byte characters")
+{
+	cainteoir::encoding encoding("windows-1252");
+	measure("encoding::lookup", "characters", 25600, [&]() {
+		size_t n = 0;
+		for (int i = 0; i != 100; ++i)
+		{
+			for (int c = 0; c != 256; ++c)
+				n += encoding.lookup(c)->size();
+		}
+		matches = n;
+	});
+}
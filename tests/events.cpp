@@ -123,6 +123,7 @@ void format_style(const css::styles &styles)
 void print_navigation(const rdf::graph &metadata, const cainteoir::document &doc, const rdf::uri &subject)
 {
 	const rdf::uri type = rdf::epv("toc");
+	doc.size(); // read the document to get the table of contents
 	for (const auto &entry : cainteoir::navigation(metadata, subject, type))
 	{
 		fprintf(stdout, "[%s]%s level=%d target=[%s]%s title=\"\"\"%s\"\"\" index=%zd\n",
@@ -187,12 +188,15 @@ int main(int argc, char ** argv)
 	{
 		bool document_object = false;
 		bool show_navigation = false;
+		int parser_threads = 1;
 
 		const option_group general_options = { nullptr, {
 			{ 'm', "document-object", bind_value(document_object, true),
 			  i18n("Process events through a cainteoir::document object model") },
 			{ 'n', "show-navigation", bind_value(show_navigation, true),
 			  i18n("Print the navigation structure, not document content") },
+			{ 'j', "parser-threads", parser_threads, "THREADS",
+			  i18n("Parse the content documents on THREADS worker threads") },
 		}};
 
 		const std::initializer_list<const char *> usage = {
@@ -207,6 +211,8 @@ int main(int argc, char ** argv)
 		if (!parse_command_line(options, usage, argc, argv))
 			return 0;
 
+		cainteoir::setDocumentParserThreads(parser_threads);
+
 		rdf::graph metadata;
 		const char *filename = (argc == 1) ? argv[0] : nullptr;
 		rdf::uri subject(filename ? filename : std::string(), std::string());
@@ -336,6 +336,14 @@ if __name__ == '__main__':
 			{'test': 'epub2/file-in-subdir.epub', 'result': 'epub2/file-in-subdir.events'},
 			{'test': 'epub2/escaped-space.epub', 'result': 'epub2/escaped-space.events'},
 		]},
+		{'name': 'packaging (parallel)', 'type': 'events', 'args': ['--parser-threads=4'], 'tests': [
+			{'test': 'epub2/simple.epub', 'result': 'epub2/simple.events'},
+			{'test': 'epub2/mimetype/newline-at-end.epub', 'result': 'epub2/simple.events'},
+			{'test': 'epub2/mimetype-at-end.epub', 'result': 'epub2/simple.events'},
+			{'test': 'epub2/missing.epub', 'result': 'epub2/missing.events'},
+			{'test': 'epub2/file-in-subdir.epub', 'result': 'epub2/file-in-subdir.events'},
+			{'test': 'epub2/escaped-space.epub', 'result': 'epub2/escaped-space.events'},
+		]},
 	]})
 	test.run({ 'name': 'ePub3', 'groups': [
 		{'name': 'media overlay', 'type': 'events', 'tests': [
@@ -346,10 +354,21 @@ if __name__ == '__main__':
 			{'test': 'epub3/media-overlay/multiple-files/spanning.epub', 'result': 'epub3/media-overlay/multiple-files/multiple.events'},
 			{'test': 'epub3/media-overlay/multiple-files/spanning-different-id.epub', 'result': 'epub3/media-overlay/multiple-files/multiple.events'},
 		]},
+		{'name': 'media overlay (parallel)', 'type': 'events', 'args': ['--parser-threads=4'], 'tests': [
+			{'test': 'epub3/media-overlay/single-file/xhtml-before-smil.epub', 'result': 'epub3/media-overlay/single-file/xhtml-before-smil.events'},
+			{'test': 'epub3/media-overlay/single-file/xhtml-after-smil.epub', 'result': 'epub3/media-overlay/single-file/xhtml-before-smil.events'},
+			{'test': 'epub3/media-overlay/single-file/text-but-no-audio.epub', 'result': 'epub3/media-overlay/single-file/text-but-no-audio.events'},
+			{'test': 'epub3/media-overlay/multiple-files/multiple.epub', 'result': 'epub3/media-overlay/multiple-files/multiple.events'},
+			{'test': 'epub3/media-overlay/multiple-files/spanning.epub', 'result': 'epub3/media-overlay/multiple-files/multiple.events'},
+			{'test': 'epub3/media-overlay/multiple-files/spanning-different-id.epub', 'result': 'epub3/media-overlay/multiple-files/multiple.events'},
+		]},
 		{'name': 'toc navigation', 'type': 'events', 'tests': [
 			{'test': 'epub3/nav-toc/linear.epub', 'result': 'epub3/nav-toc/linear.events'},
 			{'test': 'epub3/nav-toc/nested.epub', 'result': 'epub3/nav-toc/nested.events'},
 		]},
+		{'name': 'toc navigation targets', 'type': 'navigation', 'tests': [
+			{'test': 'epub3/nav-toc/duplicate-anchor.epub', 'result': 'epub3/nav-toc/duplicate-anchor.navigation'},
+		]},
 	]})
 	test.run({ 'name': 'ZIP', 'groups': [
 		{'name': 'files', 'type': 'events', 'tests': [
@@ -360,10 +379,23 @@ if __name__ == '__main__':
 			{'test': 'zip/single-file-in-dir.zip', 'result': 'zip/single-file-in-dir.events'},
 			{'test': 'zip/single-file-in-dir-asdirectory.zip', 'result': 'zip/single-file-in-dir.events'},
 		]},
+		{'name': 'corrupt', 'type': 'events', 'tests': [
+			{'test': 'zip/corrupt/compression-type.zip', 'result': 'zip/corrupt/unsupported-compression.events'},
+			{'test': 'zip/corrupt/compressed-size.zip', 'result': 'zip/corrupt/outside-archive.events'},
+			{'test': 'zip/corrupt/filename-length.zip', 'result': 'zip/corrupt/outside-archive.events'},
+		]},
+	]})
+	test.run({'name': 'Plain Text', 'groups': [
+		{'name': 'text', 'type': 'events', 'tests': [
+			{'test': 'text/simple.txt', 'result': 'text/simple.events'},
+			{'test': 'text/paragraphs.txt', 'result': 'text/paragraphs.events'},
+		]},
 	]})
 	test.run({'name': 'Compressed', 'groups': [
 		{'name': 'compression', 'type': 'events', 'tests': [
 			{'test': 'html/tree-construction/simple.html.gz', 'result': 'html/tree-construction/simple.events'},
+			{'test': 'text/simple.txt.gz', 'result': 'text/simple.events'},
+			{'test': 'text/paragraphs.txt.gz', 'result': 'text/paragraphs.events'},
 			{'test': 'html/tree-construction/simple.html.bz2', 'result': 'html/tree-construction/simple.events', 'expect': 'fail'},
 			{'test': 'html/tree-construction/simple.html.lzma', 'result': 'html/tree-construction/simple.events', 'expect': 'fail'},
 		]},
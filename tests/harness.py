@@ -19,6 +19,7 @@
 
 import os
 import sys
+import struct
 import difflib
 import zipfile
 
@@ -43,7 +44,35 @@ def match_file_times(srcfile, dstfile):
 	stat = os.stat(srcfile)
 	os.utime(dstfile, (stat.st_atime, stat.st_mtime))
 
+# The (local header, central directory header, struct format) offsets of the
+# zip header fields that can be corrupted.
+zip_header_fields = {
+	'compression':     (8,  10, '<H'),
+	'compressed-size': (18, 20, '<I'),
+	'filename-length': (26, None, '<H'),
+}
+
+def corrupt_archive(filename, dstfile, corruption):
+	field, value = corruption.split('=')
+	local_offset, central_offset, fmt = zip_header_fields[field]
+	with open(filename, 'rb') as f:
+		data = bytearray(f.read())
+	zf = zipfile.ZipFile(filename)
+	header = zf.getinfo(dstfile).header_offset
+	zf.close()
+	struct.pack_into(fmt, data, header + local_offset, int(value, 0))
+	if central_offset is not None:
+		header = data.find(b'PK\x01\x02')
+		while header != -1:
+			length = struct.unpack_from('<H', data, header + 28)[0]
+			if data[header + 46:header + 46 + length] == dstfile.encode('utf-8'):
+				struct.pack_into(fmt, data, header + central_offset, int(value, 0))
+			header = data.find(b'PK\x01\x02', header + 1)
+	with open(filename, 'wb') as f:
+		f.write(data)
+
 def create_archive(filename):
+	corruptions = []
 	zf = zipfile.ZipFile(filename, mode='w', compression=zipfile.ZIP_STORED)
 	with open('%s.archive' % filename) as f:
 		for line in f.read().split('\n'):
@@ -65,9 +94,13 @@ def create_archive(filename):
 			elif kind == 'deflate':
 				path = os.path.join(sys.path[0], srcfile)
 				zf.write(path, dstfile, compress_type=zipfile.ZIP_DEFLATED)
+			elif kind == 'corrupt':
+				corruptions.append((dstfile, srcfile))
 			else:
 				raise Exception('Unsupported compression type %s for %s' % (kind, filename))
 	zf.close()
+	for dstfile, corruption in corruptions:
+		corrupt_archive(filename, dstfile, corruption)
 	match_file_times('%s.archive' % filename, filename)
 
 def gzip_compress(filename):
@@ -145,8 +178,11 @@ class MetadataCommand(Command):
 		]
 
 class EventsCommand(Command):
-	def __init__(self):
-		Command.__init__(self, 'events')
+	def __init__(self, show_navigation=False):
+		if show_navigation:
+			Command.__init__(self, 'events --show-navigation')
+		else:
+			Command.__init__(self, 'events')
 
 	def replacements(self, filename):
 		# NOTE: The %EMPTY% marker is to differentiate actual empty URIs from URIs
@@ -238,6 +274,8 @@ def create_command(test_type):
 		return PhonemeSetCommand()
 	if test_type == 'events':
 		return EventsCommand()
+	if test_type == 'navigation':
+		return EventsCommand(show_navigation=True)
 	if test_type in ['styles', 'xmlreader']:
 		return Command(test_type)
 	if test_type == 'htmlreader':
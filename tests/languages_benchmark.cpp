@@ -0,0 +1,94 @@
+/* Language tag benchmarks.
+ *
+ * Copyright (C) 2015 Reece H. Dunn
+ *
+ * This file is part of cainteoir-engine.
+ *
+ * cainteoir-engine is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * cainteoir-engine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cainteoir-engine.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "compatibility.hpp"
+
+#include <cainteoir/locale.hpp>
+#include <cainteoir/buffer.hpp>
+#include <cainteoir/path.hpp>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+#include "benchmark.hpp"
+
+namespace lang = cainteoir::language;
+
+REGISTER_BENCHMARKSUITE("languages");
+
+static volatile size_t matches;
+
+static const char *language_tags[] = {
+	"en", "en-GB", "en-US", "es-MX", "es-419", "fr-CA", "de-CH", "pt-BR",
+	"zh-cmn", "zh-Hant-TW", "cmn", "yue", "sr-Latn", "sga-Ogam", "ja-Latn",
+	"i-klingon", "en@shaw", "en-rGB", "x-foo", "ar-aao",
+};
+
+// Run aFn in a new process, so the language data is loaded by the first call
+// to aFn as it is when an application starts.
+template <typename Function>
+static void in_new_process(Function aFn)
+{
+	pid_t pid = fork();
+	if (pid == 0)
+	{
+		aFn();
+		_exit(0);
+	}
+	int status = 0;
+	waitpid(pid, &status, 0);
+}
+
+BENCHMARK("language subtag registry")
+{
+	auto registry = cainteoir::get_data_path() / "languages.rdf.gz";
+
+	measure("compile_subtag_registry (languages.rdf.gz)", "registries", 1, [&]() {
+		cainteoir::memory_file out;
+		lang::compile_subtag_registry(registry, out);
+		matches = out.buffer()->size();
+	});
+
+	measure("make_lang (first call in a new process)", "processes", 1, []() {
+		in_new_process([]() { matches = lang::make_lang("zh-cmn").extlang.size(); });
+	});
+
+	measure("make_lang", "tags", 100 * sizeof(language_tags) / sizeof(language_tags[0]), []() {
+		size_t n = 0;
+		for (int i = 0; i != 100; ++i)
+		{
+			for (const char *tag : language_tags)
+				n += lang::make_lang(tag).lang.size();
+		}
+		matches = n;
+	});
+
+	cainteoir::languages names;
+	measure("languages::operator()", "tags", 100 * sizeof(language_tags) / sizeof(language_tags[0]), [&]() {
+		size_t n = 0;
+		for (int i = 0; i != 100; ++i)
+		{
+			for (const char *tag : language_tags)
+				n += names(tag).size();
+		}
+		matches = n;
+	});
+}
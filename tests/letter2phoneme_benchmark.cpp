@@ -0,0 +1,138 @@
+/* Letter-to-phoneme rule benchmarks.
+ *
+ * Copyright (C) 2015 Reece H. Dunn
+ *
+ * This file is part of cainteoir-engine.
+ *
+ * cainteoir-engine is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * cainteoir-engine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cainteoir-engine.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "compatibility.hpp"
+
+#include <cainteoir/language.hpp>
+#include <unistd.h>
+#include <fstream>
+#include <vector>
+
+#include "benchmark.hpp"
+#include "corpus.hpp"
+
+namespace tts = cainteoir::tts;
+
+REGISTER_BENCHMARKSUITE("letter2phoneme");
+
+struct ruleset_data
+{
+	const char *ruleset;
+	const char *locale;
+	const char *words[3];
+};
+
+static const ruleset_data rulesets[] =
+{
+	{ "tests/letter2phoneme/context.langdef",   "en", { "tests/letter2phoneme/context.txt", "tests/letter2phoneme/right.txt", "tests/letter2phoneme/left.txt" } },
+	{ "tests/letter2phoneme/cantonese.langdef", "en", { "tests/letter2phoneme/cantonese.txt", nullptr, nullptr } },
+	{ "tests/letter2phoneme/mandarin.langdef",  "en", { "tests/letter2phoneme/mandarin.txt", nullptr, nullptr } },
+	{ "tests/letter2phoneme/japanese.langdef",  "en", { "tests/letter2phoneme/japanese.txt", nullptr, nullptr } },
+};
+
+static volatile size_t matches;
+
+static bool pronounce(const std::shared_ptr<tts::phoneme_reader> &aRules, const std::string &aWord)
+{
+	try
+	{
+		aRules->reset(cainteoir::make_buffer(aWord.c_str(), aWord.size()));
+		while (aRules->read())
+			;
+		return true;
+	}
+	catch (const tts::phoneme_error &)
+	{
+		return false;
+	}
+}
+
+// Generate aCount words from the words in the test files by joining 1-3 words
+// together, keeping the words that the ruleset can pronounce.
+static std::vector<std::shared_ptr<cainteoir::buffer>>
+generate_words(const std::shared_ptr<tts::phoneme_reader> &aRules,
+               const char * const *aTestFiles,
+               std::size_t aCount)
+{
+	std::vector<std::string> base;
+	for (const char * const *filename = aTestFiles; filename != aTestFiles + 3 && *filename; ++filename)
+	{
+		std::ifstream is(*filename);
+		std::string line;
+		while (std::getline(is, line))
+		{
+			if (!line.empty() && pronounce(aRules, line))
+				base.push_back(line);
+		}
+	}
+	if (base.empty())
+		throw std::runtime_error("no words to pronounce in the test files");
+
+	corpus_random random;
+	std::vector<std::shared_ptr<cainteoir::buffer>> words;
+	while (words.size() != aCount)
+	{
+		std::string word = base[random(base.size())];
+		for (uint32_t n = random(3); n != 0; --n)
+			word += base[random(base.size())];
+		if (pronounce(aRules, word))
+			words.push_back(cainteoir::make_buffer(word.c_str(), word.size()));
+	}
+	return words;
+}
+
+BENCHMARK("letter-to-phoneme rules")
+{
+	char ldb_path[] = "/tmp/cainteoir-ldb-XXXXXX";
+	close(mkstemp(ldb_path));
+
+	for (const auto &data : rulesets)
+	{
+		FILE *out = fopen(ldb_path, "wb");
+		tts::compile_language(data.ruleset, out);
+		fclose(out);
+
+		auto locale = cainteoir::language::make_lang(data.locale);
+		auto rules = tts::createPronunciationRules(ldb_path, locale);
+		if (!rules)
+			throw std::runtime_error("unable to load the ruleset");
+
+		auto words = generate_words(rules, data.words, 10000);
+		printf("  %s (%d words)\n", data.ruleset, (int)words.size());
+
+		measure("createPronunciationRules", "rulesets", 1, [&]() {
+			matches = tts::createPronunciationRules(ldb_path, locale) ? 1 : 0;
+		});
+
+		measure("phoneme_reader::read", "words", words.size(), [&]() {
+			size_t phonemes = 0;
+			for (const auto &word : words)
+			{
+				rules->reset(word);
+				while (rules->read())
+					++phonemes;
+			}
+			matches = phonemes;
+		});
+	}
+
+	unlink(ldb_path);
+}
@@ -0,0 +1,322 @@
+/* Test for the PSOLA voice compiler and synthesizer.
+ *
+ * Copyright (C) 2015 Reece H. Dunn
+ *
+ * This file is part of cainteoir-engine.
+ *
+ * cainteoir-engine is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * cainteoir-engine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cainteoir-engine.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "compatibility.hpp"
+
+#include "../src/libcainteoir/synthesizer/synth.hpp"
+#include <cstdio>
+#include <unistd.h>
+
+#include "tester.hpp"
+
+namespace tts = cainteoir::tts;
+namespace rdf = cainteoir::rdf;
+namespace css = cainteoir::css;
+
+REGISTER_TESTSUITE("psola");
+
+// The tests/psola voice has the units:
+//   a -- a 160Hz pulse train, with the pulse peaks at samples 20, 120, ... 1520;
+//   s -- noise.
+// Both units are 100ms of 16kHz audio.
+
+#define VOICE_FREQUENCY 16000
+
+struct unit_audio
+{
+	std::string name;
+	const int16_t *samples;
+	uint32_t num_samples;
+	uint32_t samples_offset;
+	const uint32_t *marks;
+	uint32_t num_marks;
+	uint32_t marks_offset;
+};
+
+struct voice_data
+{
+	std::shared_ptr<cainteoir::buffer> data;
+	std::vector<tts::unit_t> units;
+	cainteoir::range<const tts::phoneme_units *> phonemes;
+	std::vector<unit_audio> audio;
+
+	voice_data() : phonemes(nullptr, nullptr) {}
+};
+
+struct compiled_voice
+{
+	compiled_voice(const char *aVoiceDef)
+	{
+		strcpy(path, "/tmp/cainteoir-psola-XXXXXX");
+		int fd = mkstemp(path);
+		if (fd == -1)
+			throw std::runtime_error("unable to create the voice file");
+
+		try
+		{
+			std::shared_ptr<FILE> out(fdopen(fd, "wb"), fclose);
+			tts::compile_voice(aVoiceDef, out.get());
+		}
+		catch (...)
+		{
+			unlink(path);
+			throw;
+		}
+	}
+
+	~compiled_voice()
+	{
+		unlink(path);
+	}
+
+	char path[64];
+};
+
+static voice_data read_voice(const char *aPath)
+{
+	voice_data voice;
+	voice.data = cainteoir::make_file_buffer(aPath);
+
+	cainteoir::native_endian_buffer data(voice.data);
+	data.seek(tts::VOICEDB_HEADER_SIZE);
+	while (!data.eof()) switch (data.magic())
+	{
+	case tts::STRING_TABLE_MAGIC:
+		data.seek(data.u32());
+		break;
+	case tts::DURATION_TABLE_MAGIC:
+		tts::createDurationModel(data, voice.data);
+		break;
+	case tts::PHONEME_UNIT_TABLE_MAGIC:
+		tts::read_phoneme_units(data, voice.units);
+		break;
+	case tts::PHONEME_TABLE_MAGIC:
+		voice.phonemes = data.array<tts::phoneme_units>();
+		break;
+	case tts::PITCH_DATA_MAGIC:
+		data.f16_16();
+		data.f16_16();
+		data.f16_16();
+		break;
+	case tts::UNIT_AUDIO_TABLE_MAGIC:
+		{
+			uint16_t n = data.u16();
+			uint32_t data_size = data.u32();
+			for (uint16_t i = 0; i != n; ++i)
+			{
+				unit_audio audio;
+				audio.name = data.pstr();
+				audio.samples_offset = data.u32();
+				audio.num_samples = data.u32();
+				audio.marks_offset = data.u32();
+				audio.num_marks = data.u32();
+				audio.samples = (const int16_t *)(voice.data->begin() + audio.samples_offset);
+				audio.marks = (const uint32_t *)(voice.data->begin() + audio.marks_offset);
+				voice.audio.push_back(audio);
+			}
+			data.seek(data.offset() + data_size);
+		}
+		break;
+	default:
+		throw std::runtime_error("unsupported section in PSOLA voice file");
+	}
+	return voice;
+}
+
+static std::shared_ptr<tts::voice>
+load_voice(const char *aPath, int aFrequency)
+{
+	rdf::graph metadata;
+	rdf::uri voice{ "http://reecedunn.co.uk/tts/synthesizer/psola#", "test" };
+	metadata.statement(voice, rdf::tts("data"), rdf::literal(aPath));
+	if (aFrequency != 0)
+		metadata.statement(voice, rdf::tts("frequency"), rdf::literal(aFrequency, rdf::tts("hertz")));
+	metadata.statement(voice, rdf::tts("volumeScale"), rdf::literal(1.0));
+	return tts::create_voice(metadata, &voice);
+}
+
+struct sample_counter : public cainteoir::audio
+{
+	sample_counter() : samples(0) {}
+
+	void open() {}
+
+	void close() {}
+
+	uint32_t write(const char *, uint32_t len)
+	{
+		samples += len / sizeof(short);
+		return len;
+	}
+
+	int channels() const { return 1; }
+
+	int frequency() const { return VOICE_FREQUENCY; }
+
+	const rdf::uri &format() const { return mFormat; }
+
+	size_t samples;
+private:
+	rdf::uri mFormat = rdf::tts("s16le");
+};
+
+static std::shared_ptr<tts::prosody_reader>
+prosody(const std::shared_ptr<tts::voice> &aVoice, const char *aPhonemes)
+{
+	auto phonemes = tts::createPhonemeReader("ipa");
+	phonemes->reset(cainteoir::make_buffer(aPhonemes, strlen(aPhonemes)));
+	return tts::createProsodyReader(phonemes, aVoice->durations(), aVoice->pitch_model(), tts::zero_distribution);
+}
+
+TEST_CASE("unit table")
+{
+	compiled_voice vdb("tests/psola/test.voicedef");
+	auto voice = read_voice(vdb.path);
+
+	assert(voice.units.size() == 4);
+	if (voice.units.size() == 4)
+	{
+		assert(std::string(voice.units[0].name) == "a");
+		assert(voice.units[0].phoneme_start == 0);
+		assert(voice.units[0].unit_start == 0);
+		assert(voice.units[0].unit_end == 100);
+
+		assert(std::string(voice.units[1].name) == "s");
+		assert(voice.units[1].phoneme_start == 0);
+		assert(voice.units[1].unit_start == 0);
+		assert(voice.units[1].unit_end == 100);
+
+		assert(std::string(voice.units[2].name) == "a");
+		assert(voice.units[2].phoneme_start == 0);
+		assert(voice.units[2].unit_start == 0);
+		assert(voice.units[2].unit_end == 50);
+
+		assert(std::string(voice.units[3].name) == "s");
+		assert(voice.units[3].phoneme_start == 50);
+		assert(voice.units[3].unit_start == 50);
+		assert(voice.units[3].unit_end == 100);
+	}
+
+	assert(voice.phonemes.size() == 3);
+	if (voice.phonemes.size() == 3)
+	{
+		const auto *phonemes = voice.phonemes.begin();
+		assert(phonemes[0].first_unit == 0);
+		assert(phonemes[0].num_units == 1);
+		assert(phonemes[1].first_unit == 1);
+		assert(phonemes[1].num_units == 1);
+		assert(phonemes[2].first_unit == 2);
+		assert(phonemes[2].num_units == 2);
+	}
+}
+
+TEST_CASE("unit audio table offsets")
+{
+	compiled_voice vdb("tests/psola/test.voicedef");
+	auto voice = read_voice(vdb.path);
+
+	assert(voice.audio.size() == 2);
+	if (voice.audio.size() != 2) return;
+
+	uint32_t end = voice.audio[0].marks_offset;
+	for (const auto &audio : voice.audio)
+	{
+		// The pitch marks are followed by the samples, and are aligned to 4 bytes.
+		assert((audio.marks_offset % 4) == 0);
+		assert(audio.marks_offset == end);
+		assert(audio.samples_offset == audio.marks_offset + audio.num_marks * sizeof(uint32_t));
+		end = audio.samples_offset + ((audio.num_samples + 1) / 2) * 4;
+		assert(end <= voice.data->size());
+	}
+
+	// The samples are the samples in the unit audio file.
+	auto a = cainteoir::make_file_buffer("tests/psola/a.wav");
+	assert(voice.audio[0].name == "a");
+	assert(voice.audio[0].num_samples == (a->size() - 44) / 2);
+	assert(memcmp(voice.audio[0].samples, a->begin() + 44, a->size() - 44) == 0);
+
+	auto s = cainteoir::make_file_buffer("tests/psola/s.wav");
+	assert(voice.audio[1].name == "s");
+	assert(voice.audio[1].num_samples == (s->size() - 44) / 2);
+	assert(memcmp(voice.audio[1].samples, s->begin() + 44, s->size() - 44) == 0);
+}
+
+TEST_CASE("pitch marks")
+{
+	compiled_voice vdb("tests/psola/test.voicedef");
+	auto voice = read_voice(vdb.path);
+
+	assert(voice.audio.size() == 2);
+	if (voice.audio.size() != 2) return;
+
+	// The voiced marks are on the peak of each pitch period.
+	const auto &a = voice.audio[0];
+	assert(a.num_marks == 16);
+	for (uint32_t i = 0; i != a.num_marks; ++i)
+		assert(a.marks[i] == ((20 + i * 100) | tts::PITCH_MARK_VOICED));
+
+	// The unvoiced marks are every 5ms.
+	const auto &s = voice.audio[1];
+	assert(s.num_marks == 20);
+	for (uint32_t i = 0; i != s.num_marks; ++i)
+		assert(s.marks[i] == i * 80);
+}
+
+TEST_CASE("synthesized audio length")
+{
+	compiled_voice vdb("tests/psola/test.voicedef");
+	auto voice = load_voice(vdb.path, VOICE_FREQUENCY);
+	assert(voice.get());
+	if (!voice) return;
+
+	const char *phonemes = "ɑsi sɑ";
+
+	css::time duration{ 0, css::time::seconds };
+	auto reader = prosody(voice, phonemes);
+	while (reader->read())
+		duration = { duration.value() + reader->first.duration.as(css::time::seconds).value(), css::time::seconds };
+	assert(duration.value() > 0.6);
+
+	auto synthesizer = voice->synthesizer();
+	synthesizer->bind(prosody(voice, phonemes));
+
+	sample_counter out;
+	while (synthesizer->synthesize(&out))
+		;
+
+	// The last pitch period can extend past the end of the last phoneme.
+	size_t samples = duration.value() * VOICE_FREQUENCY;
+	assert(out.samples >= samples);
+	assert(out.samples <= samples + VOICE_FREQUENCY / 50);
+}
+
+TEST_CASE("voice frequency")
+{
+	compiled_voice vdb("tests/psola/test.voicedef");
+
+	assert(load_voice(vdb.path, VOICE_FREQUENCY).get());
+	assert(load_voice(vdb.path, 500).get());
+	assert_throws(load_voice(vdb.path, 499), std::runtime_error, "the PSOLA voice frequency is too low");
+	assert_throws(load_voice(vdb.path, 0), std::runtime_error, "the PSOLA voice frequency is too low");
+
+	assert_throws(compiled_voice("tests/psola/low-frequency.voicedef"),
+	              std::runtime_error, "the voice frequency is too low for unit audio");
+}
@@ -0,0 +1,116 @@
+/* RDF graph benchmarks.
+ *
+ * Copyright (C) 2015 Reece H. Dunn
+ *
+ * This file is part of cainteoir-engine.
+ *
+ * cainteoir-engine is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * cainteoir-engine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cainteoir-engine.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "compatibility.hpp"
+
+#include <cainteoir/document.hpp>
+#include <vector>
+#include <set>
+
+#include "benchmark.hpp"
+#include "corpus.hpp"
+
+namespace rdf = cainteoir::rdf;
+namespace rql = cainteoir::rdf::query;
+
+REGISTER_BENCHMARKSUITE("rdf");
+
+static volatile size_t matches;
+
+BENCHMARK("rdf graph (generated epub metadata)")
+{
+	auto data = generate_epub(2000, 20, true);
+
+	rdf::graph metadata;
+	rdf::uri subject{ "benchmark.epub", std::string() };
+	auto reader = cainteoir::createDocumentReader(data, subject, metadata);
+	if (!reader)
+		throw std::runtime_error("unable to read the generated epub document");
+	cainteoir::document doc(reader, metadata);
+	doc.size(); // read the document to get the table of contents
+
+	// The graph statements as a list, so the queries are performed by
+	// scanning the statements instead of using the graph's indices.
+	rql::results statements(metadata.begin(), metadata.end());
+
+	std::vector<const rdf::uri *> subjects;
+	std::set<std::string> seen;
+	for (auto &statement : metadata)
+	{
+		if (seen.insert(rql::subject(statement).str()).second)
+			subjects.push_back(&rql::subject(statement));
+	}
+
+	printf("  2000 chapters, %d statements, %d subjects\n", (int)metadata.size(), (int)subjects.size());
+
+	measure("graph::statement", "statements", metadata.size(), [&]() {
+		rdf::graph g;
+		for (auto &statement : metadata)
+		{
+			const rdf::uri *object = dynamic_cast<const rdf::uri *>(statement->object.get());
+			if (object)
+				g.statement(statement->subject, statement->predicate, *object);
+			else
+				g.statement(statement->subject, statement->predicate, rql::literal(statement));
+		}
+		matches = g.size();
+	});
+
+	measure("select(subject) [graph]", "queries", subjects.size(), [&]() {
+		size_t n = 0;
+		for (auto s : subjects)
+			n += rql::select(metadata, rql::subject == *s).size();
+		matches = n;
+	});
+
+	measure("select(subject, predicate) [graph]", "queries", subjects.size(), [&]() {
+		size_t n = 0;
+		for (auto s : subjects)
+			n += rql::select(metadata, rql::subject == *s && rql::predicate == rdf::rdf("first")).size();
+		matches = n;
+	});
+
+	size_t scanned = std::min(subjects.size(), (size_t)100);
+	measure("select(subject, predicate) [scan]", "queries", scanned, [&]() {
+		size_t n = 0;
+		for (size_t i = 0; i != scanned; ++i)
+			n += rql::select(statements, rql::subject == *subjects[i] && rql::predicate == rdf::rdf("first")).size();
+		matches = n;
+	});
+
+	measure("select(predicate, object) [graph]", "queries", 1000, [&]() {
+		size_t n = 0;
+		for (size_t i = 0; i != 1000; ++i)
+			n += rql::select(metadata, rql::predicate == rdf::rdf("type") && rql::object == rdf::ref("Entry")).size();
+		matches = n;
+	});
+
+	measure("select(predicate, object) [scan]", "queries", 10, [&]() {
+		size_t n = 0;
+		for (size_t i = 0; i != 10; ++i)
+			n += rql::select(statements, rql::predicate == rdf::rdf("type") && rql::object == rdf::ref("Entry")).size();
+		matches = n;
+	});
+
+	measure("navigation (toc)", "listings", 1, [&]() {
+		matches = cainteoir::navigation(metadata, subject, rdf::epv("toc")).size();
+	});
+}
@@ -0,0 +1,84 @@
+/* Signal processing benchmarks.
+ *
+ * Copyright (C) 2015 Reece H. Dunn
+ *
+ * This file is part of cainteoir-engine.
+ *
+ * cainteoir-engine is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * cainteoir-engine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cainteoir-engine.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "compatibility.hpp"
+
+#include <cainteoir/sigproc.hpp>
+
+#include "benchmark.hpp"
+#include "corpus.hpp"
+
+REGISTER_BENCHMARKSUITE("sigproc");
+
+static volatile float matches;
+
+// Generate the windowed samples of a random signal, as produced by the
+// s16_window_enumerator (the imaginary parts are zero).
+static cainteoir::complex_array generate_window(uint32_t aWindowSize)
+{
+	corpus_random random;
+	auto window = cainteoir::window("hamming", aWindowSize);
+
+	cainteoir::complex_array data;
+	for (uint32_t i = 0; i != aWindowSize; ++i)
+		data.push_back({ ((float)random(65536) / 32768 - 1.0f) * window[i], 0.0f });
+	return data;
+}
+
+BENCHMARK("fast fourier transform")
+{
+	for (uint32_t size = 256; size <= 8192; size *= 2)
+	{
+		auto samples = generate_window(size);
+		cainteoir::complex_array data;
+		char name[64];
+
+		snprintf(name, sizeof(name), "fft (%d samples)", size);
+		measure(name, "windows", 100, [&]() {
+			for (int i = 0; i != 100; ++i)
+			{
+				data = samples;
+				cainteoir::fft(data);
+			}
+			matches = data[1].re;
+		});
+
+		snprintf(name, sizeof(name), "rfft (%d samples)", size);
+		measure(name, "windows", 100, [&]() {
+			for (int i = 0; i != 100; ++i)
+			{
+				data = samples;
+				cainteoir::rfft(data);
+			}
+			matches = data[1].re;
+		});
+
+		snprintf(name, sizeof(name), "ifft (%d samples)", size);
+		measure(name, "windows", 100, [&]() {
+			for (int i = 0; i != 100; ++i)
+			{
+				data = samples;
+				cainteoir::ifft(data);
+			}
+			matches = data[1].re;
+		});
+	}
+}
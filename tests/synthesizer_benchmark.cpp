@@ -0,0 +1,420 @@
+/* Prosody, diphone generation and synthesis benchmarks.
+ *
+ * Copyright (C) 2015 Reece H. Dunn
+ *
+ * This file is part of cainteoir-engine.
+ *
+ * cainteoir-engine is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * cainteoir-engine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cainteoir-engine.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "compatibility.hpp"
+
+#include <cainteoir/synthesizer.hpp>
+#include <pthread.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cmath>
+
+#include "benchmark.hpp"
+#include "corpus.hpp"
+
+namespace tts = cainteoir::tts;
+namespace css = cainteoir::css;
+namespace rdf = cainteoir::rdf;
+namespace ipa = cainteoir::ipa;
+
+REGISTER_BENCHMARKSUITE("synthesizer");
+
+static volatile size_t matches;
+
+static const char *consonants[] =
+{
+	"b", "d", "ð", "d͡ʒ", "f", "ɡ", "h", "j", "k", "l", "m", "n", "ŋ", "θ",
+	"p", "ɹ", "s", "ʃ", "t", "t͡ʃ", "v", "w", "z", "ʒ",
+};
+
+static const char *vowels[] =
+{
+	"ɪ", "ʊ", "ɛ", "ʌ", "æ", "ɒ", "i", "iː", "uː", "ɜː", "ɔː", "ɑː", "ə",
+	"eɪ̯", "əʊ̯", "aɪ̯", "aʊ̯", "ɔɪ̯",
+};
+
+static const char *intonation[] =
+{
+	"˥", "˧", "˩", "˥˩", "˩˥", "˧˥˧",
+};
+
+// Generate an IPA transcription of aWords words, using the phonemes in the
+// English duration model. The vowels have tones so a pitch envelope is
+// generated for them.
+static std::string generate_phonemes(std::size_t aWords)
+{
+	static const std::size_t num_consonants = sizeof(consonants) / sizeof(consonants[0]);
+	static const std::size_t num_vowels = sizeof(vowels) / sizeof(vowels[0]);
+	static const std::size_t num_tones = sizeof(intonation) / sizeof(intonation[0]);
+
+	corpus_random random;
+	std::string text;
+	for (std::size_t i = 0; i < aWords; ++i)
+	{
+		if (i != 0)
+			text += ' ';
+		for (uint32_t syllables = random(3) + 1; syllables != 0; --syllables)
+		{
+			if (random(3) == 0)
+				text += "ˈ";
+			text += consonants[random(num_consonants)];
+			text += vowels[random(num_vowels)];
+			text += intonation[random(num_tones)];
+			if (random(2) == 0)
+				text += consonants[random(num_consonants)];
+		}
+	}
+	return text;
+}
+
+BENCHMARK("prosody (generated ipa transcription)")
+{
+	std::string text = generate_phonemes(20000);
+	auto data = cainteoir::make_buffer(text.c_str(), text.size());
+
+	auto durations = tts::createDurationModel(cainteoir::make_file_buffer("data/durations/en/default.dur"));
+	auto pitch = std::make_shared<tts::pitch_model>(
+		css::frequency(100, css::frequency::hertz),
+		css::frequency(10, css::frequency::hertz),
+		css::frequency(5, css::frequency::hertz));
+	auto phonemes = tts::createPhonemeReader("ipa");
+
+	phonemes->reset(data);
+	auto prosody = tts::createProsodyReader(phonemes, durations, pitch, tts::zero_distribution);
+	std::vector<tts::phone> phone_list;
+	while (prosody->read())
+		phone_list.push_back(prosody->first);
+	size_t phones = phone_list.size();
+	printf("  20000 words, %d phones\n", (int)phones);
+
+	measure("duration_model::lookup", "phones", phones, [&]() {
+		size_t n = 0;
+		for (const auto &phone : phone_list)
+			n += durations->lookup(phone, tts::zero_distribution).value();
+		matches = n;
+	});
+
+	measure("prosody_reader::read", "phones", phones, [&]() {
+		phonemes->reset(data);
+		auto reader = tts::createProsodyReader(phonemes, durations, pitch, tts::zero_distribution);
+		size_t n = 0;
+		while (reader->read())
+			n += reader->envelope.size();
+		matches = n;
+	});
+
+	measure("diphone reader", "phones", phones, [&]() {
+		phonemes->reset(data);
+		auto reader = tts::createDiphoneReader(
+			tts::createProsodyReader(phonemes, durations, pitch, tts::zero_distribution));
+		size_t n = 0;
+		while (reader->read())
+			n += reader->envelope.size();
+		matches = n;
+	});
+
+	// Map each phone to two units, as used by the unit readers of voices.
+	constexpr auto mask = ~(ipa::stress | ipa::tone_start | ipa::tone_middle | ipa::tone_end);
+	std::vector<tts::unit_t> units;
+	std::vector<tts::phoneme_units> unit_phonemes;
+	phonemes->reset(data);
+	prosody = tts::createProsodyReader(phonemes, durations, pitch, tts::zero_distribution);
+	while (prosody->read())
+	{
+		ipa::phoneme phoneme1 = prosody->first.phoneme1.get(mask);
+		if (phoneme1.get(ipa::phoneme_type) == ipa::separator)
+			continue;
+
+		auto match = std::find_if(unit_phonemes.begin(), unit_phonemes.end(),
+			[&](const tts::phoneme_units &entry) {
+				return entry.phoneme1 == phoneme1 && entry.phoneme2 == prosody->first.phoneme2;
+			});
+		if (match == unit_phonemes.end())
+		{
+			unit_phonemes.push_back({ phoneme1, prosody->first.phoneme2, (uint16_t)units.size(), 2 });
+			units.push_back({ "unit", 0, 0, 100 });
+			units.push_back({ "unit", 50, 0, 100 });
+		}
+	}
+	cainteoir::range<const tts::phoneme_units *> unit_range(&unit_phonemes.front(), &unit_phonemes.back() + 1);
+
+	measure("unit reader", "phones", phones, [&]() {
+		phonemes->reset(data);
+		auto reader = tts::create_unit_reader(
+			tts::createProsodyReader(phonemes, durations, pitch, tts::zero_distribution),
+			units, unit_range);
+		size_t n = 0;
+		while (reader->read())
+			n += reader->envelope.size();
+		matches = n;
+	});
+
+	tts::prosody_block block;
+
+	measure("prosody_block_reader::read", "phones", phones, [&]() {
+		phonemes->reset(data);
+		auto reader = tts::create_prosody_block_reader(phonemes, durations, pitch, tts::zero_distribution);
+		size_t n = 0;
+		while (reader->read(block))
+			n += block.envelope_count;
+		matches = n;
+	});
+
+	measure("diphone block reader", "phones", phones, [&]() {
+		phonemes->reset(data);
+		auto reader = tts::create_diphone_block_reader(
+			tts::create_prosody_block_reader(phonemes, durations, pitch, tts::zero_distribution));
+		size_t n = 0;
+		while (reader->read(block))
+			n += block.envelope_count;
+		matches = n;
+	});
+
+	measure("unit block reader", "phones", phones, [&]() {
+		phonemes->reset(data);
+		auto reader = tts::create_unit_block_reader(
+			tts::create_prosody_block_reader(phonemes, durations, pitch, tts::zero_distribution),
+			units, unit_range);
+		size_t n = 0;
+		while (reader->read(block))
+			n += block.envelope_count;
+		matches = n;
+	});
+}
+
+// PSOLA voice /////////////////////////////////////////////////////////////////
+
+#define VOICE_FREQUENCY 16000
+
+struct generated_unit
+{
+	const char *phoneme;
+	const char *name;
+	bool voiced;
+	int duration; // milliseconds
+};
+
+static const generated_unit psola_units[] =
+{
+	{ "ɑ", "a", true,  150 },
+	{ "i", "i", true,  120 },
+	{ "u", "u", true,  120 },
+	{ "m", "m", true,  80 },
+	{ "n", "n", true,  80 },
+	{ "l", "l", true,  70 },
+	{ "s", "s", false, 100 },
+	{ "t", "t", false, 60 },
+	{ "k", "k", false, 60 },
+};
+
+// Write 250ms of unit audio: a 120Hz harmonic tone for voiced units, or noise
+// for unvoiced units.
+static void write_unit_audio(const std::string &aFileName, bool aVoiced, uint32_t aSeed)
+{
+	corpus_random random(aSeed);
+	std::vector<int16_t> samples(VOICE_FREQUENCY / 4);
+	double phase = 0.0;
+	for (auto &sample : samples)
+	{
+		if (aVoiced)
+		{
+			phase += 120.0 / VOICE_FREQUENCY;
+			double value = 0.0;
+			for (int harmonic = 1; harmonic <= 6; ++harmonic)
+				value += sin(2 * M_PI * harmonic * phase) / (harmonic + random(3));
+			sample = value * 4000.0 * (1.0 - fmod(phase, 1.0));
+		}
+		else
+			sample = (int)random(4000) - 2000;
+	}
+
+	std::string wav = make_wav(samples, VOICE_FREQUENCY);
+	FILE *out = fopen(aFileName.c_str(), "wb");
+	fwrite(wav.c_str(), 1, wav.size(), out);
+	fclose(out);
+}
+
+// Generate an IPA transcription of aWords words using the phonemes in the
+// generated PSOLA voice, with tones on the vowels.
+static std::string generate_psola_phonemes(std::size_t aWords)
+{
+	static const char *tones[] = { "˥", "˦", "˧", "˨", "˩", "˥˩", "˩˥" };
+
+	corpus_random random;
+	std::string text;
+	for (std::size_t i = 0; i < aWords; ++i)
+	{
+		if (i != 0)
+			text += ' ';
+		for (uint32_t syllables = random(3) + 1; syllables != 0; --syllables)
+		{
+			text += psola_units[3 + random(6)].phoneme;
+			text += psola_units[random(3)].phoneme;
+			text += tones[random(7)];
+		}
+	}
+	return text;
+}
+
+struct sample_counter : public cainteoir::audio
+{
+	sample_counter() : samples(0) {}
+
+	void open() {}
+
+	void close() {}
+
+	uint32_t write(const char *, uint32_t len)
+	{
+		samples += len / sizeof(short);
+		return len;
+	}
+
+	int channels() const { return 1; }
+
+	int frequency() const { return VOICE_FREQUENCY; }
+
+	const rdf::uri &format() const { return mFormat; }
+
+	size_t samples;
+private:
+	rdf::uri mFormat = rdf::tts("s16le");
+};
+
+struct synthesis_job
+{
+	std::shared_ptr<tts::voice> voice;
+	std::shared_ptr<cainteoir::buffer> text;
+	size_t samples;
+};
+
+static size_t synthesize(const std::shared_ptr<tts::voice> &aVoice, const std::shared_ptr<cainteoir::buffer> &aText)
+{
+	auto phonemes = tts::createPhonemeReader("ipa");
+	phonemes->reset(aText);
+
+	auto synthesizer = aVoice->synthesizer();
+	synthesizer->bind(tts::createProsodyReader(phonemes, aVoice->durations(), aVoice->pitch_model(), tts::zero_distribution));
+
+	sample_counter out;
+	while (synthesizer->synthesize(&out))
+		;
+	return out.samples;
+}
+
+static void *synthesis_thread(void *data)
+{
+	synthesis_job *job = (synthesis_job *)data;
+	job->samples = synthesize(job->voice, job->text);
+	return nullptr;
+}
+
+BENCHMARK("psola synthesis (generated voice)")
+{
+	char dir[] = "/tmp/cainteoir-psola-XXXXXX";
+	if (!mkdtemp(dir))
+		throw std::runtime_error("unable to create the voice directory");
+
+	std::string voicedef =
+		".rdfns\t\t\"http://reecedunn.co.uk/tts/synthesizer/psola#\"\n"
+		".id\t\tbenchmark\n"
+		".name\t\tbenchmark\n"
+		".synthesizer\tPSOLA\n"
+		".voice-author\tcainteoir-engine\n"
+		".locale\t\ten\n"
+		".gender\t\tmale\n"
+		".volume-scale\t1.0\n"
+		".frequency\t16000\n"
+		".channels\t1\n"
+		".sample-format\ts16le\n"
+		".phonemeset\tipa\n"
+		"\n"
+		"pitch 82Hz 24Hz 6Hz\n"
+		"\n";
+	std::vector<std::string> files;
+	uint32_t seed = 1;
+	for (const auto &unit : psola_units)
+	{
+		std::string filename = std::string(unit.name) + ".wav";
+		files.push_back(std::string(dir) + "/" + filename);
+		write_unit_audio(files.back(), unit.voiced, seed++);
+		voicedef += "audio \"" + std::string(unit.name) + "\" " + filename + "\n";
+	}
+	for (const auto &unit : psola_units)
+	{
+		voicedef += "\nphoneme /" + std::string(unit.phoneme) + "/\n"
+		            "\tduration " + std::to_string(unit.duration) + "ms\n"
+		            "\tunit \"" + unit.name + "\"\n"
+		            "end\n";
+	}
+
+	files.push_back(std::string(dir) + "/benchmark.voicedef");
+	FILE *out = fopen(files.back().c_str(), "wb");
+	fwrite(voicedef.c_str(), 1, voicedef.size(), out);
+	fclose(out);
+
+	files.push_back(std::string(dir) + "/benchmark.vdb");
+	out = fopen(files.back().c_str(), "wb");
+	tts::compile_voice(files[files.size() - 2].c_str(), out);
+	fclose(out);
+
+	rdf::graph metadata;
+	rdf::uri voiceref{ "http://reecedunn.co.uk/tts/synthesizer/psola#", "benchmark" };
+	metadata.statement(voiceref, rdf::tts("data"), rdf::literal(files.back()));
+	metadata.statement(voiceref, rdf::tts("frequency"), rdf::literal(VOICE_FREQUENCY, rdf::tts("hertz")));
+	metadata.statement(voiceref, rdf::tts("volumeScale"), rdf::literal(1.0));
+	auto voice = tts::create_voice(metadata, &voiceref);
+	if (!voice)
+		throw std::runtime_error("unable to load the generated PSOLA voice");
+
+	std::string text = generate_psola_phonemes(500);
+	auto data = cainteoir::make_buffer(text.c_str(), text.size());
+
+	double seconds = (double)synthesize(voice, data) / VOICE_FREQUENCY;
+	printf("  500 words, %.2f seconds of audio\n", seconds);
+
+	measure("synthesizer::synthesize", "audio seconds", seconds, [&]() {
+		matches = synthesize(voice, data);
+	});
+
+	for (int threads : { 2, 4 })
+	{
+		char name[64];
+		snprintf(name, sizeof(name), "synthesizer::synthesize (%d threads)", threads);
+		measure(name, "audio seconds", seconds * threads, [&]() {
+			std::vector<synthesis_job> jobs(threads, { voice, data, 0 });
+			std::vector<pthread_t> ids(threads);
+			for (int i = 0; i < threads; ++i)
+				pthread_create(&ids[i], nullptr, synthesis_thread, &jobs[i]);
+			size_t samples = 0;
+			for (int i = 0; i < threads; ++i)
+			{
+				pthread_join(ids[i], nullptr);
+				samples += jobs[i].samples;
+			}
+			matches = samples;
+		});
+	}
+
+	for (const auto &file : files)
+		unlink(file.c_str());
+	rmdir(dir);
+}
@@ -0,0 +1,74 @@
+/* Text reader benchmarks.
+ *
+ * Copyright (C) 2015 Reece H. Dunn
+ *
+ * This file is part of cainteoir-engine.
+ *
+ * cainteoir-engine is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * cainteoir-engine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cainteoir-engine.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "compatibility.hpp"
+
+#include <cainteoir/text.hpp>
+#include <cainteoir/document.hpp>
+
+#include "benchmark.hpp"
+#include "corpus.hpp"
+
+namespace tts = cainteoir::tts;
+namespace rdf = cainteoir::rdf;
+
+REGISTER_BENCHMARKSUITE("text_reader");
+
+static volatile size_t matches;
+
+static std::shared_ptr<cainteoir::document>
+load_document(std::shared_ptr<cainteoir::buffer> aData, rdf::graph &metadata)
+{
+	rdf::uri subject{ "benchmark.epub", std::string() };
+	auto reader = cainteoir::createDocumentReader(aData, subject, metadata);
+	if (!reader)
+		throw std::runtime_error("unable to read the generated epub document");
+	return std::make_shared<cainteoir::document>(reader, metadata);
+}
+
+BENCHMARK("text_reader tokens (generated epub)")
+{
+	rdf::graph metadata;
+	auto doc = load_document(generate_epub(20, 10000), metadata);
+	auto tokens = tts::create_text_reader();
+
+	size_t count = 0;
+	tokens->reset(cainteoir::createDocumentReader(doc->children()));
+	while (tokens->next())
+		++count;
+	printf("  20 chapters, %d tokens\n", (int)count);
+
+	measure("text_reader::next", "tokens", count, [&]() {
+		size_t n = 0;
+		tokens->reset(cainteoir::createDocumentReader(doc->children()));
+		while (tokens->next())
+			n += tokens->text.size();
+		matches = n;
+	});
+
+	measure("text_reader::read (object)", "tokens", count, [&]() {
+		size_t n = 0;
+		tokens->reset(cainteoir::createDocumentReader(doc->children()));
+		while (tokens->read())
+			n += tokens->token.get("Token:text").buffer() ? 1 : 0;
+		matches = n;
+	});
+}
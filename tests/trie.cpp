@@ -154,3 +154,124 @@ TEST_CASE("trie (key=long): std::vector insertion")
 	assert(n.lookup(std::vector<long>({ 7, 4 })) == 0);
 	assert(n.lookup(std::vector<long>({ 6, 2, 6 })) == 0);
 }
+
+TEST_CASE("compiled trie (key=char): empty trie")
+{
+	cainteoir::compiled_trie<int> n;
+	assert(n.size() == 1);
+	assert(n.root()->c == '\0');
+	assert(n.root()->item == 0);
+	assert(n.root()->num_children == 0);
+	assert(n.root()->get('a') == nullptr);
+
+	assert(n.lookup(std::string("test")) == 0);
+	assert(n.lookup(std::string("test"), -1) == -1);
+}
+
+TEST_CASE("compiled trie (key=char): std::string lookup")
+{
+	static const std::initializer_list<std::pair<std::string, int>> words =
+	{
+		{ "test", 1 },
+		{ "tear", 2 },
+		{ "tome", 3 },
+		{ "boast", 4 },
+		{ "view", 5 },
+		{ "even", 6 },
+		{ "viewing", 7 },
+	};
+
+	cainteoir::trie<int> t;
+	for (const auto &word : words)
+		t.insert(word.first, word.second);
+
+	auto n = t.compile();
+	assert(n.size() == 26);
+
+	for (const auto &word : words)
+		assert(n.lookup(word.first) == word.second);
+
+	assert(n.lookup(std::string("team")) == 0);
+	assert(n.lookup(std::string("nosuchword")) == 0);
+	assert(n.lookup(std::string("te"), -1) == 0);
+	assert(n.lookup(std::string("x"), -1) == -1);
+}
+
+TEST_CASE("compiled trie (key=char): node traversal")
+{
+	cainteoir::trie<int> t;
+	t.insert(std::string("test"), 1);
+	t.insert(std::string("tear"), 2);
+
+	auto n = t.compile();
+
+	auto root = n.root();
+	assert(root->num_children == 1);
+	assert(root->get('e') == nullptr);
+
+	auto node = root->get('t');
+	assert(node != nullptr);
+	assert(node->c == 't');
+	assert(node->num_children == 1);
+
+	node = node->get('e');
+	assert(node != nullptr);
+	assert(node->c == 'e');
+	assert(node->num_children == 2);
+	assert(node->get('a')->c == 'a');
+	assert(node->get('s')->c == 's');
+	assert(node->get('t') == nullptr);
+
+	node = node->get('s')->get('t');
+	assert(node != nullptr);
+	assert(node->item == 1);
+	assert(node->num_children == 0);
+	assert(node->get('s') == nullptr);
+}
+
+TEST_CASE("compiled trie (key=char): binary search of many children")
+{
+	cainteoir::trie<int> t;
+	for (char c = 'a'; c <= 'z'; ++c)
+	{
+		std::string key{ 'x', c };
+		t.insert(key, c);
+	}
+
+	auto n = t.compile();
+
+	auto node = n.root()->get('x');
+	assert(node != nullptr);
+	assert(node->num_children == 26);
+	for (char c = 'a'; c <= 'z'; ++c)
+	{
+		assert(node->get(c) != nullptr);
+		assert(node->get(c)->item == c);
+		assert(n.lookup(std::string{ 'x', c }) == c);
+	}
+	assert(node->get('A') == nullptr);
+	assert(node->get('~') == nullptr);
+}
+
+TEST_CASE("compiled trie (key=long): std::vector lookup")
+{
+	static const std::initializer_list<std::pair<std::vector<long>, int>> words =
+	{
+		{ { 1, 2, 3 }, 1 },
+		{ { 7, 4, 6 }, 2 },
+		{ { 8, 7, 6, 5, 4 }, 3 },
+		{ { 7, 4,  9 }, 4 },
+		{ { 2, 2 }, 5 },
+	};
+
+	cainteoir::trie<int, long> t;
+	for (const auto &word : words)
+		t.insert(word.first, word.second);
+
+	auto n = t.compile();
+	for (const auto &word : words)
+		assert(n.lookup(word.first) == word.second);
+
+	assert(n.lookup(std::vector<long>({ 7, 4 })) == 0);
+	assert(n.lookup(std::vector<long>({ 6, 2, 6 })) == 0);
+}
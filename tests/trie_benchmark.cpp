@@ -0,0 +1,87 @@
+/* Trie Benchmarks.
+ *
+ * Copyright (C) 2015 Reece H. Dunn
+ *
+ * This file is part of cainteoir-engine.
+ *
+ * cainteoir-engine is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * cainteoir-engine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cainteoir-engine.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "compatibility.hpp"
+
+#include <cainteoir/trie.hpp>
+#include "../src/libcainteoir/phoneme/phonemeset.hpp"
+
+#include "benchmark.hpp"
+
+namespace tts = cainteoir::tts;
+
+REGISTER_BENCHMARKSUITE("trie");
+
+static const char *phonemesets[] =
+{
+	"ipa",
+	"ascii-ipa",
+	"cxs",
+	"x-sampa",
+	"radio",
+	"mrpa",
+	"timit",
+	"cmu",
+	"arpabet/en-US",
+	"espeak/en",
+};
+
+static volatile size_t matches;
+
+template <typename Trie>
+static size_t lookup_all(const Trie &aTrie, const std::vector<std::string> &aKeys)
+{
+	size_t matched = 0;
+	for (const auto &key : aKeys)
+		matched += aTrie.lookup(key);
+	return matched;
+}
+
+BENCHMARK("phonemeset transcription lookup")
+{
+	for (const char *phonemeset : phonemesets)
+	{
+		tts::phoneme_file_reader reader(phonemeset);
+
+		cainteoir::trie<int> phonemes;
+		std::vector<std::string> keys;
+		while (reader.read())
+		{
+			std::string key = reader.transcription->str();
+			phonemes.insert(key, 1);
+			keys.push_back(key);
+			keys.push_back(key + "~"); // miss on the last character
+		}
+
+		auto compiled = phonemes.compile();
+		if (lookup_all(phonemes, keys) != lookup_all(compiled, keys))
+			throw std::runtime_error("trie and compiled_trie lookups do not match");
+
+		printf("  %s (%d transcriptions, %d nodes)\n", phonemeset, (int)keys.size() / 2, (int)compiled.size());
+
+		measure("trie::lookup", "lookups", keys.size(), [&]() {
+			matches = lookup_all(phonemes, keys);
+		});
+		measure("compiled_trie::lookup", "lookups", keys.size(), [&]() {
+			matches = lookup_all(compiled, keys);
+		});
+	}
+}
@@ -0,0 +1,157 @@
+/* XML reader benchmarks.
+ *
+ * Copyright (C) 2015 Reece H. Dunn
+ *
+ * This file is part of cainteoir-engine.
+ *
+ * cainteoir-engine is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * cainteoir-engine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cainteoir-engine.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "compatibility.hpp"
+
+#include <cainteoir/xmlreader.hpp>
+#include <cainteoir/archive.hpp>
+#include <vector>
+#include <glob.h>
+
+#include "benchmark.hpp"
+#include "corpus.hpp"
+
+namespace xml   = cainteoir::xml;
+namespace xmlns = cainteoir::xml::xmlns;
+namespace rdf   = cainteoir::rdf;
+
+REGISTER_BENCHMARKSUITE("xmlreader");
+
+static volatile size_t matches;
+
+static const xml::context::entry known_node = {};
+static const xml::context::entry known_attr = {};
+
+// A selection of the elements and attributes in the documents, so the context
+// of each element and attribute is looked up as it is in the document parsers.
+
+static const std::initializer_list<const xml::context::entry_ref> nodes =
+{
+	{ "body",      &known_node },
+	{ "content",   &known_node },
+	{ "docTitle",  &known_node },
+	{ "h1",        &known_node },
+	{ "head",      &known_node },
+	{ "html",      &known_node },
+	{ "item",      &known_node },
+	{ "itemref",   &known_node },
+	{ "manifest",  &known_node },
+	{ "metadata",  &known_node },
+	{ "navLabel",  &known_node },
+	{ "navMap",    &known_node },
+	{ "navPoint",  &known_node },
+	{ "ncx",       &known_node },
+	{ "p",         &known_node },
+	{ "package",   &known_node },
+	{ "spine",     &known_node },
+	{ "text",      &known_node },
+	{ "title",     &known_node },
+};
+
+static const std::initializer_list<const xml::context::entry_ref> attrs =
+{
+	{ "href",       &known_attr },
+	{ "id",         &known_attr },
+	{ "idref",      &known_attr },
+	{ "media-type", &known_attr },
+	{ "playOrder",  &known_attr },
+	{ "src",        &known_attr },
+	{ "version",    &known_attr },
+};
+
+static size_t parse(const std::shared_ptr<cainteoir::buffer> &aData)
+{
+	xml::reader reader(aData, "windows-1252");
+	reader.set_nodes(std::string(),  nodes, cainteoir::buffer::ignore_case);
+	reader.set_attrs(std::string(),  attrs, cainteoir::buffer::ignore_case);
+	reader.set_nodes(xmlns::xhtml,   nodes);
+	reader.set_attrs(xmlns::xhtml,   attrs);
+	reader.set_nodes(xmlns::opf,     nodes);
+	reader.set_attrs(xmlns::opf,     attrs);
+	reader.set_nodes(xmlns::ncx,     nodes);
+	reader.set_attrs(xmlns::ncx,     attrs);
+	reader.set_nodes(xmlns::dc,      nodes);
+	reader.set_attrs(xmlns::xml,     xml::attrs);
+
+	size_t known = 0;
+	while (reader.read())
+	{
+		if (reader.context() != &xml::unknown_context)
+			++known;
+	}
+	return known;
+}
+
+static void measure_documents(const char *aName, const std::vector<std::shared_ptr<cainteoir::buffer>> &aDocuments)
+{
+	size_t bytes = 0;
+	for (auto &data : aDocuments)
+		bytes += data->size();
+	printf("  %s: %d documents, %d bytes\n", aName, (int)aDocuments.size(), (int)bytes);
+
+	measure("xml::reader::read", "MB", bytes / 1000000.0, [&]() {
+		size_t n = 0;
+		for (auto &data : aDocuments)
+			n += parse(data);
+		matches = n;
+	});
+}
+
+BENCHMARK("xml reader (tests/xmlparser)")
+{
+	std::vector<std::shared_ptr<cainteoir::buffer>> documents;
+
+	glob_t files;
+	if (glob("tests/xmlparser/*/*.xml", 0, nullptr, &files) == 0)
+	{
+		for (size_t i = 0; i != files.gl_pathc; ++i)
+		{
+			// The entity tests report the unknown entities on stderr.
+			if (strstr(files.gl_pathv[i], "/entity/") == nullptr)
+				documents.push_back(cainteoir::make_file_buffer(files.gl_pathv[i]));
+		}
+	}
+	globfree(&files);
+
+	if (documents.empty())
+		throw std::runtime_error("no documents found in tests/xmlparser");
+
+	measure_documents("tests/xmlparser", documents);
+}
+
+BENCHMARK("xml reader (generated epub)")
+{
+	auto data = generate_epub(200, 500, true);
+	auto archive = cainteoir::create_zip_archive(data, rdf::uri("benchmark.epub", std::string()));
+
+	std::vector<std::shared_ptr<cainteoir::buffer>> documents;
+	std::vector<std::shared_ptr<cainteoir::buffer>> navigation;
+	for (auto &filename : archive->files())
+	{
+		if (filename.find(".xhtml") != std::string::npos)
+			documents.push_back(archive->read(filename.c_str()));
+		else if (filename.find(".opf") != std::string::npos || filename.find(".ncx") != std::string::npos)
+			navigation.push_back(archive->read(filename.c_str()));
+	}
+
+	measure_documents("content documents", documents);
+	measure_documents("package and navigation documents", navigation);
+}
@@ -0,0 +1,146 @@
+/* Test for the lifetime of the XML reader node values.
+ *
+ * Copyright (C) 2015 Reece H. Dunn
+ *
+ * This file is part of cainteoir-engine.
+ *
+ * cainteoir-engine is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * cainteoir-engine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with cainteoir-engine.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "compatibility.hpp"
+
+#include <cainteoir/xmlreader.hpp>
+#include <cainteoir/document.hpp>
+#include <cstring>
+
+#include "tester.hpp"
+
+namespace xml = cainteoir::xml;
+namespace rdf = cainteoir::rdf;
+
+REGISTER_TESTSUITE("xmlreader nodes");
+
+// The document data is overwritten when it is released, so a node value that
+// still references the document data is detected instead of reading memory
+// that has been freed.
+struct released_buffer : public cainteoir::buffer
+{
+	released_buffer(const char *aText)
+		: cainteoir::buffer(nullptr, nullptr)
+		, mData(aText)
+	{
+		first = mData.c_str();
+		last  = first + mData.size();
+	}
+
+	~released_buffer()
+	{
+		std::fill(mData.begin(), mData.end(), 'X');
+		released = true;
+	}
+
+	static bool released;
+private:
+	std::string mData;
+};
+
+bool released_buffer::released = false;
+
+static std::shared_ptr<cainteoir::buffer> make_released_buffer(const char *aText)
+{
+	released_buffer::released = false;
+	return std::make_shared<released_buffer>(aText);
+}
+
+// The node value is checked after the reader is destroyed, which is before the
+// memory of the released buffer is reused.
+static std::shared_ptr<cainteoir::buffer> read_text(const char *aDocument)
+{
+	auto data = make_released_buffer(aDocument);
+	auto reader = std::make_shared<xml::reader>(data, "windows-1252");
+	data.reset();
+
+	std::shared_ptr<cainteoir::buffer> text;
+	while (reader->read())
+	{
+		if (reader->nodeType() == xml::reader::textNode)
+		{
+			text = reader->nodeValue().content();
+			break;
+		}
+	}
+
+	reader.reset();
+	return text;
+}
+
+TEST_CASE("text node value in a utf-8 document")
+{
+	auto text = read_text("<?xml version=\"1.0\" encoding=\"utf-8\"?><a>Lorem ipsum</a>");
+	assert(released_buffer::released == false);
+	assert(text.get());
+	assert(text->str() == "Lorem ipsum");
+
+	text.reset();
+	assert(released_buffer::released == true);
+}
+
+TEST_CASE("text node value with entities")
+{
+	auto text = read_text("<?xml version=\"1.0\" encoding=\"utf-8\"?><a>Lorem &amp; ipsum</a>");
+	assert(text.get());
+	assert(text->str() == "Lorem & ipsum");
+}
+
+TEST_CASE("text node value in a windows-1252 document")
+{
+	auto text = read_text("<?xml version=\"1.0\" encoding=\"windows-1252\"?><a>Lorem ipsum</a>");
+	assert(text.get());
+	assert(text->str() == "Lorem ipsum");
+}
+
+TEST_CASE("ssml text events after the document is read")
+{
+	std::vector<std::string> text;
+	{
+		rdf::graph metadata;
+		std::shared_ptr<cainteoir::buffer> data = make_released_buffer(
+			"<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+			"<speak version=\"1.1\" xmlns=\"http://www.w3.org/2001/10/synthesis\">\n"
+			"<p>First paragraph.</p>\n"
+			"<p>Second paragraph.</p>\n"
+			"</speak>\n");
+		auto reader = cainteoir::createDocumentReader(data, rdf::uri("test.ssml", std::string()), metadata);
+		data.reset();
+		assert(reader.get());
+
+		cainteoir::document doc(reader, metadata);
+		reader.reset();
+		doc.size(); // read the whole document, which releases the document reader
+
+		for (auto &item : doc.children())
+		{
+			if (item.type & cainteoir::events::text)
+				text.push_back(item.content->str());
+		}
+	}
+
+	assert(text.size() == 2);
+	if (text.size() == 2)
+	{
+		assert(text[0] == "First paragraph.");
+		assert(text[1] == "Second paragraph.");
+	}
+}